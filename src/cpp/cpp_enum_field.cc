@@ -58,9 +58,11 @@ void SetEnumVariables(const FieldDescriptor* descriptor,
 // ===================================================================
 
 EnumFieldGenerator::
-EnumFieldGenerator(const FieldDescriptor* descriptor)
+EnumFieldGenerator(const FieldDescriptor* descriptor,
+                   const Options& options)
   : descriptor_(descriptor) {
   SetEnumVariables(descriptor, &variables_);
+  SetGeneratorOptionVariables(descriptor, options, &variables_);
 }
 
 EnumFieldGenerator::~EnumFieldGenerator() {}
@@ -81,12 +83,14 @@ void EnumFieldGenerator::
 GenerateInlineAccessorDefinitions(io::Printer* printer) const {
   printer->Print(variables_,
     "inline $type$ $classname$::$name$() const {\n"
-    "  return static_cast< $type$ >($name$_);\n"
+    "$count_read$"
+    "  return static_cast< $type$ >($cold_const$$name$_);\n"
     "}\n"
     "inline void $classname$::set_$name$($type$ value) {\n"
+    "$count_write$"
     "  GOOGLE_DCHECK($type$_IsValid(value));\n"
     "  set_has_$name$();\n"
-    "  $name$_ = value;\n"
+    "  $cold_mutable$$name$_ = value;\n"
     "}\n");
 }
 
@@ -152,9 +156,12 @@ GenerateByteSize(io::Printer* printer) const {
 // ===================================================================
 
 RepeatedEnumFieldGenerator::
-RepeatedEnumFieldGenerator(const FieldDescriptor* descriptor)
-  : descriptor_(descriptor) {
+RepeatedEnumFieldGenerator(const FieldDescriptor* descriptor,
+                           const Options& options)
+  : descriptor_(descriptor),
+    packed_fast_path_(options.packed_fast_path) {
   SetEnumVariables(descriptor, &variables_);
+  SetGeneratorOptionVariables(descriptor, options, &variables_);
 }
 
 RepeatedEnumFieldGenerator::~RepeatedEnumFieldGenerator() {}
@@ -184,23 +191,28 @@ void RepeatedEnumFieldGenerator::
 GenerateInlineAccessorDefinitions(io::Printer* printer) const {
   printer->Print(variables_,
     "inline $type$ $classname$::$name$(int index) const {\n"
+    "$count_read$"
     "  return static_cast< $type$ >($name$_.Get(index));\n"
     "}\n"
     "inline void $classname$::set_$name$(int index, $type$ value) {\n"
+    "$count_write$"
     "  GOOGLE_DCHECK($type$_IsValid(value));\n"
     "  $name$_.Set(index, value);\n"
     "}\n"
     "inline void $classname$::add_$name$($type$ value) {\n"
+    "$count_write$"
     "  GOOGLE_DCHECK($type$_IsValid(value));\n"
     "  $name$_.Add(value);\n"
     "}\n");
   printer->Print(variables_,
     "inline const ::google::protobuf::RepeatedField<int>&\n"
     "$classname$::$name$() const {\n"
+    "$count_read$"
     "  return $name$_;\n"
     "}\n"
     "inline ::google::protobuf::RepeatedField<int>*\n"
     "$classname$::mutable_$name$() {\n"
+    "$count_write$"
     "  return &$name$_;\n"
     "}\n");
 }
@@ -253,6 +265,12 @@ GenerateMergeFromCodedStreamWithPacking(io::Printer* printer) const {
       "       input,\n"
       "       &$type$_IsValid,\n"
       "       this->mutable_$name$())));\n");
+  } else if (packed_fast_path_) {
+    printer->Print(variables_,
+      "DO_((::protobuf_packed_reader::ReadPackedEnum(\n"
+      "       input,\n"
+      "       &$type$_IsValid,\n"
+      "       this->mutable_$name$())));\n");
   } else {
     printer->Print(variables_,
       "::google::protobuf::uint32 length;\n"
@@ -66,6 +66,56 @@ void SetCommonFieldVariables(const FieldDescriptor* descriptor,
 
 }
 
+bool IsColdField(const FieldDescriptor* field, const Options& options) {
+  // Reflection addresses every field by its offset in the message, so only
+  // lite messages can move fields out of line.
+  if (options.cold_fields <= 0 || HasDescriptorMethods(field->file()) ||
+      field->containing_type()->field_count() < options.cold_fields) {
+    return false;
+  }
+  // Sub-messages are cross-linked to default instances, and required fields
+  // are set in every valid message anyway.
+  if (field->is_repeated() || field->is_required() ||
+      field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+    return false;
+  }
+  // The static default of a string is declared next to its member, which
+  // the message's own code has to see.
+  if (field->cpp_type() == FieldDescriptor::CPPTYPE_STRING &&
+      !field->default_value_string().empty()) {
+    return false;
+  }
+  map<string, double>::const_iterator it =
+      options.field_heat.find(field->full_name());
+  return it == options.field_heat.end() || it->second == 0;
+}
+
+void SetGeneratorOptionVariables(const FieldDescriptor* descriptor,
+                                 const Options& options,
+                                 map<string, string>* variables) {
+  if (options.field_counters) {
+    // Reads and writes of field i are counted in slots 2 * i and 2 * i + 1.
+    string counts = "  ::protobuf_field_counters::Count(" +
+                    ClassName(descriptor->containing_type(), false) +
+                    "_field_counts(), ";
+    (*variables)["count_read"] =
+        counts + SimpleItoa(2 * descriptor->index()) + ");\n";
+    (*variables)["count_write"] =
+        counts + SimpleItoa(2 * descriptor->index() + 1) + ");\n";
+  } else {
+    (*variables)["count_read"] = "";
+    (*variables)["count_write"] = "";
+  }
+
+  if (IsColdField(descriptor, options)) {
+    (*variables)["cold_const"] = "_cold_fields().";
+    (*variables)["cold_mutable"] = "_mutable_cold_fields()->";
+  } else {
+    (*variables)["cold_const"] = "";
+    (*variables)["cold_mutable"] = "";
+  }
+}
+
 FieldGenerator::~FieldGenerator() {}
 
 void FieldGenerator::
@@ -80,46 +130,48 @@ GenerateMergeFromCodedStreamWithPacking(io::Printer* printer) const {
 
 }
 
-FieldGeneratorMap::FieldGeneratorMap(const Descriptor* descriptor)
+FieldGeneratorMap::FieldGeneratorMap(const Descriptor* descriptor,
+                                     const Options& options)
   : descriptor_(descriptor),
     field_generators_(
       new scoped_ptr<FieldGenerator>[descriptor->field_count()]) {
   // Construct all the FieldGenerators.
   for (int i = 0; i < descriptor->field_count(); i++) {
-    field_generators_[i].reset(MakeGenerator(descriptor->field(i)));
+    field_generators_[i].reset(MakeGenerator(descriptor->field(i), options));
   }
 }
 
-FieldGenerator* FieldGeneratorMap::MakeGenerator(const FieldDescriptor* field) {
+FieldGenerator* FieldGeneratorMap::MakeGenerator(const FieldDescriptor* field,
+                                                 const Options& options) {
   if (field->is_repeated()) {
     switch (field->cpp_type()) {
       case FieldDescriptor::CPPTYPE_MESSAGE:
-        return new RepeatedMessageFieldGenerator(field);
+        return new RepeatedMessageFieldGenerator(field, options);
       case FieldDescriptor::CPPTYPE_STRING:
         switch (field->options().ctype()) {
           default:  // RepeatedStringFieldGenerator handles unknown ctypes.
           case FieldOptions::STRING:
-            return new RepeatedStringFieldGenerator(field);
+            return new RepeatedStringFieldGenerator(field, options);
         }
       case FieldDescriptor::CPPTYPE_ENUM:
-        return new RepeatedEnumFieldGenerator(field);
+        return new RepeatedEnumFieldGenerator(field, options);
       default:
-        return new RepeatedPrimitiveFieldGenerator(field);
+        return new RepeatedPrimitiveFieldGenerator(field, options);
     }
   } else {
     switch (field->cpp_type()) {
       case FieldDescriptor::CPPTYPE_MESSAGE:
-        return new MessageFieldGenerator(field);
+        return new MessageFieldGenerator(field, options);
       case FieldDescriptor::CPPTYPE_STRING:
         switch (field->options().ctype()) {
           default:  // StringFieldGenerator handles unknown ctypes.
           case FieldOptions::STRING:
-            return new StringFieldGenerator(field);
+            return new StringFieldGenerator(field, options);
         }
       case FieldDescriptor::CPPTYPE_ENUM:
-        return new EnumFieldGenerator(field);
+        return new EnumFieldGenerator(field, options);
       default:
-        return new PrimitiveFieldGenerator(field);
+        return new PrimitiveFieldGenerator(field, options);
     }
   }
 }
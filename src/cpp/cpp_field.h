@@ -40,6 +40,7 @@
 
 #include <google/protobuf/stubs/common.h>
 #include <google/protobuf/descriptor.h>
+#include "cpp/cpp_options.h"
 
 #include "cpp_patch.h"
 
@@ -61,6 +62,21 @@ namespace cpp {
 void SetCommonFieldVariables(const FieldDescriptor* descriptor,
                              map<string, string>* variables);
 
+// Returns true if the field is stored in its message's lazily allocated
+// ColdFields_ rather than in the message itself; see cold_fields in
+// cpp_generator.cc.
+bool IsColdField(const FieldDescriptor* field, const Options& options);
+
+// Sets the variables that depend on generator options:
+// 'count_read' and 'count_write', which the inline accessors start with, to
+//   bump the field's access counters outside the message's own generated
+//   methods if options.field_counters is set, and to nothing otherwise;
+// 'cold_const' and 'cold_mutable', which prefix the member in the accessors,
+//   to reach the ColdFields_ of a cold field, and to nothing otherwise.
+void SetGeneratorOptionVariables(const FieldDescriptor* descriptor,
+                                 const Options& options,
+                                 map<string, string>* variables);
+
 class FieldGenerator {
  public:
   FieldGenerator() {}
@@ -148,7 +164,7 @@ class FieldGenerator {
 // Convenience class which constructs FieldGenerators for a Descriptor.
 class FieldGeneratorMap {
  public:
-  explicit FieldGeneratorMap(const Descriptor* descriptor);
+  FieldGeneratorMap(const Descriptor* descriptor, const Options& options);
   ~FieldGeneratorMap();
 
   const FieldGenerator& get(const FieldDescriptor* field) const;
@@ -157,7 +173,8 @@ class FieldGeneratorMap {
   const Descriptor* descriptor_;
   scoped_array<scoped_ptr<FieldGenerator> > field_generators_;
 
-  static FieldGenerator* MakeGenerator(const FieldDescriptor* field);
+  static FieldGenerator* MakeGenerator(const FieldDescriptor* field,
+                                       const Options& options);
 
   GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(FieldGeneratorMap);
 };
@@ -51,7 +51,7 @@ namespace cpp {
 // ===================================================================
 
 FileGenerator::FileGenerator(const FileDescriptor* file,
-                             const string& dllexport_decl)
+                             const Options& options)
   : file_(file),
     message_generators_(
       new scoped_ptr<MessageGenerator>[file->message_type_count()]),
@@ -61,26 +61,26 @@ FileGenerator::FileGenerator(const FileDescriptor* file,
       new scoped_ptr<ServiceGenerator>[file->service_count()]),
     extension_generators_(
       new scoped_ptr<ExtensionGenerator>[file->extension_count()]),
-    dllexport_decl_(dllexport_decl) {
+    options_(options) {
 
   for (int i = 0; i < file->message_type_count(); i++) {
     message_generators_[i].reset(
-      new MessageGenerator(file->message_type(i), dllexport_decl));
+      new MessageGenerator(file->message_type(i), options));
   }
 
   for (int i = 0; i < file->enum_type_count(); i++) {
     enum_generators_[i].reset(
-      new EnumGenerator(file->enum_type(i), dllexport_decl));
+      new EnumGenerator(file->enum_type(i), options));
   }
 
   for (int i = 0; i < file->service_count(); i++) {
     service_generators_[i].reset(
-      new ServiceGenerator(file->service(i), dllexport_decl));
+      new ServiceGenerator(file->service(i), options));
   }
 
   for (int i = 0; i < file->extension_count(); i++) {
     extension_generators_[i].reset(
-      new ExtensionGenerator(file->extension(i), dllexport_decl));
+      new ExtensionGenerator(file->extension(i), options));
   }
 
   SplitStringUsing(file_->package(), ".", &package_parts_);
@@ -104,9 +104,27 @@ void FileGenerator::GenerateHeader(io::Printer* printer) {
     "filename", file_->name(),
     "filename_identifier", filename_identifier);
 
-  INC_LUA_HEADERS
+  if (options_.split_luabind ||
+      options_.lua_backend == Options::LUA_BACKEND_CAPI) {
+    // Registration lives in the .pb.cc or the .pb.luabind.cc; see
+    // GenerateLuaBindSource() and GenerateLuaCApiCode().
+    printer->Print(
+      "struct lua_State;\n"
+      "\n");
+    if (options_.lua_backend == Options::LUA_BACKEND_LUABIND) {
+      // The luabind member functions are still declared in the class.
+      printer->Print(
+        "namespace luabind {\n"
+        "namespace adl { class object; }\n"
+        "using adl::object;\n"
+        "}  // namespace luabind\n"
+        "\n");
+    }
+  } else {
+    INC_LUA_HEADERS
 
-  LUA_CONST_DEFINITION
+    LUABIND_USING_DEFINITION
+  }
 
   printer->Print(
     "#include <google/protobuf/stubs/common.h>\n"
@@ -153,6 +171,8 @@ void FileGenerator::GenerateHeader(io::Printer* printer) {
       "dependency", StripProto(file_->dependency(i)->name()));
   }
 
+  GenerateLuaArena(printer);
+
   printer->Print(
     "// @@protoc_insertion_point(includes)\n");
 
@@ -166,7 +186,7 @@ void FileGenerator::GenerateHeader(io::Printer* printer) {
     "// Internal implementation detail -- do not call these.\n"
     "void $dllexport_decl$ $adddescriptorsname$();\n",
     "adddescriptorsname", GlobalAddDescriptorsName(file_->name()),
-    "dllexport_decl", dllexport_decl_);
+    "dllexport_decl", options_.dllexport_decl);
 
   printer->Print(
     // Note that we don't put dllexport_decl on these because they are only
@@ -312,6 +332,11 @@ void FileGenerator::GenerateSource(io::Printer* printer) {
   printer->Print(
     "// @@protoc_insertion_point(includes)\n");
 
+  if (!options_.split_luabind) {
+    printer->Print("\n");
+    GenerateLuaRuntime(printer);
+  }
+
   GenerateNamespaceOpeners(printer);
 
   if (HasDescriptorMethods(file_)) {
@@ -374,6 +399,12 @@ void FileGenerator::GenerateSource(io::Printer* printer) {
     extension_generators_[i]->GenerateDefinition(printer);
   }
 
+  if (options_.lua_backend == Options::LUA_BACKEND_CAPI &&
+      !options_.split_luabind) {
+    printer->Print("\n");
+    GenerateLuaCApiCode(printer);
+  }
+
   printer->Print(
     "\n"
     "// @@protoc_insertion_point(namespace_scope)\n");
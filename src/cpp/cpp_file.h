@@ -39,6 +39,7 @@
 #include <vector>
 #include <google/protobuf/stubs/common.h>
 #include "cpp/cpp_field.h"
+#include "cpp/cpp_options.h"
 
 #include "cpp_patch.h"
 
@@ -61,9 +62,11 @@ class ExtensionGenerator;      // extension.h
 
 class FileGenerator {
  public:
-  // See generator.cc for the meaning of dllexport_decl.
+  // See generator.cc for the meaning of dllexport_decl.  |options|, which
+  // may carry a large layout profile, is shared with every generator this
+  // one creates rather than copied, and must outlive them all.
   explicit FileGenerator(const FileDescriptor* file,
-                         const string& dllexport_decl);
+                         const Options& options);
   ~FileGenerator();
 
   void GenerateHeader(io::Printer* printer);
@@ -89,7 +92,7 @@ class FileGenerator {
   // E.g. if the package is foo.bar, package_parts_ is {"foo", "bar"}.
   vector<string> package_parts_;
 
-  string dllexport_decl_;
+  const Options& options_;
 
   GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(FileGenerator);
 };
@@ -34,20 +34,217 @@
 
 #include "cpp/cpp_generator.h"
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <map>
 #include <vector>
 #include <utility>
 
 #include "cpp/cpp_file.h"
 #include "cpp/cpp_helpers.h"
+#include "cpp/cpp_options.h"
 #include <google/protobuf/io/printer.h>
 #include <google/protobuf/io/zero_copy_stream.h>
 #include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/stubs/strutil.h>
 
 namespace google {
 namespace protobuf {
 namespace compiler {
 namespace cpp {
 
+namespace {
+
+// Reads a field access profile into |heat|.  Each line holds a field's full
+// name followed by one or more access counts, which add up to its heat;
+// '#' starts a comment.  Names the schema doesn't know are kept, so that a
+// profile taken from an older schema still applies to the fields left.
+bool LoadLayoutProfile(const string& path, map<string, double>* heat,
+	string* error) {
+	FILE* file = fopen(path.c_str(), "rb");
+	if (file == NULL) {
+		*error = "Cannot open layout_profile: " + path;
+		return false;
+	}
+	string data;
+	char buffer[8192];
+	size_t n;
+	while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		data.append(buffer, n);
+	}
+	bool ok = !ferror(file);
+	fclose(file);
+	if (!ok) {
+		*error = "Cannot read layout_profile: " + path;
+		return false;
+	}
+
+	vector<string> lines;
+	SplitStringUsing(data, "\n", &lines);
+	for (int i = 0; i < lines.size(); i++) {
+		string line = lines[i].substr(0, lines[i].find('#'));
+		vector<string> columns;
+		SplitStringUsing(line, " \t\r", &columns);
+		if (columns.empty()) continue;
+
+		double total = 0;
+		for (int j = 1; j < columns.size(); j++) {
+			char* end;
+			double count = strtod(columns[j].c_str(), &end);
+			if (*end != '\0' || count < 0) {
+				*error = "Invalid count in layout_profile " + path + ": " + lines[i];
+				return false;
+			}
+			total += count;
+		}
+		(*heat)[columns[0]] += total;
+	}
+	return true;
+}
+
+}  // namespace
+
+bool ParseOptions(const string& parameter, Options* file_options, string* error) {
+	vector<pair<string, string> > options;
+	ParseGeneratorParameter(parameter, &options);
+
+	// If the dllexport_decl option is passed to the compiler, we need to write
+	// it in front of every symbol that should be exported if this .proto is
+	// compiled into a Windows DLL.  E.g., if the user invokes the protocol
+	// compiler as:
+	//   protoc --cpp_out=dllexport_decl=FOO_EXPORT:outdir foo.proto
+	// then we'll define classes like this:
+	//   class FOO_EXPORT Foo {
+	//     ...
+	//   }
+	// FOO_EXPORT is a macro which should expand to __declspec(dllexport) or
+	// __declspec(dllimport) depending on what is being compiled.
+	//
+	// If split_luabind is passed, the luabind registration code is written to
+	// foo.pb.luabind.cc instead of foo.pb.h/foo.pb.cc, and foo.pb.h only
+	// forward-declares lua_State.  Code that merely uses the message classes
+	// then no longer has to parse the luabind headers.
+	//
+	// backend=capi replaces the luabind bindings with plain lua_CFunctions
+	// and metatables written against the Lua C API; foo.pb.h then only
+	// forward-declares lua_State as well.  backend=luabind is the default.
+	//
+	// If lua_arena is passed, the message classes allocate themselves from
+	// the calling thread's current protobuf_lua_arena::Arena, if any, and Lua
+	// gets pb.with_arena(fn) to run fn with a fresh arena current.
+	//
+	// lua_pool=N gives every message class a per-thread pool of up to N
+	// cleared instances.  Messages created from Lua are taken from it and go
+	// back to it when collected, keeping the capacity their strings and
+	// repeated fields have grown.
+	//
+	// If lua_lazy is passed, InitLuaBindEnvironment() registers nothing but
+	// an __index on the globals table, which registers a message or enum the
+	// first time a script refers to its name.
+	//
+	// If lua_shards is passed, the plugin also writes one <package>.lua.pb.cc
+	// per package, defining <package>::RegisterPackageToLua(), and an index
+	// lua_packages.pb.h to register packages by name without including their
+	// headers.  Unless lua_lazy is passed too, common.pb.h then registers
+	// through the index and includes none of the .pb.h files.
+	//
+	// layout_profile=PATH reads a field access profile, as dumped by the
+	// field access counters, and lays out the members of each message with
+	// its most used fields first, hottest first, still grouped to avoid
+	// padding.  Fields the profile doesn't count keep their declaration
+	// order behind them.
+	//
+	// If field_counters is passed, every inline field accessor counts its
+	// calls per thread, as a read for const accessors and a write for the
+	// others.  Calls from the message's own parsing, serialization and
+	// merging code are not counted.  protobuf_field_counters::Dump() in
+	// the generated headers, or pb.field_counters() from Lua, returns the
+	// counts in the format layout_profile reads.  This is instrumentation,
+	// not for production.
+	//
+	// cold_fields=N moves the optional scalar and string fields of lite
+	// messages with at least N fields into a separately allocated struct,
+	// created when the first of them is set.  With layout_profile, fields
+	// the profile gives any heat stay in the message.  Messages that have
+	// only a few of many fields set then take a fraction of the memory.
+	//
+	// If table_parser is passed, MergePartialFromCodedStream() no longer
+	// switches over every field: each message gets a table of its fields'
+	// numbers, types, has-bits and accessors, read by one parse loop all the
+	// messages share, and keeps a switch only for the fields the table
+	// can't describe (repeated messages, groups, cold fields, and enums and
+	// UTF-8 checked strings outside the lite runtime).  The generated code
+	// is much smaller, at the price of an indirect call per field.
+	//
+	// If packed_fast_path is passed, fields declared packed are read straight
+	// from the input buffer when the whole run is in it: fixed-size values
+	// go into a RepeatedField reserved once, and varints are counted and
+	// decoded eight bytes at a time.  table_parser always reads packed runs
+	// this way.
+
+	for (int i = 0; i < options.size(); i++) {
+		if (options[i].first == "dllexport_decl") {
+			file_options->dllexport_decl = options[i].second;
+		} else if (options[i].first == "split_luabind") {
+			file_options->split_luabind = true;
+		} else if (options[i].first == "lua_arena") {
+			file_options->lua_arena = true;
+		} else if (options[i].first == "lua_pool") {
+			char* end;
+			long capacity = strtol(options[i].second.c_str(), &end, 10);
+			if (options[i].second.empty() || *end != '\0' ||
+					capacity <= 0 || capacity > 65536) {
+				*error = "lua_pool needs a capacity between 1 and 65536: " +
+					options[i].second;
+				return false;
+			}
+			file_options->lua_pool = static_cast<int>(capacity);
+		} else if (options[i].first == "lua_lazy") {
+			file_options->lua_lazy = true;
+		} else if (options[i].first == "lua_shards") {
+			file_options->lua_shards = true;
+		} else if (options[i].first == "field_counters") {
+			file_options->field_counters = true;
+		} else if (options[i].first == "table_parser") {
+			file_options->table_parser = true;
+		} else if (options[i].first == "packed_fast_path") {
+			file_options->packed_fast_path = true;
+		} else if (options[i].first == "cold_fields") {
+			char* end;
+			long count = strtol(options[i].second.c_str(), &end, 10);
+			if (options[i].second.empty() || *end != '\0' || count <= 0) {
+				*error = "cold_fields needs a positive field count: " +
+					options[i].second;
+				return false;
+			}
+			file_options->cold_fields = static_cast<int>(count);
+		} else if (options[i].first == "layout_profile") {
+			if (options[i].second.empty()) {
+				*error = "layout_profile needs a file.";
+				return false;
+			}
+			file_options->layout_profile = options[i].second;
+			if (!LoadLayoutProfile(options[i].second, &file_options->field_heat, error)) {
+				return false;
+			}
+		} else if (options[i].first == "backend") {
+			if (options[i].second == "luabind") {
+				file_options->lua_backend = Options::LUA_BACKEND_LUABIND;
+			} else if (options[i].second == "capi") {
+				file_options->lua_backend = Options::LUA_BACKEND_CAPI;
+			} else {
+				*error = "Unknown backend: " + options[i].second;
+				return false;
+			}
+		} else {
+			*error = "Unknown generator option: " + options[i].first;
+			return false;
+		}
+	}
+
+	return true;
+}
+
 CppGenerator::CppGenerator() {}
 CppGenerator::~CppGenerator() {}
 
@@ -55,47 +252,21 @@ bool CppGenerator::Generate(const FileDescriptor* file,
 	const string& parameter,
 	GeneratorContext* generator_context,
 	string* error) const {
-		vector<pair<string, string> > options;
-		ParseGeneratorParameter(parameter, &options);
-
-		// -----------------------------------------------------------------
-		// parse generator options
-
-		// TODO(kenton):  If we ever have more options, we may want to create a
-		//   class that encapsulates them which we can pass down to all the
-		//   generator classes.  Currently we pass dllexport_decl down to all of
-		//   them via the constructors, but we don't want to have to add another
-		//   constructor parameter for every option.
-
-		// If the dllexport_decl option is passed to the compiler, we need to write
-		// it in front of every symbol that should be exported if this .proto is
-		// compiled into a Windows DLL.  E.g., if the user invokes the protocol
-		// compiler as:
-		//   protoc --cpp_out=dllexport_decl=FOO_EXPORT:outdir foo.proto
-		// then we'll define classes like this:
-		//   class FOO_EXPORT Foo {
-		//     ...
-		//   }
-		// FOO_EXPORT is a macro which should expand to __declspec(dllexport) or
-		// __declspec(dllimport) depending on what is being compiled.
-		string dllexport_decl;
-
-		for (int i = 0; i < options.size(); i++) {
-			if (options[i].first == "dllexport_decl") {
-				dllexport_decl = options[i].second;
-			} else {
-				*error = "Unknown generator option: " + options[i].first;
-				return false;
-			}
+		Options file_options;
+		if (!ParseOptions(parameter, &file_options, error)) {
+			return false;
 		}
+		return Generate(file, file_options, generator_context, error);
+}
 
-		// -----------------------------------------------------------------
-
-
+bool CppGenerator::Generate(const FileDescriptor* file,
+	const Options& file_options,
+	GeneratorContext* generator_context,
+	string* error) const {
 		string basename = StripProto(file->name());
 		basename.append(".pb");  
 
-		FileGenerator file_generator(file, dllexport_decl);
+		FileGenerator file_generator(file, file_options);
 
 		// Generate header.
 		{
@@ -113,6 +284,14 @@ bool CppGenerator::Generate(const FileDescriptor* file,
 			file_generator.GenerateSource(&printer);
 		}
 
+		// Generate luabind registration.
+		if (file_options.split_luabind) {
+			scoped_ptr<io::ZeroCopyOutputStream> output(
+				generator_context->Open(basename + ".luabind.cc"));
+			io::Printer printer(output.get(), '$');
+			file_generator.GenerateLuaBindSource(&printer);
+		}
+
 		return true;
 }
 
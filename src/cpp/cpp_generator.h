@@ -45,6 +45,8 @@ namespace protobuf {
 namespace compiler {
 namespace cpp {
 
+struct Options;
+
 // CodeGenerator implementation which generates a C++ source file and
 // header.  If you create your own protocol compiler binary and you want
 // it to support C++ output, you can do so by registering an instance of this
@@ -60,6 +62,14 @@ public:
 		GeneratorContext* generator_context,
 		string* error) const;
 
+	// Same, with |options| already parsed from the parameter.  The plugin
+	// parses them once per request instead of reloading the layout_profile
+	// for every file.
+	bool Generate(const FileDescriptor* file,
+		const Options& options,
+		GeneratorContext* generator_context,
+		string* error) const;
+
 private:
 	GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(CppGenerator);
 };
@@ -0,0 +1,33 @@
+// Runs the Lua script named on the command line against the bindings of
+// cpp_test_lua.proto and cpp_test_all_types.proto generated with
+// backend=capi.  The script fails the test by raising an error.
+
+#include <stdio.h>
+
+extern "C" {
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+}
+
+#include "cpp_test_all_types.pb.h"
+#include "cpp_test_lua.pb.h"
+
+int main(int argc, char* argv[]) {
+  if (argc != 2) {
+    fprintf(stderr, "Usage: %s SCRIPT\n", argv[0]);
+    return 2;
+  }
+
+  lua_State* L = luaL_newstate();
+  luaL_openlibs(L);
+  protobuf_unittest::cpp_test_all_types_RegisterToLua(L);
+  protobuf_unittest::cpp_test_lua_RegisterToLua(L);
+  int result = 0;
+  if (luaL_dofile(L, argv[1]) != 0) {
+    fprintf(stderr, "%s: %s\n", argv[1], lua_tostring(L, -1));
+    result = 1;
+  }
+  lua_close(L);
+  return result;
+}
@@ -66,35 +66,6 @@ void PrintFieldComment(io::Printer* printer, const FieldDescriptor* field) {
     "def", def.substr(0, def.find_first_of('\n')));
 }
 
-struct FieldOrderingByNumber {
-  inline bool operator()(const FieldDescriptor* a,
-                         const FieldDescriptor* b) const {
-    return a->number() < b->number();
-  }
-};
-
-const char* kWireTypeNames[] = {
-  "VARINT",
-  "FIXED64",
-  "LENGTH_DELIMITED",
-  "START_GROUP",
-  "END_GROUP",
-  "FIXED32",
-};
-
-// Sort the fields of the given Descriptor by number into a new[]'d array
-// and return it.
-const FieldDescriptor** SortFieldsByNumber(const Descriptor* descriptor) {
-  const FieldDescriptor** fields =
-    new const FieldDescriptor*[descriptor->field_count()];
-  for (int i = 0; i < descriptor->field_count(); i++) {
-    fields[i] = descriptor->field(i);
-  }
-  sort(fields, fields + descriptor->field_count(),
-       FieldOrderingByNumber());
-  return fields;
-}
-
 // Functor for sorting extension ranges by their "start" field number.
 struct ExtensionRangeSorter {
   bool operator()(const Descriptor::ExtensionRange* left,
@@ -219,11 +190,82 @@ class FieldGroup {
   // used in a vector.
 };
 
+// Returns true if any field of the message type is a cold field.
+bool HasColdFields(const Descriptor* descriptor, const Options& options) {
+  for (int i = 0; i < descriptor->field_count(); i++) {
+    if (IsColdField(descriptor->field(i), options)) return true;
+  }
+  return false;
+}
+
+// Returns true if the shared parse loop of table_parser reads 'field'; the
+// message's own MergePartialFromCodedStream() parses the others.
+bool IsTableParsedField(const FieldDescriptor* field, const Options& options) {
+  // Cold fields aren't members of the message itself.
+  if (IsColdField(field, options)) return false;
+
+  switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_ENUM:
+      // Invalid values go to the unknown fields, which the loop can't reach.
+      return !HasUnknownFields(field->file());
+    case FieldDescriptor::CPPTYPE_STRING:
+      return field->type() == FieldDescriptor::TYPE_BYTES ||
+             !HasUtf8Verification(field->file());
+    case FieldDescriptor::CPPTYPE_MESSAGE:
+      // A RepeatedPtrField can only add elements of its static type.
+      return !field->is_repeated() &&
+             field->type() == FieldDescriptor::TYPE_MESSAGE;
+    default:
+      return true;
+  }
+}
+
+// Returns true if the message type gets a _parse_table_.
+bool UseTableParser(const Descriptor* descriptor, const Options& options) {
+  if (!options.table_parser || !HasGeneratedMethods(descriptor->file()) ||
+      descriptor->options().message_set_wire_format()) {
+    return false;
+  }
+  for (int i = 0; i < descriptor->field_count(); i++) {
+    if (IsTableParsedField(descriptor->field(i), options)) return true;
+  }
+  return false;
+}
+
+// Returns the heat the layout profile gives 'field', 0 if it has none.
+double FieldHeat(const map<string, double>& heat, const FieldDescriptor* field) {
+  map<string, double>::const_iterator it = heat.find(field->full_name());
+  return it == heat.end() ? 0 : it->second;
+}
+
+// Functor for sorting fields hottest first.
+struct HotterField {
+  explicit HotterField(const map<string, double>& heat) : heat_(heat) {}
+
+  bool operator()(const FieldDescriptor* left,
+                  const FieldDescriptor* right) const {
+    return FieldHeat(heat_, left) > FieldHeat(heat_, right);
+  }
+
+ private:
+  const map<string, double>& heat_;
+};
+
 // Reorder 'fields' so that if the fields are output into a c++ class in the new
 // order, the alignment padding is minimized.  We try to do this while keeping
 // each field as close as possible to its original position so that we don't
 // reduce cache locality much for function that access each field in order.
-void OptimizePadding(vector<const FieldDescriptor*>* fields) {
+//
+// If 'heat' has a layout profile, the "original position" is that of the
+// fields sorted hottest first, so that the fields used most share the first
+// cache lines of the object.  Fields with no heat stay in declaration order
+// behind them.
+void OptimizePadding(vector<const FieldDescriptor*>* fields,
+                     const map<string, double>& heat) {
+  if (!heat.empty()) {
+    stable_sort(fields->begin(), fields->end(), HotterField(heat));
+  }
+
   // First divide fields into those that align to 1 byte, 4 bytes or 8 bytes.
   vector<FieldGroup> aligned_to_1, aligned_to_4, aligned_to_8;
   for (int i = 0; i < fields->size(); ++i) {
@@ -280,11 +322,11 @@ void OptimizePadding(vector<const FieldDescriptor*>* fields) {
 // ===================================================================
 
 MessageGenerator::MessageGenerator(const Descriptor* descriptor,
-                                   const string& dllexport_decl)
+                                   const Options& options)
   : descriptor_(descriptor),
     classname_(ClassName(descriptor, false)),
-    dllexport_decl_(dllexport_decl),
-    field_generators_(descriptor),
+    options_(options),
+    field_generators_(descriptor, options),
     nested_generators_(new scoped_ptr<MessageGenerator>[
       descriptor->nested_type_count()]),
     enum_generators_(new scoped_ptr<EnumGenerator>[
@@ -294,17 +336,17 @@ MessageGenerator::MessageGenerator(const Descriptor* descriptor,
 
   for (int i = 0; i < descriptor->nested_type_count(); i++) {
     nested_generators_[i].reset(
-      new MessageGenerator(descriptor->nested_type(i), dllexport_decl));
+      new MessageGenerator(descriptor->nested_type(i), options));
   }
 
   for (int i = 0; i < descriptor->enum_type_count(); i++) {
     enum_generators_[i].reset(
-      new EnumGenerator(descriptor->enum_type(i), dllexport_decl));
+      new EnumGenerator(descriptor->enum_type(i), options));
   }
 
   for (int i = 0; i < descriptor->extension_count(); i++) {
     extension_generators_[i].reset(
-      new ExtensionGenerator(descriptor->extension(i), dllexport_decl));
+      new ExtensionGenerator(descriptor->extension(i), options));
   }
 }
 
@@ -380,6 +422,8 @@ void MessageGenerator::
 GenerateFieldAccessorDefinitions(io::Printer* printer) {
   printer->Print("// $classname$\n\n", "classname", classname_);
 
+  GenerateFieldCountsAccessor(printer);
+
   for (int i = 0; i < descriptor_->field_count(); i++) {
     const FieldDescriptor* field = descriptor_->field(i);
 
@@ -387,11 +431,13 @@ GenerateFieldAccessorDefinitions(io::Printer* printer) {
 
     map<string, string> vars;
     SetCommonFieldVariables(field, &vars);
+    SetGeneratorOptionVariables(field, options_, &vars);
 
     // Generate has_$name$() or $name$_size().
     if (field->is_repeated()) {
       printer->Print(vars,
         "inline int $classname$::$name$_size() const {\n"
+        "$count_read$"
         "  return $name$_.size();\n"
         "}\n");
     } else {
@@ -401,6 +447,7 @@ GenerateFieldAccessorDefinitions(io::Printer* printer) {
       vars["has_mask"] = FastHex32ToBuffer(1u << (field->index() % 32), buffer);
       printer->Print(vars,
         "inline bool $classname$::has_$name$() const {\n"
+        "$count_read$"
         "  return (_has_bits_[$has_array_index$] & 0x$has_mask$u) != 0;\n"
         "}\n"
         "inline void $classname$::set_has_$name$() {\n"
@@ -414,11 +461,18 @@ GenerateFieldAccessorDefinitions(io::Printer* printer) {
 
     // Generate clear_$name$()
     printer->Print(vars,
-      "inline void $classname$::clear_$name$() {\n");
+      "inline void $classname$::clear_$name$() {\n"
+      "$count_write$");
 
-    printer->Indent();
-    field_generators_.get(field).GenerateClearingCode(printer);
-    printer->Outdent();
+    if (IsColdField(field, options_)) {
+      // The member lives in ColdFields_, which may not be allocated yet.
+      printer->Print(vars,
+        "  if (_cold_fields_ != NULL) _cold_fields_->clear_$name$();\n");
+    } else {
+      printer->Indent();
+      field_generators_.get(field).GenerateClearingCode(printer);
+      printer->Outdent();
+    }
 
     if (!field->is_repeated()) {
       printer->Print(vars,
@@ -446,10 +500,10 @@ GenerateClassDefinition(io::Printer* printer) {
   map<string, string> vars;
   vars["classname"] = classname_;
   vars["field_count"] = SimpleItoa(descriptor_->field_count());
-  if (dllexport_decl_.empty()) {
+  if (options_.dllexport_decl.empty()) {
     vars["dllexport"] = "";
   } else {
-    vars["dllexport"] = dllexport_decl_ + " ";
+    vars["dllexport"] = options_.dllexport_decl + " ";
   }
   vars["superclass"] = SuperClassName(descriptor_);
 
@@ -624,13 +678,60 @@ GenerateClassDefinition(io::Printer* printer) {
       "\n");
   }
 
+  // Cold fields live in ColdFields_, allocated when the first of them is
+  // set.  Until then they are read from the default instance's.
+  vector<const FieldDescriptor*> cold_fields;
+  for (int i = 0; i < descriptor_->field_count(); i++) {
+    if (IsColdField(descriptor_->field(i), options_)) {
+      cold_fields.push_back(descriptor_->field(i));
+    }
+  }
+  if (!cold_fields.empty()) {
+    printer->Print(
+      "struct ColdFields_ {\n"
+      "  ColdFields_();\n"
+      "  ~ColdFields_();\n"
+      "  void Clear();\n"
+      "\n");
+    printer->Indent();
+    OptimizePadding(&cold_fields, options_.field_heat);
+    for (int i = 0; i < cold_fields.size(); ++i) {
+      field_generators_.get(cold_fields[i]).GeneratePrivateMembers(printer);
+    }
+    printer->Print("\n");
+    for (int i = 0; i < cold_fields.size(); ++i) {
+      printer->Print("void clear_$name$() {\n",
+                     "name", FieldName(cold_fields[i]));
+      printer->Indent();
+      field_generators_.get(cold_fields[i]).GenerateClearingCode(printer);
+      printer->Outdent();
+      printer->Print("}\n");
+    }
+    printer->Outdent();
+    printer->Print(
+      "};\n"
+      "const ColdFields_& _cold_fields() const {\n"
+      "  return _cold_fields_ != NULL ? *_cold_fields_\n"
+      "                               : *default_instance_->_cold_fields_;\n"
+      "}\n"
+      "ColdFields_* _mutable_cold_fields() {\n"
+      "  if (_cold_fields_ == NULL) _cold_fields_ = new ColdFields_;\n"
+      "  return _cold_fields_;\n"
+      "}\n"
+      "\n"
+      "ColdFields_* _cold_fields_;\n"
+      "\n");
+  }
+
   // Field members:
 
   vector<const FieldDescriptor*> fields;
   for (int i = 0; i < descriptor_->field_count(); i++) {
-    fields.push_back(descriptor_->field(i));
+    if (!IsColdField(descriptor_->field(i), options_)) {
+      fields.push_back(descriptor_->field(i));
+    }
   }
-  OptimizePadding(&fields);
+  OptimizePadding(&fields, options_.field_heat);
   for (int i = 0; i < fields.size(); ++i) {
     field_generators_.get(fields[i]).GeneratePrivateMembers(printer);
   }
@@ -657,12 +758,21 @@ GenerateClassDefinition(io::Printer* printer) {
       "\n");
   }
 
+  if (UseTableParser(descriptor_, options_)) {
+    printer->Print(
+      "template <int kNumber>\n"
+      "static void* _parse_member_(::google::protobuf::MessageLite* message);\n"
+      "static const ::protobuf_table_parser::Field _parse_fields_[];\n"
+      "static const ::protobuf_table_parser::Table _parse_table_;\n"
+      "\n");
+  }
+
   // Declare AddDescriptors(), BuildDescriptors(), and ShutdownFile() as
   // friends so that they can access private static variables like
   // default_instance_ and reflection_.
   printer->Print(
     "friend void $dllexport_decl$ $adddescriptorsname$();\n",
-    "dllexport_decl", dllexport_decl_,
+    "dllexport_decl", options_.dllexport_decl,
     "adddescriptorsname",
       GlobalAddDescriptorsName(descriptor_->file()->name()));
   printer->Print(
@@ -875,6 +985,8 @@ GenerateClassMethods(io::Printer* printer) {
   GenerateStructors(printer);
   printer->Print("\n");
 
+  GenerateFieldCountsRegistration(printer);
+
   if (HasGeneratedMethods(descriptor_->file())) {
     GenerateClear(printer);
     printer->Print("\n");
@@ -927,7 +1039,10 @@ GenerateClassMethods(io::Printer* printer) {
       "type_name", descriptor_->full_name());
   }
 
-  GenerateLuaBindMethods(printer);
+  if (!options_.split_luabind &&
+      options_.lua_backend == Options::LUA_BACKEND_LUABIND) {
+    GenerateLuaBindMethods(printer);
+  }
 }
 
 void MessageGenerator::
@@ -961,8 +1076,13 @@ GenerateSharedConstructorCode(io::Printer* printer) {
     "_cached_size_ = 0;\n");
 
   for (int i = 0; i < descriptor_->field_count(); i++) {
-    field_generators_.get(descriptor_->field(i))
-                     .GenerateConstructorCode(printer);
+    if (!IsColdField(descriptor_->field(i), options_)) {
+      field_generators_.get(descriptor_->field(i))
+                       .GenerateConstructorCode(printer);
+    }
+  }
+  if (HasColdFields(descriptor_, options_)) {
+    printer->Print("_cold_fields_ = NULL;\n");
   }
 
   printer->Print(
@@ -980,8 +1100,13 @@ GenerateSharedDestructorCode(io::Printer* printer) {
   printer->Indent();
   // Write the destructors for each field.
   for (int i = 0; i < descriptor_->field_count(); i++) {
-    field_generators_.get(descriptor_->field(i))
-                     .GenerateDestructorCode(printer);
+    if (!IsColdField(descriptor_->field(i), options_)) {
+      field_generators_.get(descriptor_->field(i))
+                       .GenerateDestructorCode(printer);
+    }
+  }
+  if (HasColdFields(descriptor_, options_)) {
+    printer->Print("delete _cold_fields_;\n");
   }
 
   printer->Print(
@@ -1008,6 +1133,52 @@ GenerateSharedDestructorCode(io::Printer* printer) {
     "\n");
 }
 
+void MessageGenerator::
+GenerateColdFieldsMethods(io::Printer* printer) {
+  if (!HasColdFields(descriptor_, options_)) return;
+
+  vector<const FieldDescriptor*> cold_fields;
+  for (int i = 0; i < descriptor_->field_count(); i++) {
+    if (IsColdField(descriptor_->field(i), options_)) {
+      cold_fields.push_back(descriptor_->field(i));
+    }
+  }
+
+  // The field generators' member code refers to the ColdFields_ members
+  // just as it does to the message's own.
+  printer->Print(
+    "$classname$::ColdFields_::ColdFields_() {\n",
+    "classname", classname_);
+  printer->Indent();
+  for (int i = 0; i < cold_fields.size(); i++) {
+    field_generators_.get(cold_fields[i]).GenerateConstructorCode(printer);
+  }
+  printer->Outdent();
+  printer->Print(
+    "}\n"
+    "\n"
+    "$classname$::ColdFields_::~ColdFields_() {\n",
+    "classname", classname_);
+  printer->Indent();
+  for (int i = 0; i < cold_fields.size(); i++) {
+    field_generators_.get(cold_fields[i]).GenerateDestructorCode(printer);
+  }
+  printer->Outdent();
+  printer->Print(
+    "}\n"
+    "\n"
+    "void $classname$::ColdFields_::Clear() {\n",
+    "classname", classname_);
+  printer->Indent();
+  for (int i = 0; i < cold_fields.size(); i++) {
+    field_generators_.get(cold_fields[i]).GenerateClearingCode(printer);
+  }
+  printer->Outdent();
+  printer->Print(
+    "}\n"
+    "\n");
+}
+
 void MessageGenerator::
 GenerateStructors(io::Printer* printer) {
   string superclass = SuperClassName(descriptor_);
@@ -1043,6 +1214,11 @@ GenerateStructors(io::Printer* printer) {
           "type", FieldMessageTypeName(field));
     }
   }
+  // Messages without their own ColdFields_ read the default instance's.
+  if (HasColdFields(descriptor_, options_)) {
+    printer->Print(
+      "  _cold_fields_ = new ColdFields_;\n");
+  }
   printer->Print(
     "}\n"
     "\n");
@@ -1072,6 +1248,8 @@ GenerateStructors(io::Printer* printer) {
   // Generate the shared destructor code.
   GenerateSharedDestructorCode(printer);
 
+  GenerateColdFieldsMethods(printer);
+
   // Generate SetCachedSize.
   printer->Print(
     "void $classname$::SetCachedSize(int size) const {\n"
@@ -1110,6 +1288,7 @@ GenerateStructors(io::Printer* printer) {
     "adddescriptorsname",
     GlobalAddDescriptorsName(descriptor_->file()->name()));
 
+  GenerateLuaPool(printer);
 }
 
 void MessageGenerator::
@@ -1117,6 +1296,7 @@ GenerateClear(io::Printer* printer) {
   printer->Print("void $classname$::Clear() {\n",
                  "classname", classname_);
   printer->Indent();
+  GenerateFieldCountsScope(printer);
 
   int last_index = -1;
 
@@ -1127,7 +1307,7 @@ GenerateClear(io::Printer* printer) {
   for (int i = 0; i < descriptor_->field_count(); i++) {
     const FieldDescriptor* field = descriptor_->field(i);
 
-    if (!field->is_repeated()) {
+    if (!field->is_repeated() && !IsColdField(field, options_)) {
       // We can use the fact that _has_bits_ is a giant bitfield to our
       // advantage:  We can check up to 32 bits at a time for equality to
       // zero, and skip the whole range if so.  This can improve the speed
@@ -1184,6 +1364,12 @@ GenerateClear(io::Printer* printer) {
     }
   }
 
+  // Cold fields are cleared in place, so the message keeps its ColdFields_.
+  if (HasColdFields(descriptor_, options_)) {
+    printer->Print(
+      "if (_cold_fields_ != NULL) _cold_fields_->Clear();\n");
+  }
+
   printer->Print(
     "::memset(_has_bits_, 0, sizeof(_has_bits_));\n");
 
@@ -1208,7 +1394,12 @@ GenerateSwap(io::Printer* printer) {
   if (HasGeneratedMethods(descriptor_->file())) {
     for (int i = 0; i < descriptor_->field_count(); i++) {
       const FieldDescriptor* field = descriptor_->field(i);
-      field_generators_.get(field).GenerateSwappingCode(printer);
+      if (!IsColdField(field, options_)) {
+        field_generators_.get(field).GenerateSwappingCode(printer);
+      }
+    }
+    if (HasColdFields(descriptor_, options_)) {
+      printer->Print("std::swap(_cold_fields_, other->_cold_fields_);\n");
     }
 
     for (int i = 0; i < (descriptor_->field_count() + 31) / 32; ++i) {
@@ -1278,6 +1469,7 @@ GenerateMergeFrom(io::Printer* printer) {
     "  GOOGLE_CHECK_NE(&from, this);\n",
     "classname", classname_);
   printer->Indent();
+  GenerateFieldCountsScope(printer);
 
   // Merge Repeated fields. These fields do not require a
   // check as we can simply iterate over them.
@@ -1374,6 +1566,83 @@ GenerateCopyFrom(io::Printer* printer) {
   printer->Print("}\n");
 }
 
+void MessageGenerator::
+GenerateParseTable(io::Printer* printer) {
+  scoped_array<const FieldDescriptor*> ordered_fields(
+    SortFieldsByNumber(descriptor_));
+
+  // The loop looks fields up by number, so the table is sorted by it.
+  vector<const FieldDescriptor*> fields;
+  for (int i = 0; i < descriptor_->field_count(); i++) {
+    if (IsTableParsedField(ordered_fields[i], options_)) {
+      fields.push_back(ordered_fields[i]);
+    }
+  }
+
+  // One _parse_member_<number>() per field.  Strings and messages go
+  // through their mutable_ and add_ accessors, which allocate them and
+  // set their has-bits.
+  for (int i = 0; i < fields.size(); i++) {
+    const FieldDescriptor* field = fields[i];
+    map<string, string> vars;
+    vars["classname"] = classname_;
+    vars["name"] = FieldName(field);
+    vars["number"] = SimpleItoa(field->number());
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+      vars["member"] =
+        "static_cast< ::google::protobuf::MessageLite*>(\n"
+        "    static_cast<" + classname_ + "*>(message)->mutable_" +
+        vars["name"] + "())";
+    } else if (field->cpp_type() == FieldDescriptor::CPPTYPE_STRING) {
+      vars["member"] = "static_cast<" + classname_ + "*>(message)->" +
+        (field->is_repeated() ? "add_" : "mutable_") + vars["name"] + "()";
+    } else {
+      vars["member"] =
+        "&static_cast<" + classname_ + "*>(message)->" + vars["name"] + "_";
+    }
+    printer->Print(vars,
+      "template <>\n"
+      "void* $classname$::_parse_member_<$number$>(\n"
+      "    ::google::protobuf::MessageLite* message) {\n"
+      "  return $member$;\n"
+      "}\n"
+      "\n");
+  }
+
+  printer->Print(
+    "const ::protobuf_table_parser::Field $classname$::_parse_fields_[] = {\n",
+    "classname", classname_);
+  printer->Indent();
+  for (int i = 0; i < fields.size(); i++) {
+    const FieldDescriptor* field = fields[i];
+    map<string, string> vars;
+    vars["classname"] = classname_;
+    vars["number"] = SimpleItoa(field->number());
+    vars["type"] = FieldDescriptorProto_Type_Name(
+        static_cast<FieldDescriptorProto_Type>(field->type()));
+    vars["repeated"] = field->is_repeated() ? "true" : "false";
+    vars["has_bit"] = SimpleItoa(field->is_repeated() ? 0 : field->index());
+    vars["is_valid"] = "NULL";
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_ENUM) {
+      vars["is_valid"] = "&" + ClassName(field->enum_type(), true) + "_IsValid";
+    }
+    printer->Print(vars,
+      "{ $number$, ::google::protobuf::internal::WireFormatLite::$type$, "
+        "$repeated$, $has_bit$,\n"
+      "  &_parse_member_<$number$>, $is_valid$ },\n");
+  }
+  printer->Outdent();
+  printer->Print(
+    "};\n"
+    "\n"
+    "const ::protobuf_table_parser::Table $classname$::_parse_table_ = {\n"
+    "  _parse_fields_, $field_count$\n"
+    "};\n"
+    "\n",
+    "classname", classname_,
+    "field_count", SimpleItoa(static_cast<int>(fields.size())));
+}
+
 void MessageGenerator::
 GenerateMergeFromCodedStream(io::Printer* printer) {
   if (descriptor_->options().message_set_wire_format()) {
@@ -1388,18 +1657,44 @@ GenerateMergeFromCodedStream(io::Printer* printer) {
     return;
   }
 
+  // With a parse table, the switch below only handles the fields the table
+  // leaves out.
+  bool table = UseTableParser(descriptor_, options_);
+  scoped_array<const FieldDescriptor*> ordered_fields(
+    SortFieldsByNumber(descriptor_));
+  vector<const FieldDescriptor*> switch_fields;
+  for (int i = 0; i < descriptor_->field_count(); i++) {
+    if (!table || !IsTableParsedField(ordered_fields[i], options_)) {
+      switch_fields.push_back(ordered_fields[i]);
+    }
+  }
+
+  if (table) {
+    GenerateParseTable(printer);
+  }
   printer->Print(
     "bool $classname$::MergePartialFromCodedStream(\n"
     "    ::google::protobuf::io::CodedInputStream* input) {\n"
-    "#define DO_(EXPRESSION) if (!(EXPRESSION)) return false\n"
-    "  ::google::protobuf::uint32 tag;\n"
-    "  while ((tag = input->ReadTag()) != 0) {\n",
+    "#define DO_(EXPRESSION) if (!(EXPRESSION)) return false\n",
     "classname", classname_);
-
   printer->Indent();
+  GenerateFieldCountsScope(printer);
+  if (table) {
+    printer->Print(
+      "::google::protobuf::uint32 tag;\n"
+      "for (;;) {\n"
+      "  DO_(::protobuf_table_parser::Parse(\n"
+      "        this, _has_bits_, _parse_table_, input, &tag));\n"
+      "  if (tag == 0) return true;\n");
+  } else {
+    printer->Print(
+      "::google::protobuf::uint32 tag;\n"
+      "while ((tag = input->ReadTag()) != 0) {\n");
+  }
+
   printer->Indent();
 
-  if (descriptor_->field_count() > 0) {
+  if (!switch_fields.empty()) {
     // We don't even want to print the switch() if we have no fields because
     // MSVC dislikes switch() statements that contain only a default value.
 
@@ -1413,11 +1708,8 @@ GenerateMergeFromCodedStream(io::Printer* printer) {
 
     printer->Indent();
 
-    scoped_array<const FieldDescriptor*> ordered_fields(
-      SortFieldsByNumber(descriptor_));
-
-    for (int i = 0; i < descriptor_->field_count(); i++) {
-      const FieldDescriptor* field = ordered_fields[i];
+    for (int i = 0; i < switch_fields.size(); i++) {
+      const FieldDescriptor* field = switch_fields[i];
 
       PrintFieldComment(printer, field);
 
@@ -1433,7 +1725,8 @@ GenerateMergeFromCodedStream(io::Printer* printer) {
         "    ::google::protobuf::internal::WireFormatLite::WIRETYPE_$wiretype$) {\n",
         "wiretype", kWireTypeNames[WireFormat::WireTypeForField(field)]);
 
-      if (i > 0 || (field->is_repeated() && !field->options().packed())) {
+      if (!table &&
+          (i > 0 || (field->is_repeated() && !field->options().packed()))) {
         printer->Print(
           " parse_$name$:\n",
           "name", field->name());
@@ -1474,27 +1767,30 @@ GenerateMergeFromCodedStream(io::Printer* printer) {
         "}\n");
 
       // switch() is slow since it can't be predicted well.  Insert some if()s
-      // here that attempt to predict the next tag.
-      if (field->is_repeated() && !field->options().packed()) {
-        // Expect repeats of this field.
-        printer->Print(
-          "if (input->ExpectTag($tag$)) goto parse_$name$;\n",
-          "tag", SimpleItoa(WireFormat::MakeTag(field)),
-          "name", field->name());
-      }
+      // here that attempt to predict the next tag.  Behind a parse table,
+      // the next tag goes to the table first anyway.
+      if (!table) {
+        if (field->is_repeated() && !field->options().packed()) {
+          // Expect repeats of this field.
+          printer->Print(
+            "if (input->ExpectTag($tag$)) goto parse_$name$;\n",
+            "tag", SimpleItoa(WireFormat::MakeTag(field)),
+            "name", field->name());
+        }
 
-      if (i + 1 < descriptor_->field_count()) {
-        // Expect the next field in order.
-        const FieldDescriptor* next_field = ordered_fields[i + 1];
-        printer->Print(
-          "if (input->ExpectTag($next_tag$)) goto parse_$next_name$;\n",
-          "next_tag", SimpleItoa(WireFormat::MakeTag(next_field)),
-          "next_name", next_field->name());
-      } else {
-        // Expect EOF.
-        // TODO(kenton):  Expect group end-tag?
-        printer->Print(
-          "if (input->ExpectAtEnd()) return true;\n");
+        if (i + 1 < switch_fields.size()) {
+          // Expect the next field in order.
+          const FieldDescriptor* next_field = switch_fields[i + 1];
+          printer->Print(
+            "if (input->ExpectTag($next_tag$)) goto parse_$next_name$;\n",
+            "next_tag", SimpleItoa(WireFormat::MakeTag(next_field)),
+            "next_name", next_field->name());
+        } else {
+          // Expect EOF.
+          // TODO(kenton):  Expect group end-tag?
+          printer->Print(
+            "if (input->ExpectAtEnd()) return true;\n");
+        }
       }
 
       printer->Print(
@@ -1566,7 +1862,7 @@ GenerateMergeFromCodedStream(io::Printer* printer) {
       "DO_(::google::protobuf::internal::WireFormatLite::SkipField(input, tag));\n");
   }
 
-  if (descriptor_->field_count() > 0) {
+  if (!switch_fields.empty()) {
     printer->Print("break;\n");
     printer->Outdent();
     printer->Print("}\n");    // default:
@@ -1651,6 +1947,7 @@ GenerateSerializeWithCachedSizes(io::Printer* printer) {
     "    ::google::protobuf::io::CodedOutputStream* output) const {\n",
     "classname", classname_);
   printer->Indent();
+  GenerateFieldCountsScope(printer);
 
   GenerateSerializeWithCachedSizesBody(printer, false);
 
@@ -1686,6 +1983,7 @@ GenerateSerializeWithCachedSizesToArray(io::Printer* printer) {
     "    ::google::protobuf::uint8* target) const {\n",
     "classname", classname_);
   printer->Indent();
+  GenerateFieldCountsScope(printer);
 
   GenerateSerializeWithCachedSizesBody(printer, true);
 
@@ -1773,6 +2071,7 @@ GenerateByteSize(io::Printer* printer) {
     "int $classname$::ByteSize() const {\n",
     "classname", classname_);
   printer->Indent();
+  GenerateFieldCountsScope(printer);
   printer->Print(
     "int total_size = 0;\n"
     "\n");
@@ -1870,6 +2169,7 @@ GenerateIsInitialized(io::Printer* printer) {
     "bool $classname$::IsInitialized() const {\n",
     "classname", classname_);
   printer->Indent();
+  GenerateFieldCountsScope(printer);
 
   // Check that all required fields in this message are set.  We can do this
   // most efficiently by checking 32 "has bits" at a time.
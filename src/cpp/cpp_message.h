@@ -38,6 +38,7 @@
 #include <string>
 #include <google/protobuf/stubs/common.h>
 #include "cpp/cpp_field.h"
+#include "cpp/cpp_options.h"
 
 #include "cpp_patch.h"
 
@@ -59,7 +60,7 @@ class MessageGenerator {
  public:
   // See generator.cc for the meaning of dllexport_decl.
   explicit MessageGenerator(const Descriptor* descriptor,
-                            const string& dllexport_decl);
+                            const Options& options);
   ~MessageGenerator();
 
   // Header stuff.
@@ -132,6 +133,13 @@ class MessageGenerator {
   void GenerateSharedConstructorCode(io::Printer* printer);
   // Generate the shared destructor code.
   void GenerateSharedDestructorCode(io::Printer* printer);
+  // Generate the constructor, destructor and Clear() of ColdFields_, which
+  // holds the fields IsColdField() selects.
+  void GenerateColdFieldsMethods(io::Printer* printer);
+
+  // Generate _parse_member_<number>() for every field the table_parser
+  // loop reads, and _parse_fields_ and _parse_table_, which describe them.
+  void GenerateParseTable(io::Printer* printer);
 
   // Generate standard Message methods.
   void GenerateClear(io::Printer* printer);
@@ -157,7 +165,7 @@ class MessageGenerator {
 
   const Descriptor* descriptor_;
   string classname_;
-  string dllexport_decl_;
+  const Options& options_;
   FieldGeneratorMap field_generators_;
   scoped_array<scoped_ptr<MessageGenerator> > nested_generators_;
   scoped_array<scoped_ptr<EnumGenerator> > enum_generators_;
@@ -59,9 +59,11 @@ void SetMessageVariables(const FieldDescriptor* descriptor,
 // ===================================================================
 
 MessageFieldGenerator::
-MessageFieldGenerator(const FieldDescriptor* descriptor)
+MessageFieldGenerator(const FieldDescriptor* descriptor,
+                      const Options& options)
   : descriptor_(descriptor) {
   SetMessageVariables(descriptor, &variables_);
+  SetGeneratorOptionVariables(descriptor, options, &variables_);
 }
 
 MessageFieldGenerator::~MessageFieldGenerator() {}
@@ -83,14 +85,17 @@ void MessageFieldGenerator::
 GenerateInlineAccessorDefinitions(io::Printer* printer) const {
   printer->Print(variables_,
     "inline const $type$& $classname$::$name$() const {\n"
+    "$count_read$"
     "  return $name$_ != NULL ? *$name$_ : *default_instance_->$name$_;\n"
     "}\n"
     "inline $type$* $classname$::mutable_$name$() {\n"
+    "$count_write$"
     "  set_has_$name$();\n"
     "  if ($name$_ == NULL) $name$_ = new $type$;\n"
     "  return $name$_;\n"
     "}\n"
     "inline $type$* $classname$::release_$name$() {\n"
+    "$count_write$"
     "  clear_has_$name$();\n"
     "  $type$* temp = $name$_;\n"
     "  $name$_ = NULL;\n"
@@ -159,9 +164,11 @@ GenerateByteSize(io::Printer* printer) const {
 // ===================================================================
 
 RepeatedMessageFieldGenerator::
-RepeatedMessageFieldGenerator(const FieldDescriptor* descriptor)
+RepeatedMessageFieldGenerator(const FieldDescriptor* descriptor,
+                              const Options& options)
   : descriptor_(descriptor) {
   SetMessageVariables(descriptor, &variables_);
+  SetGeneratorOptionVariables(descriptor, options, &variables_);
 }
 
 RepeatedMessageFieldGenerator::~RepeatedMessageFieldGenerator() {}
@@ -189,21 +196,26 @@ void RepeatedMessageFieldGenerator::
 GenerateInlineAccessorDefinitions(io::Printer* printer) const {
   printer->Print(variables_,
     "inline const $type$& $classname$::$name$(int index) const {\n"
+    "$count_read$"
     "  return $name$_.Get(index);\n"
     "}\n"
     "inline $type$* $classname$::mutable_$name$(int index) {\n"
+    "$count_write$"
     "  return $name$_.Mutable(index);\n"
     "}\n"
     "inline $type$* $classname$::add_$name$() {\n"
+    "$count_write$"
     "  return $name$_.Add();\n"
     "}\n");
   printer->Print(variables_,
     "inline const ::google::protobuf::RepeatedPtrField< $type$ >&\n"
     "$classname$::$name$() const {\n"
+    "$count_read$"
     "  return $name$_;\n"
     "}\n"
     "inline ::google::protobuf::RepeatedPtrField< $type$ >*\n"
     "$classname$::mutable_$name$() {\n"
+    "$count_write$"
     "  return &$name$_;\n"
     "}\n");
 }
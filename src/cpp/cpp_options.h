@@ -0,0 +1,82 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// http://code.google.com/p/protobuf/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef GOOGLE_PROTOBUF_COMPILER_CPP_OPTIONS_H__
+#define GOOGLE_PROTOBUF_COMPILER_CPP_OPTIONS_H__
+
+#include <map>
+#include <string>
+
+#include <google/protobuf/stubs/common.h>
+
+namespace google {
+namespace protobuf {
+namespace compiler {
+namespace cpp {
+
+// Generator options, parsed from the generator parameter by ParseOptions()
+// and passed down to every generator class.  See cpp_generator.cc for the
+// meaning of each option.
+struct Options {
+  enum LuaBackend {
+    LUA_BACKEND_LUABIND,  // luabind class_<> registrations (default)
+    LUA_BACKEND_CAPI,     // plain lua_CFunctions and metatables
+  };
+
+  Options() : split_luabind(false), lua_backend(LUA_BACKEND_LUABIND),
+              lua_arena(false), lua_pool(0), lua_lazy(false),
+              lua_shards(false), field_counters(false), cold_fields(0),
+              table_parser(false), packed_fast_path(false) {
+  }
+  string dllexport_decl;
+  bool split_luabind;
+  LuaBackend lua_backend;
+  bool lua_arena;
+  int lua_pool;  // per-thread pool capacity of each message type, 0 for none
+  bool lua_lazy;
+  bool lua_shards;
+  string layout_profile;
+  map<string, double> field_heat;  // loaded from layout_profile, by full name
+  bool field_counters;
+  int cold_fields;  // field count from which lite messages have cold fields
+  bool table_parser;
+  bool packed_fast_path;
+};
+
+// Parses a generator parameter such as "dllexport_decl=FOO_EXPORT".
+// Returns false and sets |error| on an unknown option.
+bool ParseOptions(const string& parameter, Options* options, string* error);
+
+}  // namespace cpp
+}  // namespace compiler
+}  // namespace protobuf
+
+}  // namespace google
+#endif  // GOOGLE_PROTOBUF_COMPILER_CPP_OPTIONS_H__
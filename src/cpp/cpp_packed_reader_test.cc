@@ -0,0 +1,147 @@
+// Round-trips random packed runs of every type through TestAllTypes
+// generated with packed_fast_path.  Each encoding is parsed from one
+// buffer, where ReadPacked() decodes the runs a word at a time, and from
+// small chunks, where runs straddle buffers and take the element by
+// element loop.  Two messages are concatenated so that parsing has to pick
+// up at the right byte after every run.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/wire_format_lite.h>
+
+#include "cpp_test_all_types.pb.h"
+
+namespace {
+
+using google::protobuf::int32;
+using google::protobuf::int64;
+using google::protobuf::uint32;
+using google::protobuf::uint64;
+using google::protobuf::internal::WireFormatLite;
+using protobuf_unittest::TestAllTypes;
+
+// Block sizes for ArrayInputStream; -1 hands over the whole buffer.
+const int kBlockSizes[] = {1, 2, 3, 5, 8, 13, 64, -1};
+const int kBlockSizeCount = sizeof(kBlockSizes) / sizeof(kBlockSizes[0]);
+const int kRounds = 1000;
+
+// 64 random bits cut to a random width, so that varints of every length
+// come up, ten-byte ones included.
+uint64 RandomBits() {
+  uint64 value = 0;
+  for (int i = 0; i < 4; i++) {
+    value = (value << 16) ^ static_cast<uint64>(rand() & 0xffff);
+  }
+  int width = rand() % 65;
+  return width == 64 ? value : value & ((GOOGLE_ULONGLONG(1) << width) - 1);
+}
+
+void FillPacked(TestAllTypes* message) {
+  int count = rand() % 40;
+  for (int i = 0; i < count; i++) {
+    uint64 value = RandomBits();
+    message->add_packed_int32(static_cast<int32>(value));
+    message->add_packed_int64(static_cast<int64>(value));
+    message->add_packed_uint32(static_cast<uint32>(value));
+    message->add_packed_uint64(value);
+    message->add_packed_sint32(static_cast<int32>(value));
+    message->add_packed_sint64(static_cast<int64>(value));
+    message->add_packed_fixed32(static_cast<uint32>(value));
+    message->add_packed_fixed64(value);
+    message->add_packed_sfixed32(static_cast<int32>(value));
+    message->add_packed_sfixed64(static_cast<int64>(value));
+    message->add_packed_float(static_cast<float>(value));
+    message->add_packed_double(static_cast<double>(value));
+    message->add_packed_bool((value & 1) != 0);
+    message->add_packed_enum(
+        static_cast<TestAllTypes::NestedEnum>(value % 3 + 1));
+  }
+  if (rand() % 2 == 0) message->set_optional_int32(rand());
+}
+
+bool ParseInBlocks(const std::string& data, int block_size,
+                   TestAllTypes* message) {
+  google::protobuf::io::ArrayInputStream input(
+      data.data(), static_cast<int>(data.size()), block_size);
+  return message->ParseFromZeroCopyStream(&input);
+}
+
+// Parses |data| in every block size and compares the result with
+// |expected|.
+bool Check(const std::string& data, const TestAllTypes& expected) {
+  std::string want = expected.SerializeAsString();
+  for (int i = 0; i < kBlockSizeCount; i++) {
+    TestAllTypes parsed;
+    if (!ParseInBlocks(data, kBlockSizes[i], &parsed)) {
+      fprintf(stderr, "block size %d: parse failed\n", kBlockSizes[i]);
+      return false;
+    }
+    if (parsed.SerializeAsString() != want) {
+      fprintf(stderr, "block size %d: wrong values\n", kBlockSizes[i]);
+      return false;
+    }
+  }
+  return true;
+}
+
+// A packed enum run with values the enum doesn't define: they are dropped,
+// as WireFormatLite::ReadPackedEnumNoInline() drops them.
+bool CheckUnknownEnumValues() {
+  static const int kValues[] = {1, 7, 2, 0, 3, 1000000};
+  static const int kValueCount = sizeof(kValues) / sizeof(kValues[0]);
+  std::string run;
+  {
+    google::protobuf::io::StringOutputStream output(&run);
+    google::protobuf::io::CodedOutputStream coded(&output);
+    for (int i = 0; i < kValueCount; i++) {
+      coded.WriteVarint32SignExtended(kValues[i]);
+    }
+  }
+  std::string data;
+  {
+    google::protobuf::io::StringOutputStream output(&data);
+    google::protobuf::io::CodedOutputStream coded(&output);
+    coded.WriteTag(WireFormatLite::MakeTag(
+        TestAllTypes::kPackedEnumFieldNumber,
+        WireFormatLite::WIRETYPE_LENGTH_DELIMITED));
+    coded.WriteVarint32(static_cast<uint32>(run.size()));
+    coded.WriteString(run);
+  }
+
+  TestAllTypes expected;
+  expected.add_packed_enum(TestAllTypes::FOO);
+  expected.add_packed_enum(TestAllTypes::BAR);
+  expected.add_packed_enum(TestAllTypes::BAZ);
+  if (!Check(data, expected)) {
+    fprintf(stderr, "unknown enum values dropped wrongly\n");
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  srand(1);
+  for (int round = 0; round < kRounds; round++) {
+    TestAllTypes first;
+    TestAllTypes second;
+    FillPacked(&first);
+    FillPacked(&second);
+    TestAllTypes expected(first);
+    expected.MergeFrom(second);
+    if (!Check(first.SerializeAsString() + second.SerializeAsString(),
+               expected)) {
+      fprintf(stderr, "round %d failed\n", round);
+      return 1;
+    }
+  }
+  if (!CheckUnknownEnumValues()) return 1;
+
+  printf("PASS\n");
+  return 0;
+}
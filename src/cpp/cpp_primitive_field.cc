@@ -99,9 +99,11 @@ void SetPrimitiveVariables(const FieldDescriptor* descriptor,
 // ===================================================================
 
 PrimitiveFieldGenerator::
-PrimitiveFieldGenerator(const FieldDescriptor* descriptor)
+PrimitiveFieldGenerator(const FieldDescriptor* descriptor,
+                        const Options& options)
   : descriptor_(descriptor) {
   SetPrimitiveVariables(descriptor, &variables_);
+  SetGeneratorOptionVariables(descriptor, options, &variables_);
 }
 
 PrimitiveFieldGenerator::~PrimitiveFieldGenerator() {}
@@ -122,11 +124,13 @@ void PrimitiveFieldGenerator::
 GenerateInlineAccessorDefinitions(io::Printer* printer) const {
   printer->Print(variables_,
     "inline $type$ $classname$::$name$() const {\n"
-    "  return $name$_;\n"
+    "$count_read$"
+    "  return $cold_const$$name$_;\n"
     "}\n"
     "inline void $classname$::set_$name$($type$ value) {\n"
+    "$count_write$"
     "  set_has_$name$();\n"
-    "  $name$_ = value;\n"
+    "  $cold_mutable$$name$_ = value;\n"
     "}\n");
 }
 
@@ -155,7 +159,7 @@ GenerateMergeFromCodedStream(io::Printer* printer) const {
   printer->Print(variables_,
     "DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<\n"
     "         $type$, $wire_format_field_type$>(\n"
-    "       input, &$name$_)));\n"
+    "       input, &$cold_mutable$$name$_)));\n"
     "set_has_$name$();\n");
 }
 
@@ -190,15 +194,20 @@ GenerateByteSize(io::Printer* printer) const {
 // ===================================================================
 
 RepeatedPrimitiveFieldGenerator::
-RepeatedPrimitiveFieldGenerator(const FieldDescriptor* descriptor)
+RepeatedPrimitiveFieldGenerator(const FieldDescriptor* descriptor,
+                                const Options& options)
   : descriptor_(descriptor) {
   SetPrimitiveVariables(descriptor, &variables_);
+  SetGeneratorOptionVariables(descriptor, options, &variables_);
 
   if (descriptor->options().packed()) {
-    variables_["packed_reader"] = "ReadPackedPrimitive";
+    variables_["packed_reader"] = options.packed_fast_path
+        ? "::protobuf_packed_reader::ReadPacked"
+        : "::google::protobuf::internal::WireFormatLite::ReadPackedPrimitive";
     variables_["repeated_reader"] = "ReadRepeatedPrimitiveNoInline";
   } else {
-    variables_["packed_reader"] = "ReadPackedPrimitiveNoInline";
+    variables_["packed_reader"] =
+        "::google::protobuf::internal::WireFormatLite::ReadPackedPrimitiveNoInline";
     variables_["repeated_reader"] = "ReadRepeatedPrimitive";
   }
 }
@@ -232,21 +241,26 @@ void RepeatedPrimitiveFieldGenerator::
 GenerateInlineAccessorDefinitions(io::Printer* printer) const {
   printer->Print(variables_,
     "inline $type$ $classname$::$name$(int index) const {\n"
+    "$count_read$"
     "  return $name$_.Get(index);\n"
     "}\n"
     "inline void $classname$::set_$name$(int index, $type$ value) {\n"
+    "$count_write$"
     "  $name$_.Set(index, value);\n"
     "}\n"
     "inline void $classname$::add_$name$($type$ value) {\n"
+    "$count_write$"
     "  $name$_.Add(value);\n"
     "}\n");
   printer->Print(variables_,
     "inline const ::google::protobuf::RepeatedField< $type$ >&\n"
     "$classname$::$name$() const {\n"
+    "$count_read$"
     "  return $name$_;\n"
     "}\n"
     "inline ::google::protobuf::RepeatedField< $type$ >*\n"
     "$classname$::mutable_$name$() {\n"
+    "$count_write$"
     "  return &$name$_;\n"
     "}\n");
 }
@@ -282,7 +296,7 @@ GenerateMergeFromCodedStream(io::Printer* printer) const {
 void RepeatedPrimitiveFieldGenerator::
 GenerateMergeFromCodedStreamWithPacking(io::Printer* printer) const {
   printer->Print(variables_,
-    "DO_((::google::protobuf::internal::WireFormatLite::$packed_reader$<\n"
+    "DO_(($packed_reader$<\n"
     "         $type$, $wire_format_field_type$>(\n"
     "       input, this->mutable_$name$())));\n");
 }
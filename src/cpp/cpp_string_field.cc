@@ -61,9 +61,11 @@ void SetStringVariables(const FieldDescriptor* descriptor,
 // ===================================================================
 
 StringFieldGenerator::
-StringFieldGenerator(const FieldDescriptor* descriptor)
+StringFieldGenerator(const FieldDescriptor* descriptor,
+                     const Options& options)
   : descriptor_(descriptor) {
   SetStringVariables(descriptor, &variables_);
+  SetGeneratorOptionVariables(descriptor, options, &variables_);
 }
 
 StringFieldGenerator::~StringFieldGenerator() {}
@@ -122,51 +124,57 @@ void StringFieldGenerator::
 GenerateInlineAccessorDefinitions(io::Printer* printer) const {
   printer->Print(variables_,
     "inline const ::std::string& $classname$::$name$() const {\n"
-    "  return *$name$_;\n"
+    "$count_read$"
+    "  return *$cold_const$$name$_;\n"
     "}\n"
     "inline void $classname$::set_$name$(const ::std::string& value) {\n"
+    "$count_write$"
     "  set_has_$name$();\n"
-    "  if ($name$_ == &$default_variable$) {\n"
-    "    $name$_ = new ::std::string;\n"
+    "  if ($cold_mutable$$name$_ == &$default_variable$) {\n"
+    "    $cold_mutable$$name$_ = new ::std::string;\n"
     "  }\n"
-    "  $name$_->assign(value);\n"
+    "  $cold_mutable$$name$_->assign(value);\n"
     "}\n"
     "inline void $classname$::set_$name$(const char* value) {\n"
+    "$count_write$"
     "  set_has_$name$();\n"
-    "  if ($name$_ == &$default_variable$) {\n"
-    "    $name$_ = new ::std::string;\n"
+    "  if ($cold_mutable$$name$_ == &$default_variable$) {\n"
+    "    $cold_mutable$$name$_ = new ::std::string;\n"
     "  }\n"
-    "  $name$_->assign(value);\n"
+    "  $cold_mutable$$name$_->assign(value);\n"
     "}\n"
     "inline "
     "void $classname$::set_$name$(const $pointer_type$* value, size_t size) {\n"
+    "$count_write$"
     "  set_has_$name$();\n"
-    "  if ($name$_ == &$default_variable$) {\n"
-    "    $name$_ = new ::std::string;\n"
+    "  if ($cold_mutable$$name$_ == &$default_variable$) {\n"
+    "    $cold_mutable$$name$_ = new ::std::string;\n"
     "  }\n"
-    "  $name$_->assign(reinterpret_cast<const char*>(value), size);\n"
+    "  $cold_mutable$$name$_->assign(reinterpret_cast<const char*>(value), size);\n"
     "}\n"
     "inline ::std::string* $classname$::mutable_$name$() {\n"
+    "$count_write$"
     "  set_has_$name$();\n"
-    "  if ($name$_ == &$default_variable$) {\n");
+    "  if ($cold_mutable$$name$_ == &$default_variable$) {\n");
   if (descriptor_->default_value_string().empty()) {
     printer->Print(variables_,
-      "    $name$_ = new ::std::string;\n");
+      "    $cold_mutable$$name$_ = new ::std::string;\n");
   } else {
     printer->Print(variables_,
-      "    $name$_ = new ::std::string($default_variable$);\n");
+      "    $cold_mutable$$name$_ = new ::std::string($default_variable$);\n");
   }
   printer->Print(variables_,
     "  }\n"
-    "  return $name$_;\n"
+    "  return $cold_mutable$$name$_;\n"
     "}\n"
     "inline ::std::string* $classname$::release_$name$() {\n"
+    "$count_write$"
     "  clear_has_$name$();\n"
-    "  if ($name$_ == &$default_variable$) {\n"
+    "  if ($cold_const$$name$_ == &$default_variable$) {\n"
     "    return NULL;\n"
     "  } else {\n"
-    "    ::std::string* temp = $name$_;\n"
-    "    $name$_ = const_cast< ::std::string*>(&$default_variable$);\n"
+    "    ::std::string* temp = $cold_mutable$$name$_;\n"
+    "    $cold_mutable$$name$_ = const_cast< ::std::string*>(&$default_variable$);\n"
     "    return temp;\n"
     "  }\n"
     "}\n");
@@ -273,9 +281,11 @@ GenerateByteSize(io::Printer* printer) const {
 // ===================================================================
 
 RepeatedStringFieldGenerator::
-RepeatedStringFieldGenerator(const FieldDescriptor* descriptor)
+RepeatedStringFieldGenerator(const FieldDescriptor* descriptor,
+                             const Options& options)
   : descriptor_(descriptor) {
   SetStringVariables(descriptor, &variables_);
+  SetGeneratorOptionVariables(descriptor, options, &variables_);
 }
 
 RepeatedStringFieldGenerator::~RepeatedStringFieldGenerator() {}
@@ -328,43 +338,54 @@ void RepeatedStringFieldGenerator::
 GenerateInlineAccessorDefinitions(io::Printer* printer) const {
   printer->Print(variables_,
     "inline const ::std::string& $classname$::$name$(int index) const {\n"
+    "$count_read$"
     "  return $name$_.Get(index);\n"
     "}\n"
     "inline ::std::string* $classname$::mutable_$name$(int index) {\n"
+    "$count_write$"
     "  return $name$_.Mutable(index);\n"
     "}\n"
     "inline void $classname$::set_$name$(int index, const ::std::string& value) {\n"
+    "$count_write$"
     "  $name$_.Mutable(index)->assign(value);\n"
     "}\n"
     "inline void $classname$::set_$name$(int index, const char* value) {\n"
+    "$count_write$"
     "  $name$_.Mutable(index)->assign(value);\n"
     "}\n"
     "inline void "
     "$classname$::set_$name$"
     "(int index, const $pointer_type$* value, size_t size) {\n"
+    "$count_write$"
     "  $name$_.Mutable(index)->assign(\n"
     "    reinterpret_cast<const char*>(value), size);\n"
     "}\n"
     "inline ::std::string* $classname$::add_$name$() {\n"
+    "$count_write$"
     "  return $name$_.Add();\n"
     "}\n"
     "inline void $classname$::add_$name$(const ::std::string& value) {\n"
+    "$count_write$"
     "  $name$_.Add()->assign(value);\n"
     "}\n"
     "inline void $classname$::add_$name$(const char* value) {\n"
+    "$count_write$"
     "  $name$_.Add()->assign(value);\n"
     "}\n"
     "inline void "
     "$classname$::add_$name$(const $pointer_type$* value, size_t size) {\n"
+    "$count_write$"
     "  $name$_.Add()->assign(reinterpret_cast<const char*>(value), size);\n"
     "}\n");
   printer->Print(variables_,
     "inline const ::google::protobuf::RepeatedPtrField< ::std::string>&\n"
     "$classname$::$name$() const {\n"
+    "$count_read$"
     "  return $name$_;\n"
     "}\n"
     "inline ::google::protobuf::RepeatedPtrField< ::std::string>*\n"
     "$classname$::mutable_$name$() {\n"
+    "$count_write$"
     "  return &$name$_;\n"
     "}\n");
 }
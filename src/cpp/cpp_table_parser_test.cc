@@ -0,0 +1,267 @@
+// Parses the same inputs with TestAllTypes generated with table_parser and
+// with a copy of it, TestAllTypesSwitch, generated without, and checks
+// that both parsers accept the same inputs and produce the same messages.
+// The inputs are random messages, concatenations of two of them, and
+// random sequences of fields with random wire types, which take the
+// fallbacks for unknown fields and mismatched wire types.
+//
+// With --benchmark, times both parsers on random messages instead.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/wire_format_lite.h>
+
+#include "cpp_test_all_types.pb.h"
+#include "cpp_test_all_types_switch.pb.h"
+
+namespace {
+
+using google::protobuf::int32;
+using google::protobuf::int64;
+using google::protobuf::uint32;
+using google::protobuf::uint64;
+using google::protobuf::internal::WireFormatLite;
+
+typedef protobuf_unittest::TestAllTypes TableTypes;
+typedef protobuf_unittest_switch::TestAllTypes SwitchTypes;
+
+const int kRounds = 2000;
+
+// The numbers of TestAllTypes' fields, those of its groups' fields, which
+// are unknown outside the groups, and one unknown number.
+const int kFieldNumbers[] = {
+  1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 21,
+  31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 51,
+  90, 91, 92, 93, 94, 95, 96, 97, 98, 99, 100, 101, 102, 103, 1000,
+};
+const int kFieldNumberCount = sizeof(kFieldNumbers) / sizeof(kFieldNumbers[0]);
+
+// 64 random bits cut to a random width, so that varints of every length
+// come up.
+uint64 RandomBits() {
+  uint64 value = 0;
+  for (int i = 0; i < 4; i++) {
+    value = (value << 16) ^ static_cast<uint64>(rand() & 0xffff);
+  }
+  int width = rand() % 65;
+  return width == 64 ? value : value & ((GOOGLE_ULONGLONG(1) << width) - 1);
+}
+
+bool Chance() { return rand() % 2 == 0; }
+int RandomCount() { return rand() % 4; }
+
+std::string RandomString() {
+  std::string value(rand() % 20, '\0');
+  for (size_t i = 0; i < value.size(); i++) value[i] = static_cast<char>(rand());
+  return value;
+}
+
+SwitchTypes::NestedEnum RandomEnum() {
+  return static_cast<SwitchTypes::NestedEnum>(rand() % 3 + 1);
+}
+
+void FillNested(SwitchTypes::NestedMessage* message) {
+  if (Chance()) message->set_bb(static_cast<int32>(RandomBits()));
+  for (int i = RandomCount(); i > 0; i--) {
+    message->add_values(static_cast<int32>(RandomBits()));
+  }
+}
+
+#define FILL_NUMBER(NAME, TYPE, PACKED)                                    \
+  if (Chance()) {                                                          \
+    message->set_optional_##NAME(static_cast<TYPE>(RandomBits()));         \
+  }                                                                        \
+  for (int i = RandomCount(); i > 0; i--) {                                \
+    message->add_repeated_##NAME(static_cast<TYPE>(RandomBits()));         \
+  }                                                                        \
+  for (int i = PACKED ? RandomCount() : 0; i > 0; i--) {                   \
+    message->add_packed_##NAME(static_cast<TYPE>(RandomBits()));           \
+  }
+
+void Fill(SwitchTypes* message) {
+  FILL_NUMBER(int32, int32, true)
+  FILL_NUMBER(int64, int64, true)
+  FILL_NUMBER(uint32, uint32, true)
+  FILL_NUMBER(uint64, uint64, true)
+  FILL_NUMBER(sint32, int32, true)
+  FILL_NUMBER(sint64, int64, true)
+  FILL_NUMBER(fixed32, uint32, true)
+  FILL_NUMBER(fixed64, uint64, true)
+  FILL_NUMBER(sfixed32, int32, true)
+  FILL_NUMBER(sfixed64, int64, true)
+  FILL_NUMBER(float, float, true)
+  FILL_NUMBER(double, double, true)
+  FILL_NUMBER(bool, bool, true)
+
+  if (Chance()) message->set_optional_string(RandomString());
+  if (Chance()) message->set_optional_bytes(RandomString());
+  for (int i = RandomCount(); i > 0; i--) {
+    message->add_repeated_string(RandomString());
+    message->add_repeated_bytes(RandomString());
+  }
+
+  if (Chance()) message->set_optional_nested_enum(RandomEnum());
+  for (int i = RandomCount(); i > 0; i--) {
+    message->add_repeated_nested_enum(RandomEnum());
+    message->add_packed_enum(RandomEnum());
+  }
+
+  if (Chance()) {
+    message->mutable_optionalgroup()->set_a(static_cast<int32>(RandomBits()));
+  }
+  if (Chance()) FillNested(message->mutable_optional_nested_message());
+  for (int i = RandomCount(); i > 0; i--) {
+    message->add_repeatedgroup()->set_a(static_cast<int32>(RandomBits()));
+    FillNested(message->add_repeated_nested_message());
+  }
+}
+
+#undef FILL_NUMBER
+
+std::string RandomMessage() {
+  SwitchTypes message;
+  Fill(&message);
+  return message.SerializeAsString();
+}
+
+// Fields with random numbers, wire types and contents.  Length-delimited
+// ones hold a nested message, a run of varints or random bytes.
+std::string RandomFields() {
+  std::string data;
+  google::protobuf::io::StringOutputStream output(&data);
+  google::protobuf::io::CodedOutputStream coded(&output);
+  for (int i = rand() % 20; i > 0; i--) {
+    int number = kFieldNumbers[rand() % kFieldNumberCount];
+    switch (rand() % 4) {
+      case 0:
+        coded.WriteTag(WireFormatLite::MakeTag(
+            number, WireFormatLite::WIRETYPE_VARINT));
+        coded.WriteVarint64(RandomBits());
+        break;
+      case 1:
+        coded.WriteTag(WireFormatLite::MakeTag(
+            number, WireFormatLite::WIRETYPE_FIXED64));
+        coded.WriteLittleEndian64(RandomBits());
+        break;
+      case 2:
+        coded.WriteTag(WireFormatLite::MakeTag(
+            number, WireFormatLite::WIRETYPE_FIXED32));
+        coded.WriteLittleEndian32(static_cast<uint32>(RandomBits()));
+        break;
+      default: {
+        std::string value;
+        switch (rand() % 3) {
+          case 0: {
+            SwitchTypes::NestedMessage nested;
+            FillNested(&nested);
+            value = nested.SerializeAsString();
+            break;
+          }
+          case 1: {
+            google::protobuf::io::StringOutputStream run_output(&value);
+            google::protobuf::io::CodedOutputStream run(&run_output);
+            for (int j = RandomCount(); j > 0; j--) {
+              run.WriteVarint64(RandomBits());
+            }
+            break;
+          }
+          default:
+            value = RandomString();
+            break;
+        }
+        coded.WriteTag(WireFormatLite::MakeTag(
+            number, WireFormatLite::WIRETYPE_LENGTH_DELIMITED));
+        coded.WriteVarint32(static_cast<uint32>(value.size()));
+        coded.WriteString(value);
+        break;
+      }
+    }
+  }
+  return data;
+}
+
+// Parses |data| with both parsers; returns false if they disagree.
+bool Compare(const std::string& data) {
+  TableTypes table;
+  SwitchTypes switch_message;
+  bool table_ok = table.ParseFromString(data);
+  bool switch_ok = switch_message.ParseFromString(data);
+  if (table_ok != switch_ok) {
+    fprintf(stderr, "the table parser %s input the switch parser %s\n",
+            table_ok ? "accepts" : "rejects",
+            switch_ok ? "accepts" : "rejects");
+    return false;
+  }
+  if (table_ok &&
+      table.SerializeAsString() != switch_message.SerializeAsString()) {
+    fprintf(stderr, "the parsers read different values\n");
+    return false;
+  }
+  return true;
+}
+
+int Test() {
+  for (int round = 0; round < kRounds; round++) {
+    std::string first = RandomMessage();
+    std::string second = RandomMessage();
+    if (!Compare(first) || !Compare(first + second) ||
+        !Compare(RandomFields()) ||
+        !Compare(first.substr(0, rand() % (first.size() + 1)))) {
+      fprintf(stderr, "round %d failed\n", round);
+      return 1;
+    }
+  }
+  printf("PASS\n");
+  return 0;
+}
+
+template <typename Message>
+double NanosecondsPerParse(const std::vector<std::string>& inputs,
+                           int passes) {
+  Message message;
+  clock_t start = clock();
+  for (int pass = 0; pass < passes; pass++) {
+    for (size_t i = 0; i < inputs.size(); i++) {
+      if (!message.ParseFromString(inputs[i])) abort();
+    }
+  }
+  double seconds = static_cast<double>(clock() - start) / CLOCKS_PER_SEC;
+  return seconds * 1e9 / (static_cast<double>(passes) * inputs.size());
+}
+
+int Benchmark() {
+  const int kMessages = 1000;
+  const int kPasses = 200;
+  std::vector<std::string> inputs;
+  size_t bytes = 0;
+  for (int i = 0; i < kMessages; i++) {
+    inputs.push_back(RandomMessage());
+    bytes += inputs.back().size();
+  }
+  printf("%d messages, %d bytes on average\n", kMessages,
+         static_cast<int>(bytes / kMessages));
+
+  // Warm up both before timing either.
+  NanosecondsPerParse<TableTypes>(inputs, 1);
+  NanosecondsPerParse<SwitchTypes>(inputs, 1);
+  printf("table parser:  %8.1f ns per message\n",
+         NanosecondsPerParse<TableTypes>(inputs, kPasses));
+  printf("switch parser: %8.1f ns per message\n",
+         NanosecondsPerParse<SwitchTypes>(inputs, kPasses));
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  srand(1);
+  if (argc == 2 && strcmp(argv[1], "--benchmark") == 0) return Benchmark();
+  return Test();
+}
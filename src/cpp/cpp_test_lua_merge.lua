@@ -0,0 +1,29 @@
+-- A singular sub-message that occurs more than once on the wire is merged,
+-- as ParseFromString() merges it: decoding the concatenation of two
+-- encodings gives the same message as decoding them one after the other.
+
+local first = TestLuaMessage.encode{
+  id = 1,
+  nested = {a = 1, values = {1, 2}, child = {a = 3}},
+  nesteds = {{a = 1}},
+  group = {a = 1, values = {1}},
+}
+local second = TestLuaMessage.encode{
+  nested = {b = 2, values = {3}, child = {b = 4}},
+  nesteds = {{b = 2}},
+  group = {values = {2}},
+}
+
+local t = TestLuaMessage.decode(first .. second)
+assert(t, "decode failed")
+assert(t.id == 1)
+assert(t.nested.a == 1 and t.nested.b == 2)
+assert(#t.nested.values == 3)
+assert(t.nested.values[1] == 1 and t.nested.values[2] == 2 and t.nested.values[3] == 3)
+assert(t.nested.child.a == 3 and t.nested.child.b == 4)
+assert(#t.nesteds == 2 and t.nesteds[1].a == 1 and t.nesteds[2].b == 2)
+assert(t.group.a == 1 and #t.group.values == 2)
+
+local message = TestLuaMessage()
+assert(message:ParseFromString(first .. second))
+assert(TestLuaMessage.encode(t) == message:SerializeToString())
@@ -0,0 +1,69 @@
+-- Round-trips a TestAllTypes with every field set through each pair of
+-- conversions between Lua tables and messages: encode() and
+-- ParseFromString(), SerializeToString() and decode(), import() and
+-- to_table().  Every route has to give back the table it started from.
+
+local function check_equal(actual, expected, path)
+  if type(expected) ~= "table" then
+    assert(actual == expected, path .. ": expected " .. tostring(expected) ..
+      ", got " .. tostring(actual))
+    return
+  end
+  assert(type(actual) == "table", path .. ": expected a table")
+  for key, value in pairs(expected) do
+    check_equal(actual[key], value, path .. "." .. tostring(key))
+  end
+  for key in pairs(actual) do
+    assert(expected[key] ~= nil, path .. ": unexpected " .. tostring(key))
+  end
+end
+
+local singular = {
+  int32 = -101, int64 = -2 ^ 40, uint32 = 3000000000, uint64 = 2 ^ 52,
+  sint32 = -103, sint64 = -2 ^ 41, fixed32 = 105, fixed64 = 2 ^ 42,
+  sfixed32 = -107, sfixed64 = -2 ^ 43, float = 0.25, double = 1.5e300,
+  bool = true, string = "115", bytes = "\0\1\255",
+}
+local repeated = {
+  int32 = {-1, 0, 2147483647}, int64 = {-2 ^ 50, 2 ^ 50},
+  uint32 = {0, 4294967295}, uint64 = {0, 2 ^ 53},
+  sint32 = {-2147483648, 2147483647}, sint64 = {-2 ^ 52, 2 ^ 52},
+  fixed32 = {0, 4294967295}, fixed64 = {1, 2 ^ 53},
+  sfixed32 = {-2147483648, 2147483647}, sfixed64 = {-2 ^ 53, 2 ^ 53},
+  float = {-0.5, 1024}, double = {-1e-300, 1e300}, bool = {true, false, true},
+  string = {"", "a", string.rep("b", 300)}, bytes = {"\0", "\255\254"},
+}
+
+local NestedEnum = TestAllTypes_NestedEnum
+local all = {
+  optionalgroup = {a = 117},
+  optional_nested_message = {bb = 118, values = {1, 2}},
+  optional_nested_enum = NestedEnum.BAR,
+  repeatedgroup = {{a = 217}, {a = 317}},
+  repeated_nested_message = {{bb = 218, values = {}}, {bb = 318, values = {3}}},
+  repeated_nested_enum = {NestedEnum.FOO, NestedEnum.BAZ},
+  packed_enum = {NestedEnum.BAZ, NestedEnum.FOO},
+}
+for name, value in pairs(singular) do
+  all["optional_" .. name] = value
+end
+for name, values in pairs(repeated) do
+  all["repeated_" .. name] = values
+  if name ~= "string" and name ~= "bytes" then
+    all["packed_" .. name] = values
+  end
+end
+
+-- encode() and ParseFromString()
+local parsed = TestAllTypes()
+assert(parsed:ParseFromString(TestAllTypes.encode(all)))
+check_equal(parsed:to_table(), all, "encode")
+
+-- SerializeToString() and decode()
+check_equal(TestAllTypes.decode(parsed:SerializeToString()), all, "decode")
+
+-- import() and to_table()
+local imported = TestAllTypes()
+imported:import(all)
+check_equal(imported:to_table(), all, "import")
+assert(imported:SerializeToString() == parsed:SerializeToString())
@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <google/protobuf/stubs/hash.h>
 #include <map>
+#include <set>
 #include <utility>
 #include <vector>
 #include <google/protobuf/stubs/strutil.h>
@@ -24,6 +25,8 @@
 #include "cpp/cpp_message_field.h"
 #include "cpp/cpp_primitive_field.h"
 
+#include "cpp_patch_lua.h"
+
 namespace google {
 namespace protobuf {
 namespace compiler {
@@ -42,11 +45,36 @@ void FileGenerator::GenerateLuaBindRegisterCode(io::Printer* printer) {
 	}
 }
 
+// One ::google::protobuf::LuaLazyType per global the file's types define,
+// for InitLuaBindEnvironment() with lua_lazy.
+void FileGenerator::GenerateLuaLazyTypes(io::Printer* printer) {
+	for (int i = 0; i < file_->enum_type_count(); i++) {
+		enum_generators_[i]->GenerateLuaLazyTypes(printer);
+	}
+	for (int i = 0; i < file_->message_type_count(); i++) {
+		message_generators_[i]->GenerateLuaLazyTypes(printer);
+	}
+}
+
 void FileGenerator::GenerateLuaBindCode(io::Printer* printer) {
+	if (options_.split_luabind || options_.lua_backend == Options::LUA_BACKEND_CAPI) {
+		printer->Print(
+			"$dllexport$void $filename$_RegisterToLua(lua_State *L);\n",
+			"dllexport", options_.dllexport_decl.empty() ? "" : options_.dllexport_decl + " ",
+			"filename", cpp::StripProto(file_->name()));
+		return;
+	}
+
+	printer->Print("#ifdef LUABIND_API\n");
+	GenerateLuaBindRegisterFunction(printer, "inline ");
+	printer->Print("#endif\n");
+}
+
+void FileGenerator::GenerateLuaBindRegisterFunction(io::Printer* printer, const char* linkage) {
 	printer->Print(
-		"#ifdef LUABIND_API\n"
-		"inline void $filename$_RegisterToLua(lua_State *L) {\n", "filename",
-		cpp::StripProto(file_->name()));
+		"$linkage$void $filename$_RegisterToLua(lua_State *L) {\n",
+		"linkage", linkage,
+		"filename", cpp::StripProto(file_->name()));
 
 	for (int i = 0; i < file_->enum_type_count(); i++) {
 		enum_generators_[i]->GenerateLuaBindCode(printer);
@@ -55,10 +83,56 @@ void FileGenerator::GenerateLuaBindCode(io::Printer* printer) {
 		message_generators_[i]->GenerateLuaBindCode(printer);
 	}
 
+	printer->Print("}\n");
+}
+
+// With split_luabind everything that needs the luabind headers goes here
+// instead of into the .pb.h/.pb.cc.
+void FileGenerator::GenerateLuaBindSource(io::Printer* printer) {
 	printer->Print(
-		"}\n"
-		"#endif"
-		"\n");
+		"// Generated by the protocol buffer compiler.  DO NOT EDIT!\n"
+		"// source: $filename$\n"
+		"\n"
+		"#define INTERNAL_SUPPRESS_PROTOBUF_FIELD_DEPRECATION\n",
+		"filename", file_->name());
+
+	if (options_.lua_backend == Options::LUA_BACKEND_CAPI) {
+		printer->Print(
+			"#include \"$basename$.pb.h\"\n"
+			"\n",
+			"basename", StripProto(file_->name()));
+
+		GenerateLuaRuntime(printer);
+
+		GenerateNamespaceOpeners(printer);
+		GenerateLuaCApiCode(printer);
+		GenerateNamespaceClosers(printer);
+		return;
+	}
+
+	INC_LUA_HEADERS
+
+	LUABIND_USING_DEFINITION
+
+	printer->Print(
+		"#include \"$basename$.pb.h\"\n"
+		"\n",
+		"basename", StripProto(file_->name()));
+
+	GenerateLuaRuntime(printer);
+
+	GenerateNamespaceOpeners(printer);
+
+	for (int i = 0; i < file_->enum_type_count(); i++) {
+		enum_generators_[i]->GenerateLuaBindMethods(printer);
+	}
+	for (int i = 0; i < file_->message_type_count(); i++) {
+		message_generators_[i]->GenerateLuaBindSource(printer);
+	}
+
+	GenerateLuaBindRegisterFunction(printer, "");
+
+	GenerateNamespaceClosers(printer);
 }
 // end
 
@@ -77,72 +151,196 @@ void MessageGenerator::GenerateLuaBindCode(io::Printer* printer) {
 	}
 }
 
+// A message can only push its sub-messages once their classes are
+// registered, so the message types of its fields are its dependencies.
+void MessageGenerator::GenerateLuaLazyTypes(io::Printer* printer) {
+	string dependencies;
+	set<string> seen;
+	seen.insert(classname_);
+	for (int i = 0; i < descriptor_->field_count(); i++) {
+		const FieldDescriptor* field = descriptor_->field(i);
+		if (field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE) continue;
+
+		string name = ClassName(field->message_type(), false);
+		if (!seen.insert(name).second) continue;
+		if (!dependencies.empty()) dependencies += " ";
+		dependencies += name;
+	}
+
+	printer->Print(
+		"		{\"$classname$\", &$qualified$::RegisterToLua, \"$dependencies$\"},\n",
+		"classname", classname_,
+		"qualified", ClassName(descriptor_, true),
+		"dependencies", dependencies);
+
+	for (int i = 0; i < descriptor_->enum_type_count(); i++) {
+		enum_generators_[i]->GenerateLuaLazyTypes(printer);
+	}
+	for (int i = 0; i < descriptor_->nested_type_count(); i++) {
+		nested_generators_[i]->GenerateLuaLazyTypes(printer);
+	}
+}
+
 void MessageGenerator::GenerateLuaBindDefinition(io::Printer* printer) {
 	printer->Outdent();
 	printer->Print("\n"
 				   "public:\n");
 	printer->Indent();
-	printer->Print("#ifdef LUABIND_API\n"
-				   "void import(luabind::object table);\n"
-				   "static void RegisterToLua(lua_State* L);\n"
-				   "#endif\n"
-				   "\n");
+	if (options_.lua_backend == Options::LUA_BACKEND_CAPI) {
+		// import(), to_table(), decode() and encode() are lua_CFunctions in
+		// the generated source.
+		printer->Print("void ImportFromLua(lua_State* L, int index, int depth = 0);\n"
+					   "void ToTable(lua_State* L) const;\n"
+					   "static bool DecodeToLua(lua_State* L, ::google::protobuf::io::CodedInputStream* input);\n"
+					   "static int ByteSizeFromLua(lua_State* L, int index, int cache, int depth);\n"
+					   "static ::google::protobuf::uint8* EncodeFromLua(lua_State* L, int index,\n"
+					   "    const int** sizes, ::google::protobuf::uint8* target);\n"
+					   "static void RegisterToLua(lua_State* L);\n"
+					   "\n");
+	} else if (options_.split_luabind) {
+		printer->Print("#ifdef LUABIND_API\n"
+					   "void import(luabind::object table);\n"
+					   "luabind::object to_table(lua_State* L) const;\n"
+					   "static luabind::object decode(luabind::object data);\n"
+					   "static luabind::object encode(luabind::object table);\n"
+					   "#endif\n"
+					   "void ImportFromLua(lua_State* L, int index, int depth = 0);\n"
+					   "void ToTable(lua_State* L) const;\n"
+					   "static bool DecodeToLua(lua_State* L, ::google::protobuf::io::CodedInputStream* input);\n"
+					   "static int ByteSizeFromLua(lua_State* L, int index, int cache, int depth);\n"
+					   "static ::google::protobuf::uint8* EncodeFromLua(lua_State* L, int index,\n"
+					   "    const int** sizes, ::google::protobuf::uint8* target);\n"
+					   "static void RegisterToLua(lua_State* L);\n"
+					   "\n");
+	} else {
+		printer->Print("#ifdef LUABIND_API\n"
+					   "void import(luabind::object table);\n"
+					   "luabind::object to_table(lua_State* L) const;\n"
+					   "static luabind::object decode(luabind::object data);\n"
+					   "static luabind::object encode(luabind::object table);\n"
+					   "void ImportFromLua(lua_State* L, int index, int depth = 0);\n"
+					   "void ToTable(lua_State* L) const;\n"
+					   "static bool DecodeToLua(lua_State* L, ::google::protobuf::io::CodedInputStream* input);\n"
+					   "static int ByteSizeFromLua(lua_State* L, int index, int cache, int depth);\n"
+					   "static ::google::protobuf::uint8* EncodeFromLua(lua_State* L, int index,\n"
+					   "    const int** sizes, ::google::protobuf::uint8* target);\n"
+					   "static void RegisterToLua(lua_State* L);\n"
+					   "#endif\n"
+					   "\n");
+	}
+
+	if (options_.lua_arena) {
+		// Sub-messages created through mutable_ and add_ come through here
+		// too, so a whole message graph ends up in the arena.
+		printer->Print("// Allocated from the current protobuf_lua_arena::Arena, if any.\n"
+					   "static void* operator new(size_t size) { return ::protobuf_lua_arena::New(size); }\n"
+					   "static void operator delete(void* pointer) { ::protobuf_lua_arena::Delete(pointer); }\n"
+					   "\n");
+	}
+
+	if (options_.lua_pool > 0) {
+		printer->Print("// A cleared instance from this thread's pool, NULL if it is empty.\n"
+					   "static $classname$* Acquire();\n"
+					   "// Clears |message| into this thread's pool, or deletes it if the pool is full.\n"
+					   "static void Recycle($classname$* message);\n"
+					   "\n",
+					   "classname", classname_);
+	}
+}
+
+void MessageGenerator::GenerateLuaBindSource(io::Printer* printer) {
+	for (int i = 0; i < descriptor_->enum_type_count(); i++) {
+		enum_generators_[i]->GenerateLuaBindMethods(printer);
+	}
+
+	for (int i = 0; i < descriptor_->nested_type_count(); i++) {
+		nested_generators_[i]->GenerateLuaBindSource(printer);
+	}
+
+	GenerateLuaBindMethods(printer);
 }
 
 void MessageGenerator::GenerateLuaBindMethods(io::Printer* printer) {
+	printer->Print("#ifdef LUABIND_API\n");
+
+	vector<const FieldDescriptor*> fields;
+	ListLuaNamedFields(descriptor_, &fields);
+	if (!fields.empty()) {
+		PrintLuaFieldLookup(printer, classname_, fields);
+	}
+	GenerateLuaImport(printer);
+	GenerateLuaToTable(printer);
+	GenerateLuaDecoder(printer);
+	GenerateLuaEncoder(printer);
+
+	// luabind cannot invalidate the views of the swapped sub-messages, but
+	// the next access no longer finds them in the cache.
 	printer->Print(
-		"#ifdef LUABIND_API\n"
-		"void $classname$::import(luabind::object table) {\n"
-		"	luabind::object v;\n", "classname", classname_);
+		"static void $classname$_lua_Swap($classname$* message, $classname$* other, lua_State* L) {\n"
+		"	::protobuf_lua::ForgetOwnedViews(L, 1, 2);\n"
+		"	lua_pop(L, 1);\n"
+		"	message->Swap(other);\n"
+		"}\n"
+		"\n",
+		"classname", classname_);
 
 	for (int i = 0; i < descriptor_->field_count(); i++) {
-		const FieldDescriptor* field = descriptor_->field(i);
-
-		if (field->type() != FieldDescriptor::TYPE_MESSAGE) {
-			map<string, string> vars;
-			SetCommonFieldVariables(field, &vars);
-
-			if (field->type() == FieldDescriptor::TYPE_ENUM) {
-				vars["type"] = ClassName(field->enum_type(), true);
-			} else {
-				vars["type"] = PrimitiveTypeName(field->cpp_type());
-			}
-
-			if (field->is_repeated()) {
-				printer->Print(vars,
-					"	v = table[\"$name$\"];\n"
-					"	if (v) {\n"
-					"		for (luabind::iterator iter(v), end; iter != end; ++iter) { \n"
-					"			this->add_$name$(luabind::object_cast< $type$ >(v));\n"
-					"		}\n"
-					"	}\n");
-			} else {
-				printer->Print(vars,
-					"	v = table[\"$name$\"];\n"
-					"	if (v) { this->set_$name$(luabind::object_cast< $type$ >(v)); }\n");
-			}
-		}
+		field_generators_.get(descriptor_->field(i)).GenerateLuaBindFunctions(printer);
 	}
 
 	printer->Print(
+		"void $classname$::import(luabind::object table) {\n"
+		"	lua_State* L = table.interpreter();\n"
+		"	lua_pushlightuserdata(L, this);\n"
+		"	table.push(L);\n"
+		"	::protobuf_lua::ProtectedCall(L, &::protobuf_lua::Import< $classname$ >, 2, 0);\n"
 		"}\n"
-		"\n");
+		"\n"
+		"luabind::object $classname$::to_table(lua_State* L) const {\n"
+		"	lua_pushlightuserdata(L, const_cast< $classname$*>(this));\n"
+		"	::protobuf_lua::ProtectedCall(L, &::protobuf_lua::PushTable< $classname$ >, 1, 1);\n"
+		"	luabind::object table(luabind::from_stack(L, -1));\n"
+		"	lua_pop(L, 1);\n"
+		"	return table;\n"
+		"}\n"
+		"\n"
+		"luabind::object $classname$::decode(luabind::object data) {\n"
+		"	lua_State* L = data.interpreter();\n"
+		"	data.push(L);\n"
+		"	::protobuf_lua::ProtectedCall(L, &::protobuf_lua::Decode< $classname$ >, 1, 1);\n"
+		"	luabind::object table(luabind::from_stack(L, -1));\n"
+		"	lua_pop(L, 1);\n"
+		"	return table;\n"
+		"}\n"
+		"\n"
+		"luabind::object $classname$::encode(luabind::object table) {\n"
+		"	lua_State* L = table.interpreter();\n"
+		"	table.push(L);\n"
+		"	::protobuf_lua::ProtectedCall(L, &::protobuf_lua::Encode< $classname$ >, 1, 1);\n"
+		"	luabind::object data(luabind::from_stack(L, -1));\n"
+		"	lua_pop(L, 1);\n"
+		"	return data;\n"
+		"}\n"
+		"\n", "classname", classname_);
 
 	printer->Print(
 		"void $classname$::RegisterToLua(lua_State* L) {\n"
 		"	module(L) [\n"
-		"		class_<$classname$, ::google::protobuf::Message>(\"$classname$\")\n"
+		"		class_<$classname$, ::google::protobuf::Message$holder$>(\"$classname$\")\n"
 		"			.scope [\n"
-		"				def(\"default_instance\", &$classname$::default_instance)\n"
+		"				def(\"default_instance\", &$classname$::default_instance),\n"
+		"				def(\"decode\", &$classname$::decode),\n"
+		"				def(\"encode\", &$classname$::encode)\n"
 		"			]\n"
 		"\n"
 		"			.def(constructor<>())\n"
 		"			.def(constructor<const $classname$ &>())\n"
 		"\n"
-		"			.def(\"Swap\", &$classname$::Swap)\n"
+		"			.def(\"Swap\", &$classname$_lua_Swap)\n"
 		"\n"
 		"			.def(\"New\", &$classname$::New)\n",
-		"classname", classname_);
+		"classname", classname_,
+		"holder", options_.lua_pool > 0 ? ", ::protobuf_lua::PoolPtr< " + classname_ + " > " : "");
 
 	if (HasDescriptorMethods(descriptor_->file())) {
 		printer->Print(
@@ -168,7 +366,8 @@ void MessageGenerator::GenerateLuaBindMethods(io::Printer* printer) {
 		"			.def(\"MergePartialFromCodedStream\", &$classname$::MergePartialFromCodedStream)\n"
 		"			.def(\"SerializeWithCachedSizes\", &$classname$::SerializeWithCachedSizes)\n"
 		"\n"
-		"			.def(\"import\", &$classname$::import)\n",
+		"			.def(\"import\", &$classname$::import)\n"
+		"			.def(\"to_table\", &$classname$::to_table)\n",
 		"classname", classname_);
 
 	if (HasFastArraySerialization(descriptor_->file())) {
@@ -222,21 +421,31 @@ void MessageGenerator::GenerateLuaBindMethods(io::Printer* printer) {
 		"	];\n"
 		"\n");
 
+	if (options_.lua_arena) {
+		printer->Print(
+			"	::protobuf_lua::RegisterArena(L);\n");
+	}
+	if (options_.field_counters) {
+		printer->Print(
+			"	::protobuf_lua::RegisterFieldCounters(L);\n");
+	}
+
 	printer->Print(
-		"	LUA_CONST_START($classname$, L)\n",
-		"classname", classname_);
+		"\n"
+		"	static const ::protobuf_lua::Constant kConstants[] = {\n");
 	for (int i = 0; i < descriptor_->field_count(); i++) {
-		const FieldDescriptor* field = descriptor_->field(i);
-
-		map<string, string> vars;
-		SetCommonFieldVariables(field, &vars);
-		vars["constant_name"] = FieldConstantName(field);
-
-		printer->Print(vars,
-			"	LUA_CONST($classname$, $constant_name$)\n");
+		printer->Print(
+			"		{\"$constant_name$\", $classname$::$constant_name$},\n",
+			"classname", classname_,
+			"constant_name", FieldConstantName(descriptor_->field(i)));
 	}
 	printer->Print(
-		"	LUA_CONST_END\n");
+		"		{NULL, 0}\n"
+		"	};\n"
+		"	lua_getglobal(L, \"$classname$\");\n"
+		"	::protobuf_lua::SetConstants(L, lua_gettop(L), kConstants);\n"
+		"	lua_pop(L, 1);\n",
+		"classname", classname_);
 
 	printer->Print(
 		"}\n"
@@ -249,17 +458,43 @@ void MessageGenerator::GenerateLuaBindMethods(io::Printer* printer) {
 // EnumGenerator
 // begin
 void EnumGenerator::GenerateLuaBindDefinition(io::Printer* printer) {
+	if (options_.split_luabind || options_.lua_backend == Options::LUA_BACKEND_CAPI) {
+		// Defined by GenerateLuaBindMethods() or GenerateLuaCApiMethods().
+		printer->Print(
+			"\n"
+			"$dllexport$void $classname$_RegisterToLua(lua_State* L);\n",
+			"dllexport", options_.dllexport_decl.empty() ? "" : options_.dllexport_decl + " ",
+			"classname", classname_);
+		return;
+	}
+
+	printer->Print(
+		"\n"
+		"#ifdef LUABIND_API\n");
+	GenerateLuaBindRegisterFunction(printer, "inline ");
+	printer->Print(
+		"#endif\n"
+		"\n");
+}
+
+void EnumGenerator::GenerateLuaBindMethods(io::Printer* printer) {
+	if (options_.split_luabind) {
+		GenerateLuaBindRegisterFunction(printer, "");
+		printer->Print("\n");
+	}
+}
+
+void EnumGenerator::GenerateLuaBindRegisterFunction(io::Printer* printer, const char* linkage) {
 	map<string, string> vars;
 	vars["classname"] = classname_;
 	vars["short_name"] = descriptor_->name();
+	vars["linkage"] = linkage;
 
     const EnumValueDescriptor* min_value = descriptor_->value(0);
 	const EnumValueDescriptor* max_value = descriptor_->value(0);
 
 	printer->Print(vars,
-		"\n"
-		"#ifdef LUABIND_API\n"
-		"inline void $classname$_RegisterToLua(lua_State* L) { \n"
+		"$linkage$void $classname$_RegisterToLua(lua_State* L) { \n"
 		"	module(L) [\n"
 		"		class_<$classname$>(\"$classname$\")\n"
 		"			.enum_(\"constants\") [\n"
@@ -308,30 +543,70 @@ void EnumGenerator::GenerateLuaBindDefinition(io::Printer* printer) {
 	printer->Print(vars,
 		"	];\n"
 		"\n"
-		"	luabind::object global = luabind::globals(L);\n"
-		"	global[\"$prefix$MIN\"] = $prefix$$short_name$_MIN;\n"
-		"	global[\"$prefix$MAX\"] = $prefix$$short_name$_MAX;\n"
-		"	global[\"$prefix$ARRAYSIZE\"] = $prefix$$short_name$_ARRAYSIZE;\n"
-		"}\n"
-		"#endif\n"
-		"\n");
-}
-
-void EnumGenerator::GenerateLuaBindMethods(io::Printer* printer) {
+		"	lua_getglobal(L, \"$classname$\");\n"
+		"	lua_pushinteger(L, $prefix$$short_name$_MIN);\n"
+		"	lua_setfield(L, -2, \"MIN\");\n"
+		"	lua_pushinteger(L, $prefix$$short_name$_MAX);\n"
+		"	lua_setfield(L, -2, \"MAX\");\n"
+		"	lua_pushinteger(L, $prefix$$short_name$_ARRAYSIZE);\n"
+		"	lua_setfield(L, -2, \"ARRAYSIZE\");\n"
+		"	lua_pop(L, 1);\n"
+		"}\n");
 }
 
 void EnumGenerator::GenerateLuaBindCode(io::Printer* printer) {
 	printer->Print("	$classname$_RegisterToLua(L);\n", "classname", classname_);
 }
+
+// Every global $classname$_RegisterToLua() defines.
+void EnumGenerator::GenerateLuaLazyTypes(io::Printer* printer) {
+	vector<string> names;
+	names.push_back(classname_);
+	names.push_back(classname_ + "_IsValid");
+	if (HasDescriptorMethods(descriptor_->file())) {
+		names.push_back(classname_ + "_Name");
+		names.push_back(classname_ + "_Parse");
+	}
+
+	for (int i = 0; i < names.size(); i++) {
+		printer->Print(
+			"		{\"$name$\", &$qualified$_RegisterToLua, \"\"},\n",
+			"name", names[i],
+			"qualified", ClassName(descriptor_, true));
+	}
+}
 // end
 
 // ----------------------------------------------------
 // MessageFieldGenerator
 void MessageFieldGenerator::GenerateLuaBindCode(io::Printer* printer) const {
 	printer->Print(variables_,
-		"			.def(\"$name$\", &$classname$::$name$)\n"
-		"			.def(\"mutable_$name$\", &$classname$::mutable_$name$)\n"
-		"			.def(\"release_$name$\", &$classname$::release_$name$)\n"
+		"			.def(\"$name$\", &$classname$_lua_$name$)\n"
+		"			.def(\"mutable_$name$\", &$classname$_lua_mutable_$name$)\n"
+		"			.def(\"release_$name$\", &$classname$_lua_release_$name$)\n"
+		"\n");
+}
+
+// The accessors return cached views of the sub-message instead of a new
+// luabind instance per call.
+void MessageFieldGenerator::GenerateLuaBindFunctions(io::Printer* printer) const {
+	printer->Print(variables_,
+		"static luabind::object $classname$_lua_$name$(const $classname$& message, lua_State* L) {\n"
+		"	return ::protobuf_lua::View(L, &message.$name$(), true, 1);\n"
+		"}\n"
+		"\n"
+		"static luabind::object $classname$_lua_mutable_$name$($classname$* message, lua_State* L) {\n"
+		"	return ::protobuf_lua::View(L, message->mutable_$name$(), false, 1);\n"
+		"}\n"
+		"\n"
+		"static $type$* $classname$_lua_release_$name$($classname$* message, lua_State* L) {\n"
+		"	$type$* value = message->release_$name$();\n"
+		"	if (value != NULL) {\n"
+		"		::protobuf_lua::ForgetViews(L, value);\n"
+		"		lua_pop(L, 2);\n"
+		"	}\n"
+		"	return value;\n"
+		"}\n"
 		"\n");
 }
 
@@ -339,38 +614,191 @@ void MessageFieldGenerator::GenerateLuaBindCode(io::Printer* printer) const {
 // RepeatedMessageFieldGenerator
 void RepeatedMessageFieldGenerator::GenerateLuaBindCode(io::Printer* printer) const {
 	printer->Print(variables_,
-		"			.def(\"get_$name$\", (const $type$& ($classname$::*)(int) const$deprecation$)&$classname$::$name$)\n"
-		"			.def(\"get_mutable_$name$\", ($type$* ($classname$::*)(int)$deprecation$)&$classname$::mutable_$name$)\n"
-		"			.def(\"add_$name$\", &$classname$::add_$name$)\n"
+		"			.def(\"get_$name$\", &$classname$_lua_get_$name$)\n"
+		"			.def(\"get_mutable_$name$\", &$classname$_lua_get_mutable_$name$)\n"
+		"			.def(\"add_$name$\", &$classname$_lua_add_$name$)\n"
 		"\n"
 		"			.def(\"$name$\", (const ::google::protobuf::RepeatedPtrField< $type$ >& ($classname$::*)() const$deprecation$)&$classname$::$name$)\n"
 		"			.def(\"mutable_$name$\", (::google::protobuf::RepeatedPtrField< $type$ >* ($classname$::*)()$deprecation$)&$classname$::mutable_$name$)\n"
 		"\n");
 }
 
+// Elements are handed out as cached views, like singular sub-messages.
+void RepeatedMessageFieldGenerator::GenerateLuaBindFunctions(io::Printer* printer) const {
+	printer->Print(variables_,
+		"static luabind::object $classname$_lua_get_$name$(const $classname$& message, int index, lua_State* L) {\n"
+		"	return ::protobuf_lua::View(L, &message.$name$(index), true, 1);\n"
+		"}\n"
+		"\n"
+		"static luabind::object $classname$_lua_get_mutable_$name$($classname$* message, int index, lua_State* L) {\n"
+		"	return ::protobuf_lua::View(L, message->mutable_$name$(index), false, 1);\n"
+		"}\n"
+		"\n"
+		"static luabind::object $classname$_lua_add_$name$($classname$* message, lua_State* L) {\n"
+		"	return ::protobuf_lua::View(L, message->add_$name$(), false, 1);\n"
+		"}\n"
+		"\n");
+}
+
 // ----------------------------------------------------
 // StringFieldGenerator
 void StringFieldGenerator::GenerateLuaBindCode(io::Printer* printer) const {
 	if (descriptor_->options().ctype() == FieldOptions::STRING) {
+		// The getter's const reference is pushed with lua_pushlstring straight
+		// from the field; the setter and the view are generated below.
 		printer->Print(variables_,
 			"			.def(\"$name$\", &$classname$::$name$)\n"
-			"			.def(\"set_$name$\", (void ($classname$::*)(const ::std::string&)$deprecation$)&$classname$::set_$name$)\n"
+			"			.def(\"set_$name$\", &$classname$_lua_set_$name$)\n"
+			"			.def(\"$name$_view\", &$classname$_lua_$name$_view)\n"
 			"			.def(\"mutable_$name$\", &$classname$::mutable_$name$)\n"
 			"			.def(\"release_$name$\", &$classname$::release_$name$)\n"
 			"\n");
 	}
 }
 
+void StringFieldGenerator::GenerateLuaBindFunctions(io::Printer* printer) const {
+	if (descriptor_->options().ctype() != FieldOptions::STRING) return;
+
+	// Assigns from the Lua string's own buffer rather than through a
+	// temporary std::string.  The message is at slot 1 of the call, so the
+	// view can pin it.
+	printer->Print(variables_,
+		"static void $classname$_lua_set_$name$($classname$* message, const luabind::argument& value) {\n"
+		"	lua_State* L = value.interpreter();\n"
+		"	value.push(L);\n"
+		"	size_t size;\n"
+		"	const char* data = ::protobuf_lua::CheckString(L, -1, &size);\n"
+		"	message->set_$name$(data, size);\n"
+		"	lua_pop(L, 1);\n"
+		"}\n"
+		"\n"
+		"static luabind::object $classname$_lua_$name$_view(const $classname$& message, lua_State* L) {\n"
+		"	::protobuf_lua::PushBytesView(L, &message.$name$(), 1);\n"
+		"	luabind::object view(luabind::from_stack(L, -1));\n"
+		"	lua_pop(L, 1);\n"
+		"	return view;\n"
+		"}\n"
+		"\n");
+}
+
 // ----------------------------------------------------
 // RepeatedStringFieldGenerator
 void RepeatedStringFieldGenerator::GenerateLuaBindCode(io::Printer* printer) const {
+	// The accessors of other ctypes are private.
+	if (descriptor_->options().ctype() != FieldOptions::STRING) return;
+
 	printer->Print(variables_,
 		"			.def(\"get_$name$\", (const ::std::string& ($classname$::*)(int) const$deprecation$)&$classname$::$name$)\n"
-		"			.def(\"set_$name$\", (void ($classname$::*)(int, const ::std::string&)$deprecation$)&$classname$::set_$name$)\n"
-		"			.def(\"add_$name$\", (void ($classname$::*)(const ::std::string&)$deprecation$)&$classname$::add_$name$)\n"
+		"			.def(\"get_$name$_view\", &$classname$_lua_get_$name$_view)\n"
+		"			.def(\"set_$name$\", &$classname$_lua_set_$name$)\n"
+		"			.def(\"add_$name$\", &$classname$_lua_add_$name$)\n"
+		"\n");
+}
+
+void RepeatedStringFieldGenerator::GenerateLuaBindFunctions(io::Printer* printer) const {
+	if (descriptor_->options().ctype() != FieldOptions::STRING) return;
+
+	printer->Print(variables_,
+		"static void $classname$_lua_set_$name$($classname$* message, int index, const luabind::argument& value) {\n"
+		"	lua_State* L = value.interpreter();\n"
+		"	value.push(L);\n"
+		"	size_t size;\n"
+		"	const char* data = ::protobuf_lua::CheckString(L, -1, &size);\n"
+		"	message->set_$name$(index, data, size);\n"
+		"	lua_pop(L, 1);\n"
+		"}\n"
+		"\n"
+		"static void $classname$_lua_add_$name$($classname$* message, const luabind::argument& value) {\n"
+		"	lua_State* L = value.interpreter();\n"
+		"	value.push(L);\n"
+		"	size_t size;\n"
+		"	const char* data = ::protobuf_lua::CheckString(L, -1, &size);\n"
+		"	message->add_$name$(data, size);\n"
+		"	lua_pop(L, 1);\n"
+		"}\n"
+		"\n"
+		"static luabind::object $classname$_lua_get_$name$_view(const $classname$& message, int index, lua_State* L) {\n"
+		"	if (index < 0 || index >= message.$name$_size()) throw std::out_of_range(\"index out of range\");\n"
+		"	::protobuf_lua::PushBytesView(L, &message.$name$(index), 1);\n"
+		"	luabind::object view(luabind::from_stack(L, -1));\n"
+		"	lua_pop(L, 1);\n"
+		"	return view;\n"
+		"}\n"
+		"\n");
+}
+
+// ----------------------------------------------------
+// Repeated numeric, bool and enum fields share their bulk accessors.
+namespace {
+
+void PrintLuaBindRepeatedBulkFunctions(io::Printer* printer,
+		const FieldDescriptor* field, const map<string, string>& variables) {
+	// Bulk accessors, so that a whole array crosses into or out of Lua in a
+	// single call instead of one luabind dispatch per element.
+	PrintLuaRepeatedBulkHelpers(printer, field);
+
+	printer->Print(variables,
+		"// Stores in protected mode for set_all_ and set_range_: the table at\n"
+		"// slot 2 into the message at light userdata slot 1, from element |first|\n"
+		"// at slot 3 on; see ProtectedCall().\n"
+		"static int $classname$_lua_ProtectedStore_$name$(lua_State* L) {\n"
+		"	$classname$* message = static_cast< $classname$*>(lua_touserdata(L, 1));\n"
+		"	int first = static_cast<int>(lua_tointeger(L, 3));\n"
+		"	lua_pushinteger(L, $classname$_lua_Store_$name$(L, message, 2, first));\n"
+		"	return 1;\n"
+		"}\n"
+		"\n");
+
+	printer->Print(variables,
+		"static luabind::object $classname$_lua_get_all_$name$(const $classname$& message, lua_State* L) {\n"
+		"	$classname$_lua_Push_$name$(L, message, 0, message.$name$_size());\n"
+		"	luabind::object table(luabind::from_stack(L, -1));\n"
+		"	lua_pop(L, 1);\n"
+		"	return table;\n"
+		"}\n"
+		"\n"
+		"static luabind::object $classname$_lua_get_range_$name$(const $classname$& message, int first, int count, lua_State* L) {\n"
+		"	::protobuf_lua::CheckRange(first, count, message.$name$_size());\n"
+		"	$classname$_lua_Push_$name$(L, message, first, count);\n"
+		"	luabind::object table(luabind::from_stack(L, -1));\n"
+		"	lua_pop(L, 1);\n"
+		"	return table;\n"
+		"}\n"
+		"\n"
+		"static void $classname$_lua_set_all_$name$($classname$* message, const luabind::argument& table) {\n"
+		"	lua_State* L = table.interpreter();\n"
+		"	lua_pushlightuserdata(L, message);\n"
+		"	table.push(L);\n"
+		"	lua_pushinteger(L, 0);\n"
+		"	::protobuf_lua::ProtectedCall(L, &$classname$_lua_ProtectedStore_$name$, 3, 1);\n"
+		"	message->mutable_$name$()->Truncate(static_cast<int>(lua_tointeger(L, -1)));\n"
+		"	lua_pop(L, 1);\n"
+		"}\n"
+		"\n"
+		"static void $classname$_lua_set_range_$name$($classname$* message, int first, const luabind::argument& table) {\n"
+		"	lua_State* L = table.interpreter();\n"
+		"	::protobuf_lua::CheckRange(first, 0, message->$name$_size());\n"
+		"	lua_pushlightuserdata(L, message);\n"
+		"	table.push(L);\n"
+		"	lua_pushinteger(L, first);\n"
+		"	::protobuf_lua::ProtectedCall(L, &$classname$_lua_ProtectedStore_$name$, 3, 1);\n"
+		"	lua_pop(L, 1);\n"
+		"}\n"
 		"\n");
 }
 
+void PrintLuaBindRepeatedBulkDefs(io::Printer* printer,
+		const map<string, string>& variables) {
+	printer->Print(variables,
+		"			.def(\"get_all_$name$\", &$classname$_lua_get_all_$name$)\n"
+		"			.def(\"get_range_$name$\", &$classname$_lua_get_range_$name$)\n"
+		"			.def(\"set_all_$name$\", &$classname$_lua_set_all_$name$)\n"
+		"			.def(\"set_range_$name$\", &$classname$_lua_set_range_$name$)\n"
+		"\n");
+}
+
+}  // namespace
+
 // ----------------------------------------------------
 // EnumFieldGenerator
 void EnumFieldGenerator::GenerateLuaBindCode(io::Printer* printer) const {
@@ -380,10 +808,35 @@ void EnumFieldGenerator::GenerateLuaBindCode(io::Printer* printer) const {
 		"\n");
 }
 
+void EnumFieldGenerator::GenerateLuaBindFunctions(io::Printer* printer) const {
+}
+
 // ----------------------------------------------------
 // RepeatedEnumFieldGenerator
 void RepeatedEnumFieldGenerator::GenerateLuaBindCode(io::Printer* printer) const {
-	assert(false);
+	printer->Print(variables_,
+		"			.def(\"get_$name$\", ($type$ ($classname$::*)(int) const$deprecation$)&$classname$::$name$)\n"
+		"			.def(\"set_$name$\", &$classname$_lua_set_$name$)\n"
+		"			.def(\"add_$name$\", &$classname$_lua_add_$name$)\n"
+		"			.def(\"$name$\", (const ::google::protobuf::RepeatedField<int>& ($classname$::*)() const$deprecation$)&$classname$::$name$)\n"
+		"			.def(\"mutable_$name$\", &$classname$::mutable_$name$)\n");
+	PrintLuaBindRepeatedBulkDefs(printer, variables_);
+}
+
+void RepeatedEnumFieldGenerator::GenerateLuaBindFunctions(io::Printer* printer) const {
+	// The generated setters only DCHECK their values, so check them here.
+	printer->Print(variables_,
+		"static void $classname$_lua_set_$name$($classname$* message, int index, int value) {\n"
+		"	if (!$type$_IsValid(value)) throw std::invalid_argument(\"invalid enum value\");\n"
+		"	message->set_$name$(index, static_cast< $type$ >(value));\n"
+		"}\n"
+		"\n"
+		"static void $classname$_lua_add_$name$($classname$* message, int value) {\n"
+		"	if (!$type$_IsValid(value)) throw std::invalid_argument(\"invalid enum value\");\n"
+		"	message->add_$name$(static_cast< $type$ >(value));\n"
+		"}\n"
+		"\n");
+	PrintLuaBindRepeatedBulkFunctions(printer, descriptor_, variables_);
 }
 
 // ----------------------------------------------------
@@ -395,6 +848,9 @@ void PrimitiveFieldGenerator::GenerateLuaBindCode(io::Printer* printer) const {
 		"\n");
 }
 
+void PrimitiveFieldGenerator::GenerateLuaBindFunctions(io::Printer* printer) const {
+}
+
 // ----------------------------------------------------
 // RepeatedPrimitiveFieldGenerator
 void RepeatedPrimitiveFieldGenerator::GenerateLuaBindCode(io::Printer* printer) const {
@@ -403,8 +859,12 @@ void RepeatedPrimitiveFieldGenerator::GenerateLuaBindCode(io::Printer* printer)
 		"			.def(\"set_$name$\", &$classname$::set_$name$)\n"
 		"			.def(\"add_$name$\", &$classname$::add_$name$)\n"
 		"			.def(\"$name$\", (const ::google::protobuf::RepeatedField< $type$ >& ($classname$::*)() const$deprecation$)&$classname$::$name$)\n"
-		"			.def(\"mutable_$name$\", &$classname$::mutable_$name$)\n"
-		"\n");
+		"			.def(\"mutable_$name$\", &$classname$::mutable_$name$)\n");
+	PrintLuaBindRepeatedBulkDefs(printer, variables_);
+}
+
+void RepeatedPrimitiveFieldGenerator::GenerateLuaBindFunctions(io::Printer* printer) const {
+	PrintLuaBindRepeatedBulkFunctions(printer, descriptor_, variables_);
 }
 
 }  // namespace cpp
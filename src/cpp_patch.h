@@ -11,12 +11,9 @@
 				   "#include <luabind/luabind.hpp>\n" \
 				   "\n");
 
-#define LUA_CONST_DEFINITION \
+#define LUABIND_USING_DEFINITION \
 	printer->Print( \
 		"#ifdef LUABIND_API\n" \
-		"#define LUA_CONST_START( class, state ) { luabind::object g = luabind::globals(state); luabind::object table = g[#class];\n" \
-		"#define LUA_CONST( class, name ) table[#name] = class::name;\n" \
-		"#define LUA_CONST_END }\n" \
 		"using namespace luabind;\n" \
 		"#endif\n" \
 		"\n");
@@ -26,23 +23,52 @@
 
 #define CPP_PATCH_FILE_GENERATOR_DEFINITION \
 	void GenerateLuaBindRegisterCode(io::Printer* printer); \
-	void GenerateLuaBindCode(io::Printer* printer);
+	void GenerateLuaLazyTypes(io::Printer* printer); \
+	void GenerateLuaBindCode(io::Printer* printer); \
+	void GenerateLuaBindSource(io::Printer* printer); \
+	void GenerateLuaBindRegisterFunction(io::Printer* printer, const char* linkage); \
+	void GenerateLuaArena(io::Printer* printer); \
+	void GenerateLuaRuntime(io::Printer* printer); \
+	void GenerateLuaCApiRuntime(io::Printer* printer); \
+	void GenerateLuaCApiCode(io::Printer* printer);
 
 #define CPP_PATCH_ENUM_DEFINITION \
 	void GenerateLuaBindCode(io::Printer* printer); \
 	void GenerateLuaBindDefinition(io::Printer* printer); \
-	void GenerateLuaBindMethods(io::Printer* printer);
+	void GenerateLuaBindMethods(io::Printer* printer); \
+	void GenerateLuaBindRegisterFunction(io::Printer* printer, const char* linkage); \
+	void GenerateLuaLazyTypes(io::Printer* printer); \
+	void GenerateLuaCApiMethods(io::Printer* printer);
 
 #define CPP_PATCH_MESSAGE_DEFINITION \
 	void GenerateLuaBindCode(io::Printer* printer); \
+	void GenerateLuaLazyTypes(io::Printer* printer); \
 	void GenerateLuaBindDefinition(io::Printer* printer); \
-	void GenerateLuaBindMethods(io::Printer* printer);
+	void GenerateLuaBindMethods(io::Printer* printer); \
+	void GenerateLuaBindSource(io::Printer* printer); \
+	void GenerateLuaCApiMethods(io::Printer* printer); \
+	void GenerateLuaCApiSource(io::Printer* printer); \
+	void GenerateLuaCApiFieldDispatch(io::Printer* printer); \
+	void GenerateLuaImport(io::Printer* printer); \
+	void GenerateLuaToTable(io::Printer* printer); \
+	void GenerateLuaDecoder(io::Printer* printer); \
+	void GenerateLuaEncoder(io::Printer* printer); \
+	void GenerateLuaPool(io::Printer* printer); \
+	void GenerateFieldCountsAccessor(io::Printer* printer); \
+	void GenerateFieldCountsScope(io::Printer* printer); \
+	void GenerateFieldCountsRegistration(io::Printer* printer);
 
 #define CPP_PATCH_FIELD_VOID_DEFINITION \
-	virtual void GenerateLuaBindCode(io::Printer* printer) const = 0;
+	virtual void GenerateLuaBindCode(io::Printer* printer) const = 0; \
+	virtual void GenerateLuaBindFunctions(io::Printer* printer) const = 0; \
+	virtual void GenerateLuaCApiFunctions(io::Printer* printer) const = 0; \
+	virtual void GenerateLuaCApiRegistration(io::Printer* printer) const = 0;
 
 #define CPP_PATCH_FIELD_DEFINITION \
-	virtual void GenerateLuaBindCode(io::Printer* printer) const;
+	virtual void GenerateLuaBindCode(io::Printer* printer) const; \
+	virtual void GenerateLuaBindFunctions(io::Printer* printer) const; \
+	virtual void GenerateLuaCApiFunctions(io::Printer* printer) const; \
+	virtual void GenerateLuaCApiRegistration(io::Printer* printer) const;
 
 #define DEF_REPEATED_FIELD(name, type) \
 	"typedef ::google::protobuf::RepeatedField< "#type" > Repeated"#name";\n"
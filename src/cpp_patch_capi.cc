@@ -0,0 +1,1181 @@
+#include <map>
+#include <string>
+#include <google/protobuf/stubs/strutil.h>
+#include <google/protobuf/io/printer.h>
+#include <google/protobuf/descriptor.pb.h>
+
+#include "cpp/cpp_file.h"
+#include "cpp/cpp_message.h"
+#include "cpp/cpp_field.h"
+#include "cpp/cpp_enum.h"
+#include "cpp/cpp_helpers.h"
+
+#include "cpp_patch_lua.h"
+
+#include "cpp/cpp_string_field.h"
+#include "cpp/cpp_enum_field.h"
+#include "cpp/cpp_message_field.h"
+#include "cpp/cpp_primitive_field.h"
+
+// Code generation for backend=capi: every message, enum and field accessor
+// is bound with a plain lua_CFunction instead of a luabind class_<>::def.
+//
+// Every generated function that takes a message receives the metatable of
+// its message type as upvalue 1, so checking the self argument is one
+// lua_getmetatable() and one lua_rawequal() rather than a registry lookup.
+
+namespace google {
+namespace protobuf {
+namespace compiler {
+namespace cpp {
+
+namespace {
+
+// Emitted once at global scope into every source file holding capi bindings,
+// after PrintLuaRuntime().  Everything lives in an unnamed namespace, so each
+// translation unit gets its own identical copy and no library needs to be
+// linked in.
+const char kLuaCApiRuntime[] =
+	"#include <new>\n"
+	"\n"
+	"namespace {\n"
+	"namespace protobuf_lua {\n"
+	"\n"
+	"// The payload of every message userdata.\n"
+	"struct Ref {\n"
+	"	::google::protobuf::MessageLite* message;\n"
+	"	bool owned;     // deleted by __gc\n"
+	"	bool readonly;  // reached through a const accessor\n"
+	"	bool embedded;  // constructed in the userdata itself, see PushNew()\n"
+	"	// Called by __gc instead of delete if set.\n"
+	"	void (*recycle)(::google::protobuf::MessageLite* message);\n"
+	"};\n"
+	"\n"
+	"// A userdata holding its message right after the Ref.\n"
+	"template <typename Type>\n"
+	"struct Embedded {\n"
+	"	Ref ref;\n"
+	"	union {\n"
+	"		double align;\n"
+	"		char data[sizeof(Type)];\n"
+	"	} storage;\n"
+	"};\n"
+	"\n"
+	"// Returns the message at |index| if its metatable is the one at\n"
+	"// |metatable|, NULL otherwise.\n"
+	"inline Ref* ToRef(lua_State* L, int index, int metatable) {\n"
+	"	Ref* ref = static_cast<Ref*>(lua_touserdata(L, index));\n"
+	"	if (ref == NULL || !lua_getmetatable(L, index)) return NULL;\n"
+	"	bool matches = lua_rawequal(L, -1, metatable) != 0;\n"
+	"	lua_pop(L, 1);\n"
+	"	return matches ? ref : NULL;\n"
+	"}\n"
+	"\n"
+	"inline Ref* CheckRef(lua_State* L, int index) {\n"
+	"	Ref* ref = ToRef(L, index, lua_upvalueindex(1));\n"
+	"	if (ref == NULL) {\n"
+	"		lua_getfield(L, lua_upvalueindex(1), \"__name\");\n"
+	"		luaL_argerror(L, index, lua_pushfstring(L, \"%s expected, got %s\",\n"
+	"			lua_tostring(L, -1), luaL_typename(L, index)));\n"
+	"	}\n"
+	"	if (ref->message == NULL) luaL_argerror(L, index, \"message has been collected or released\");\n"
+	"	return ref;\n"
+	"}\n"
+	"\n"
+	"template <typename Type>\n"
+	"inline Type* Check(lua_State* L, int index) {\n"
+	"	return static_cast<Type*>(CheckRef(L, index)->message);\n"
+	"}\n"
+	"\n"
+	"template <typename Type>\n"
+	"inline Type* CheckMutable(lua_State* L, int index) {\n"
+	"	Ref* ref = CheckRef(L, index);\n"
+	"	if (ref->readonly) luaL_argerror(L, index, \"message is read-only\");\n"
+	"	return static_cast<Type*>(ref->message);\n"
+	"}\n"
+	"\n"
+	"// Checks that |index| holds a message registered as |type_name|.\n"
+	"template <typename Type>\n"
+	"inline const Type* CheckMessage(lua_State* L, int index, const char* type_name) {\n"
+	"	Ref* ref = static_cast<Ref*>(luaL_checkudata(L, index, type_name));\n"
+	"	if (ref->message == NULL) luaL_argerror(L, index, \"message has been collected or released\");\n"
+	"	return static_cast<const Type*>(ref->message);\n"
+	"}\n"
+	"\n"
+	"inline int CheckIndex(lua_State* L, int index, int size) {\n"
+	"	lua_Integer value = luaL_checkinteger(L, index);\n"
+	"	luaL_argcheck(L, 0 <= value && value < size, index, \"index out of range\");\n"
+	"	return static_cast<int>(value);\n"
+	"}\n"
+	"\n"
+	"// Pushes |message| with the metatable at |metatable|.  A non-zero |owner|\n"
+	"// is kept alive for as long as the new userdata; sub-messages use it to\n"
+	"// pin the message they were borrowed from.\n"
+	"inline void PushWithMetatable(lua_State* L, ::google::protobuf::MessageLite* message,\n"
+	"		int metatable, bool owned, bool readonly, int owner) {\n"
+	"	metatable = AbsIndex(L, metatable);\n"
+	"	if (owner != 0) owner = AbsIndex(L, owner);\n"
+	"\n"
+	"	Ref* ref = static_cast<Ref*>(lua_newuserdata(L, sizeof(Ref)));\n"
+	"	ref->message = message;\n"
+	"	ref->owned = owned;\n"
+	"	ref->readonly = readonly;\n"
+	"	ref->embedded = false;\n"
+	"	ref->recycle = NULL;\n"
+	"	lua_pushvalue(L, metatable);\n"
+	"	lua_setmetatable(L, -2);\n"
+	"\n"
+	"	if (owner != 0) {\n"
+	"		lua_createtable(L, 1, 0);\n"
+	"		lua_pushvalue(L, owner);\n"
+	"		lua_rawseti(L, -2, 1);\n"
+	"		PROTOBUF_LUA_SETUSERVALUE(L, -2);\n"
+	"	}\n"
+	"\n"
+	"#ifdef PROTOBUF_LUA_ARENA_H__\n"
+	"	::protobuf_lua_arena::Arena* arena = ::protobuf_lua_arena::Arena::Current();\n"
+	"	if (arena != NULL && arena->Contains(message)) TrackArenaMessage(L, message);\n"
+	"#endif\n"
+	"}\n"
+	"\n"
+	"// Same, for a message type registered under |type_name| by some other\n"
+	"// RegisterToLua().\n"
+	"inline void Push(lua_State* L, ::google::protobuf::MessageLite* message,\n"
+	"		const char* type_name, bool owned, bool readonly, int owner) {\n"
+	"	if (owner != 0) owner = AbsIndex(L, owner);\n"
+	"	luaL_getmetatable(L, type_name);\n"
+	"	if (lua_isnil(L, -1)) {\n"
+	"		if (owned) delete message;\n"
+	"		luaL_error(L, \"%s has not been registered with Lua\", type_name);\n"
+	"	}\n"
+	"	PushWithMetatable(L, message, -1, owned, readonly, owner);\n"
+	"	lua_remove(L, -2);\n"
+	"}\n"
+	"\n"
+	"// Pushes a new Type with the metatable at |metatable|.  The message is\n"
+	"// constructed inside the userdata, so it costs a single allocation and\n"
+	"// __gc only runs its destructor.  Not for messages that belong in an arena.\n"
+	"template <typename Type>\n"
+	"Type* PushNew(lua_State* L, int metatable) {\n"
+	"	metatable = AbsIndex(L, metatable);\n"
+	"	Embedded<Type>* block = static_cast<Embedded<Type>*>(\n"
+	"		lua_newuserdata(L, sizeof(Embedded<Type>)));\n"
+	"	block->ref.message = NULL;\n"
+	"	block->ref.owned = false;\n"
+	"	block->ref.readonly = false;\n"
+	"	block->ref.embedded = false;\n"
+	"	block->ref.recycle = NULL;\n"
+	"	lua_pushvalue(L, metatable);\n"
+	"	lua_setmetatable(L, -2);\n"
+	"\n"
+	"	// ::new, since a class with its own operator new hides placement new.\n"
+	"	Type* message = ::new (block->storage.data) Type;\n"
+	"	block->ref.message = message;\n"
+	"	block->ref.owned = true;\n"
+	"	block->ref.embedded = true;\n"
+	"	return message;\n"
+	"}\n"
+	"\n"
+	"// Pushes the borrowed view of |message|, a sub-message of the message at\n"
+	"// |owner| registered as |type_name|; see FindView().\n"
+	"inline void PushView(lua_State* L, const ::google::protobuf::MessageLite* message,\n"
+	"		const char* type_name, bool readonly, int owner) {\n"
+	"	if (FindView(L, message, readonly, owner)) return;\n"
+	"	owner = AbsIndex(L, owner);\n"
+	"	Push(L, const_cast< ::google::protobuf::MessageLite*>(message), type_name,\n"
+	"		false, readonly, 0);\n"
+	"	CacheView(L, message, readonly, owner);\n"
+	"}\n"
+	"\n"
+	"// Invalidates the views of |message| before it changes hands.\n"
+	"inline void InvalidateViews(lua_State* L, const ::google::protobuf::MessageLite* message) {\n"
+	"	ForgetViews(L, message);\n"
+	"	for (int i = -2; i <= -1; i++) {\n"
+	"		Ref* ref = static_cast<Ref*>(lua_touserdata(L, i));\n"
+	"		if (ref != NULL) ref->message = NULL;\n"
+	"	}\n"
+	"	lua_pop(L, 2);\n"
+	"}\n"
+	"\n"
+	"// Invalidates the views borrowed from the messages at |first| and\n"
+	"// |second| before their sub-messages trade places; see ForgetOwnedViews().\n"
+	"inline void InvalidateOwnedViews(lua_State* L, int first, int second) {\n"
+	"	ForgetOwnedViews(L, first, second);\n"
+	"	int size = static_cast<int>(PROTOBUF_LUA_RAWLEN(L, -1));\n"
+	"	for (int i = 1; i <= size; i++) {\n"
+	"		lua_rawgeti(L, -1, i);\n"
+	"		Ref* ref = static_cast<Ref*>(lua_touserdata(L, -1));\n"
+	"		if (ref != NULL) ref->message = NULL;\n"
+	"		lua_pop(L, 1);\n"
+	"	}\n"
+	"	lua_pop(L, 1);\n"
+	"}\n"
+	"\n"
+	"int Gc(lua_State* L) {\n"
+	"	Ref* ref = static_cast<Ref*>(lua_touserdata(L, 1));\n"
+	"	if (ref->owned) {\n"
+	"		if (ref->embedded) {\n"
+	"			ref->message->~MessageLite();\n"
+	"		} else if (ref->recycle != NULL) {\n"
+	"			ref->recycle(ref->message);\n"
+	"		} else {\n"
+	"			delete ref->message;\n"
+	"		}\n"
+	"	}\n"
+	"	ref->message = NULL;\n"
+	"	ref->owned = false;\n"
+	"	ref->embedded = false;\n"
+	"	return 0;\n"
+	"}\n"
+	"\n"
+	"int ToString(lua_State* L) {\n"
+	"	Ref* ref = CheckRef(L, 1);\n"
+	"	lua_pushfstring(L, \"%s: %p\", ref->message->GetTypeName().c_str(),\n"
+	"		static_cast<void*>(ref->message));\n"
+	"	return 1;\n"
+	"}\n"
+	"\n"
+	"int Clear(lua_State* L) {\n"
+	"	CheckMutable< ::google::protobuf::MessageLite>(L, 1)->Clear();\n"
+	"	return 0;\n"
+	"}\n"
+	"\n"
+	"int IsInitialized(lua_State* L) {\n"
+	"	lua_pushboolean(L, Check< ::google::protobuf::MessageLite>(L, 1)->IsInitialized());\n"
+	"	return 1;\n"
+	"}\n"
+	"\n"
+	"int InitializationErrorString(lua_State* L) {\n"
+	"	PushString(L, Check< ::google::protobuf::MessageLite>(L, 1)->InitializationErrorString());\n"
+	"	return 1;\n"
+	"}\n"
+	"\n"
+	"int ByteSize(lua_State* L) {\n"
+	"	lua_pushinteger(L, Check< ::google::protobuf::MessageLite>(L, 1)->ByteSize());\n"
+	"	return 1;\n"
+	"}\n"
+	"\n"
+	"int GetCachedSize(lua_State* L) {\n"
+	"	lua_pushinteger(L, Check< ::google::protobuf::MessageLite>(L, 1)->GetCachedSize());\n"
+	"	return 1;\n"
+	"}\n"
+	"\n"
+	"int GetTypeName(lua_State* L) {\n"
+	"	PushString(L, Check< ::google::protobuf::MessageLite>(L, 1)->GetTypeName());\n"
+	"	return 1;\n"
+	"}\n"
+	"\n"
+	"// Returns the serialized message, or nil if required fields are missing.\n"
+	"int SerializeToString(lua_State* L) {\n"
+	"	::std::string output;\n"
+	"	if (Check< ::google::protobuf::MessageLite>(L, 1)->SerializeToString(&output)) {\n"
+	"		PushString(L, output);\n"
+	"	} else {\n"
+	"		lua_pushnil(L);\n"
+	"	}\n"
+	"	return 1;\n"
+	"}\n"
+	"\n"
+	"int SerializePartialToString(lua_State* L) {\n"
+	"	PushString(L, Check< ::google::protobuf::MessageLite>(L, 1)->SerializePartialAsString());\n"
+	"	return 1;\n"
+	"}\n"
+	"\n"
+	"int ParseFromString(lua_State* L) {\n"
+	"	::google::protobuf::MessageLite* message = CheckMutable< ::google::protobuf::MessageLite>(L, 1);\n"
+	"	size_t size;\n"
+	"	const char* data = luaL_checklstring(L, 2, &size);\n"
+	"	lua_pushboolean(L, message->ParseFromArray(data, static_cast<int>(size)));\n"
+	"	return 1;\n"
+	"}\n"
+	"\n"
+	"int ParsePartialFromString(lua_State* L) {\n"
+	"	::google::protobuf::MessageLite* message = CheckMutable< ::google::protobuf::MessageLite>(L, 1);\n"
+	"	size_t size;\n"
+	"	const char* data = luaL_checklstring(L, 2, &size);\n"
+	"	lua_pushboolean(L, message->ParsePartialFromArray(data, static_cast<int>(size)));\n"
+	"	return 1;\n"
+	"}\n"
+	"\n"
+	"int CopyFrom(lua_State* L) {\n"
+	"	::google::protobuf::MessageLite* message = CheckMutable< ::google::protobuf::MessageLite>(L, 1);\n"
+	"	const ::google::protobuf::MessageLite* from = Check< ::google::protobuf::MessageLite>(L, 2);\n"
+	"	if (from != message) {\n"
+	"		message->Clear();\n"
+	"		message->CheckTypeAndMergeFrom(*from);\n"
+	"	}\n"
+	"	return 0;\n"
+	"}\n"
+	"\n"
+	"int MergeFrom(lua_State* L) {\n"
+	"	::google::protobuf::MessageLite* message = CheckMutable< ::google::protobuf::MessageLite>(L, 1);\n"
+	"	const ::google::protobuf::MessageLite* from = Check< ::google::protobuf::MessageLite>(L, 2);\n"
+	"	luaL_argcheck(L, from != message, 2, \"cannot merge a message into itself\");\n"
+	"	message->CheckTypeAndMergeFrom(*from);\n"
+	"	return 0;\n"
+	"}\n"
+	"\n"
+	"int New(lua_State* L) {\n"
+	"	PushWithMetatable(L, Check< ::google::protobuf::MessageLite>(L, 1)->New(),\n"
+	"		lua_upvalueindex(1), true, false, 0);\n"
+	"	return 1;\n"
+	"}\n"
+	"\n"
+	"const luaL_Reg kMessageLiteMethods[] = {\n"
+	"	{\"Clear\", &Clear},\n"
+	"	{\"IsInitialized\", &IsInitialized},\n"
+	"	{\"InitializationErrorString\", &InitializationErrorString},\n"
+	"	{\"ByteSize\", &ByteSize},\n"
+	"	{\"GetCachedSize\", &GetCachedSize},\n"
+	"	{\"GetTypeName\", &GetTypeName},\n"
+	"	{\"SerializeToString\", &SerializeToString},\n"
+	"	{\"SerializePartialToString\", &SerializePartialToString},\n"
+	"	{\"ParseFromString\", &ParseFromString},\n"
+	"	{\"ParsePartialFromString\", &ParsePartialFromString},\n"
+	"	{\"CopyFrom\", &CopyFrom},\n"
+	"	{\"MergeFrom\", &MergeFrom},\n"
+	"	{\"CheckTypeAndMergeFrom\", &MergeFrom},\n"
+	"	{\"New\", &New},\n"
+	"	{NULL, NULL}\n"
+	"};\n"
+	"\n";
+
+// The part of the runtime that needs the full (non-lite) Message interface.
+const char kLuaCApiFullRuntime[] =
+	"int DebugString(lua_State* L) {\n"
+	"	PushString(L, Check< ::google::protobuf::Message>(L, 1)->DebugString());\n"
+	"	return 1;\n"
+	"}\n"
+	"\n"
+	"int ShortDebugString(lua_State* L) {\n"
+	"	PushString(L, Check< ::google::protobuf::Message>(L, 1)->ShortDebugString());\n"
+	"	return 1;\n"
+	"}\n"
+	"\n"
+	"int Utf8DebugString(lua_State* L) {\n"
+	"	PushString(L, Check< ::google::protobuf::Message>(L, 1)->Utf8DebugString());\n"
+	"	return 1;\n"
+	"}\n"
+	"\n"
+	"int SpaceUsed(lua_State* L) {\n"
+	"	lua_pushinteger(L, Check< ::google::protobuf::Message>(L, 1)->SpaceUsed());\n"
+	"	return 1;\n"
+	"}\n"
+	"\n"
+	"int DiscardUnknownFields(lua_State* L) {\n"
+	"	CheckMutable< ::google::protobuf::Message>(L, 1)->DiscardUnknownFields();\n"
+	"	return 0;\n"
+	"}\n"
+	"\n"
+	"const luaL_Reg kMessageMethods[] = {\n"
+	"	{\"DebugString\", &DebugString},\n"
+	"	{\"ShortDebugString\", &ShortDebugString},\n"
+	"	{\"Utf8DebugString\", &Utf8DebugString},\n"
+	"	{\"SpaceUsed\", &SpaceUsed},\n"
+	"	{\"DiscardUnknownFields\", &DiscardUnknownFields},\n"
+	"	{NULL, NULL}\n"
+	"};\n"
+	"\n";
+
+const char kLuaCApiRegistration[] =
+	"// Stores |functions| into the table at |table| as closures over the\n"
+	"// metatable at |metatable|.\n"
+	"inline void SetFunctions(lua_State* L, int table, int metatable, const luaL_Reg* functions) {\n"
+	"	for (; functions->name != NULL; functions++) {\n"
+	"		lua_pushvalue(L, metatable);\n"
+	"		lua_pushcclosure(L, functions->func, 1);\n"
+	"		lua_setfield(L, table, functions->name);\n"
+	"	}\n"
+	"}\n"
+	"\n"
+	"// Registers the metatable |type_name| for a message class and exposes the\n"
+	"// class as the global |global_name|: calling it constructs a message, and\n"
+	"// it holds |constants| and |functions| (closures over the metatable).\n"
+	"//\n"
+	"// |index| and |newindex|, if not NULL, resolve field names; |index| falls\n"
+	"// back to the methods table, which it gets as upvalue 2.\n"
+	"inline void RegisterClass(lua_State* L, const char* type_name, const char* global_name,\n"
+	"		const luaL_Reg* methods, const Constant* constants,\n"
+	"		lua_CFunction constructor, const luaL_Reg* functions,\n"
+	"		lua_CFunction index, lua_CFunction newindex) {\n"
+	"	static const luaL_Reg kMetamethods[] = {\n"
+	"		{\"__gc\", &Gc},\n"
+	"		{\"__tostring\", &ToString},\n"
+	"		{NULL, NULL}\n"
+	"	};\n"
+	"\n"
+	"	luaL_newmetatable(L, type_name);\n"
+	"	int metatable = lua_gettop(L);\n"
+	"	lua_pushstring(L, type_name);\n"
+	"	lua_setfield(L, metatable, \"__name\");\n"
+	"	SetFunctions(L, metatable, metatable, kMetamethods);\n"
+	"\n"
+	"	lua_newtable(L);\n"
+	"	SetFunctions(L, metatable + 1, metatable, kMessageLiteMethods);\n"
+	"$full_methods$"
+	"	SetFunctions(L, metatable + 1, metatable, methods);\n"
+	"	if (index != NULL) {\n"
+	"		lua_pushvalue(L, metatable);\n"
+	"		lua_insert(L, -2);\n"
+	"		lua_pushcclosure(L, index, 2);\n"
+	"	}\n"
+	"	lua_setfield(L, metatable, \"__index\");\n"
+	"	if (newindex != NULL) {\n"
+	"		lua_pushvalue(L, metatable);\n"
+	"		lua_pushcclosure(L, newindex, 1);\n"
+	"		lua_setfield(L, metatable, \"__newindex\");\n"
+	"	}\n"
+	"\n"
+	"	PushConstants(L, constants, 0);\n"
+	"	SetFunctions(L, metatable + 1, metatable, functions);\n"
+	"\n"
+	"	lua_createtable(L, 0, 1);\n"
+	"	lua_pushvalue(L, metatable);\n"
+	"	lua_pushcclosure(L, constructor, 1);\n"
+	"	lua_setfield(L, -2, \"__call\");\n"
+	"	lua_setmetatable(L, metatable + 1);\n"
+	"	lua_setglobal(L, global_name);\n"
+	"\n"
+	"	lua_pop(L, 1);\n"
+	"}\n"
+	"\n"
+	"// Exposes an enum as the global table |global_name| mapping value names\n"
+	"// to numbers, and |functions| as globals.\n"
+	"inline void RegisterEnum(lua_State* L, const char* global_name,\n"
+	"		const Constant* values, const luaL_Reg* functions) {\n"
+	"	PushConstants(L, values, 0);\n"
+	"	lua_setglobal(L, global_name);\n"
+	"\n"
+	"	for (; functions->name != NULL; functions++) {\n"
+	"		lua_pushcfunction(L, functions->func);\n"
+	"		lua_setglobal(L, functions->name);\n"
+	"	}\n"
+	"}\n"
+	"\n"
+	"}  // namespace protobuf_lua\n"
+	"}  // namespace\n"
+	"\n";
+
+// Functions for the accessors every field has.
+void PrintLuaCApiCommonFunctions(io::Printer* printer, const FieldDescriptor* field) {
+	map<string, string> vars;
+	SetCommonFieldVariables(field, &vars);
+
+	if (field->is_repeated()) {
+		printer->Print(vars,
+			"static int $classname$_lua_$name$_size(lua_State* L) {\n"
+			"	lua_pushinteger(L, ::protobuf_lua::Check< $classname$ >(L, 1)->$name$_size());\n"
+			"	return 1;\n"
+			"}\n"
+			"\n");
+	} else {
+		printer->Print(vars,
+			"static int $classname$_lua_has_$name$(lua_State* L) {\n"
+			"	lua_pushboolean(L, ::protobuf_lua::Check< $classname$ >(L, 1)->has_$name$());\n"
+			"	return 1;\n"
+			"}\n"
+			"\n");
+	}
+
+	printer->Print(vars,
+		"static int $classname$_lua_clear_$name$(lua_State* L) {\n"
+		"	::protobuf_lua::CheckMutable< $classname$ >(L, 1)->clear_$name$();\n"
+		"	return 0;\n"
+		"}\n"
+		"\n");
+}
+
+void PrintLuaCApiCommonRegistration(io::Printer* printer, const FieldDescriptor* field) {
+	map<string, string> vars;
+	SetCommonFieldVariables(field, &vars);
+
+	if (field->is_repeated()) {
+		printer->Print(vars,
+			"		{\"$name$_size\", &$classname$_lua_$name$_size},\n");
+	} else {
+		printer->Print(vars,
+			"		{\"has_$name$\", &$classname$_lua_has_$name$},\n");
+	}
+	printer->Print(vars,
+		"		{\"clear_$name$\", &$classname$_lua_clear_$name$},\n");
+}
+
+// Prints the getter and setter shared by singular primitive, enum and
+// string fields.
+void PrintLuaCApiScalarFunctions(io::Printer* printer, const FieldDescriptor* field,
+		const map<string, string>& variables) {
+	printer->Print(variables,
+		"static int $classname$_lua_$name$(lua_State* L) {\n"
+		"	const $classname$* message = ::protobuf_lua::Check< $classname$ >(L, 1);\n");
+	printer->Indent();
+	PrintLuaPush(printer, field, "message->" + variables.find("name")->second + "()");
+	printer->Outdent();
+	printer->Print(
+		"	return 1;\n"
+		"}\n"
+		"\n");
+
+	printer->Print(variables,
+		"static int $classname$_lua_set_$name$(lua_State* L) {\n"
+		"	$classname$* message = ::protobuf_lua::CheckMutable< $classname$ >(L, 1);\n");
+	printer->Indent();
+	string argument = PrintLuaCheck(printer, field, "2");
+	printer->Outdent();
+	printer->Print(
+		"	message->set_$name$($argument$);\n"
+		"	return 0;\n"
+		"}\n"
+		"\n",
+		"name", variables.find("name")->second,
+		"argument", argument);
+}
+
+}  // namespace
+
+// ----------------------------------------------------
+// FileGenerator
+// begin
+void FileGenerator::GenerateLuaCApiRuntime(io::Printer* printer) {
+	printer->Print(kLuaCApiRuntime);
+	if (HasDescriptorMethods(file_)) {
+		printer->Print(kLuaCApiFullRuntime);
+	}
+	printer->Print(kLuaCApiRegistration,
+		"full_methods", HasDescriptorMethods(file_)
+			? "	SetFunctions(L, metatable + 1, metatable, kMessageMethods);\n" : "");
+}
+
+void FileGenerator::GenerateLuaCApiCode(io::Printer* printer) {
+	for (int i = 0; i < file_->enum_type_count(); i++) {
+		enum_generators_[i]->GenerateLuaCApiMethods(printer);
+	}
+	for (int i = 0; i < file_->message_type_count(); i++) {
+		message_generators_[i]->GenerateLuaCApiSource(printer);
+	}
+
+	GenerateLuaBindRegisterFunction(printer, "");
+}
+// end
+
+// ----------------------------------------------------
+// MessageGenerator
+// begin
+void MessageGenerator::GenerateLuaCApiSource(io::Printer* printer) {
+	for (int i = 0; i < descriptor_->enum_type_count(); i++) {
+		enum_generators_[i]->GenerateLuaCApiMethods(printer);
+	}
+
+	for (int i = 0; i < descriptor_->nested_type_count(); i++) {
+		nested_generators_[i]->GenerateLuaCApiSource(printer);
+	}
+
+	GenerateLuaCApiMethods(printer);
+}
+
+void MessageGenerator::GenerateLuaCApiMethods(io::Printer* printer) {
+	map<string, string> vars;
+	vars["classname"] = classname_;
+	vars["full_name"] = descriptor_->full_name();
+
+	vector<const FieldDescriptor*> fields;
+	ListLuaNamedFields(descriptor_, &fields);
+	if (!fields.empty()) {
+		vars["index"] = "&" + classname_ + "_lua_index";
+		vars["newindex"] = "&" + classname_ + "_lua_newindex";
+	} else {
+		vars["index"] = "NULL";
+		vars["newindex"] = "NULL";
+	}
+
+	printer->Print(vars,
+		"// -------------------------------------------------------------------\n"
+		"// $classname$ Lua bindings\n"
+		"\n");
+	if (options_.lua_pool > 0) {
+		printer->Print(vars,
+			"static void $classname$_lua_Recycle(::google::protobuf::MessageLite* message) {\n"
+			"	$classname$::Recycle(static_cast<$classname$*>(message));\n"
+			"}\n"
+			"\n"
+			"static int $classname$_lua_new(lua_State* L) {\n"
+			"	const $classname$* from = lua_isnoneornil(L, 2) ? NULL : ::protobuf_lua::Check< $classname$ >(L, 2);\n"
+			"	$classname$* message = $classname$::Acquire();\n"
+			"	if (message == NULL) message = new $classname$;\n"
+			"	if (from != NULL) message->CopyFrom(*from);\n"
+			"	::protobuf_lua::PushWithMetatable(L, message, lua_upvalueindex(1), true, false, 0);\n"
+			"	static_cast< ::protobuf_lua::Ref*>(lua_touserdata(L, -1))->recycle = &$classname$_lua_Recycle;\n"
+			"	return 1;\n"
+			"}\n"
+			"\n");
+	} else if (options_.lua_arena) {
+		// Inside pb.with_arena the message has to come from the arena, which
+		// only its operator new allocates from, so it is not embedded there.
+		printer->Print(vars,
+			"static int $classname$_lua_new(lua_State* L) {\n"
+			"	const $classname$* from = lua_isnoneornil(L, 2) ? NULL : ::protobuf_lua::Check< $classname$ >(L, 2);\n"
+			"	$classname$* message;\n"
+			"	if (::protobuf_lua_arena::Arena::Current() != NULL) {\n"
+			"		message = new $classname$;\n"
+			"		::protobuf_lua::PushWithMetatable(L, message, lua_upvalueindex(1), true, false, 0);\n"
+			"	} else {\n"
+			"		message = ::protobuf_lua::PushNew< $classname$ >(L, lua_upvalueindex(1));\n"
+			"	}\n"
+			"	if (from != NULL) message->CopyFrom(*from);\n"
+			"	return 1;\n"
+			"}\n"
+			"\n");
+	} else {
+		printer->Print(vars,
+			"static int $classname$_lua_new(lua_State* L) {\n"
+			"	const $classname$* from = lua_isnoneornil(L, 2) ? NULL : ::protobuf_lua::Check< $classname$ >(L, 2);\n"
+			"	$classname$* message = ::protobuf_lua::PushNew< $classname$ >(L, lua_upvalueindex(1));\n"
+			"	if (from != NULL) message->CopyFrom(*from);\n"
+			"	return 1;\n"
+			"}\n"
+			"\n");
+	}
+	printer->Print(vars,
+		"static int $classname$_lua_default_instance(lua_State* L) {\n"
+		"	::protobuf_lua::PushWithMetatable(L, const_cast< $classname$*>(&$classname$::default_instance()),\n"
+		"		lua_upvalueindex(1), false, true, 0);\n"
+		"	return 1;\n"
+		"}\n"
+		"\n"
+		"static int $classname$_lua_Swap(lua_State* L) {\n"
+		"	$classname$* message = ::protobuf_lua::CheckMutable< $classname$ >(L, 1);\n"
+		"	$classname$* other = ::protobuf_lua::CheckMutable< $classname$ >(L, 2);\n"
+		"	::protobuf_lua::InvalidateOwnedViews(L, 1, 2);\n"
+		"	message->Swap(other);\n"
+		"	return 0;\n"
+		"}\n"
+		"\n");
+
+	for (int i = 0; i < descriptor_->field_count(); i++) {
+		PrintLuaCApiCommonFunctions(printer, descriptor_->field(i));
+		field_generators_.get(descriptor_->field(i)).GenerateLuaCApiFunctions(printer);
+	}
+
+	if (!fields.empty()) {
+		PrintLuaFieldLookup(printer, classname_, fields);
+		GenerateLuaCApiFieldDispatch(printer);
+	}
+	GenerateLuaImport(printer);
+	GenerateLuaToTable(printer);
+	GenerateLuaDecoder(printer);
+	GenerateLuaEncoder(printer);
+
+	printer->Print(vars,
+		"static int $classname$_lua_import(lua_State* L) {\n"
+		"	::protobuf_lua::CheckMutable< $classname$ >(L, 1)->ImportFromLua(L, 2);\n"
+		"	return 0;\n"
+		"}\n"
+		"\n"
+		"static int $classname$_lua_to_table(lua_State* L) {\n"
+		"	::protobuf_lua::Check< $classname$ >(L, 1)->ToTable(L);\n"
+		"	return 1;\n"
+		"}\n"
+		"\n");
+
+	printer->Print(vars,
+		"void $classname$::RegisterToLua(lua_State* L) {\n"
+		"	static const luaL_Reg kMethods[] = {\n"
+		"		{\"Swap\", &$classname$_lua_Swap},\n"
+		"		{\"import\", &$classname$_lua_import},\n"
+		"		{\"to_table\", &$classname$_lua_to_table},\n");
+	for (int i = 0; i < descriptor_->field_count(); i++) {
+		PrintLuaCApiCommonRegistration(printer, descriptor_->field(i));
+		field_generators_.get(descriptor_->field(i)).GenerateLuaCApiRegistration(printer);
+	}
+	printer->Print(
+		"		{NULL, NULL}\n"
+		"	};\n"
+		"	static const ::protobuf_lua::Constant kConstants[] = {\n");
+	for (int i = 0; i < descriptor_->field_count(); i++) {
+		printer->Print(
+			"		{\"$constant_name$\", $constant_name$},\n",
+			"constant_name", FieldConstantName(descriptor_->field(i)));
+	}
+	printer->Print(vars,
+		"		{NULL, 0}\n"
+		"	};\n"
+		"	static const luaL_Reg kFunctions[] = {\n"
+		"		{\"default_instance\", &$classname$_lua_default_instance},\n"
+		"		{\"decode\", &::protobuf_lua::Decode< $classname$ >},\n"
+		"		{\"encode\", &::protobuf_lua::Encode< $classname$ >},\n"
+		"		{NULL, NULL}\n"
+		"	};\n"
+		"	::protobuf_lua::RegisterClass(L, \"$full_name$\", \"$classname$\", kMethods, kConstants,\n"
+		"		&$classname$_lua_new, kFunctions,\n"
+		"		$index$, $newindex$);\n");
+	if (options_.lua_arena) {
+		printer->Print(
+			"	::protobuf_lua::RegisterArena(L);\n");
+	}
+	if (options_.field_counters) {
+		printer->Print(
+			"	::protobuf_lua::RegisterFieldCounters(L);\n");
+	}
+	printer->Print(
+		"}\n"
+		"\n");
+}
+
+// __index and __newindex resolving field names through a perfect hash, so
+// that scripts can use msg.field and msg.field = value.  __index falls back
+// to the methods table for anything that is not a singular field; reading a
+// message field of a writable message goes through mutable_field(), so that
+// msg.sub.x = 1 works.  __newindex clears a field assigned nil and replaces
+// the contents of a repeated field assigned a sequence.
+void MessageGenerator::GenerateLuaCApiFieldDispatch(io::Printer* printer) {
+	vector<const FieldDescriptor*> fields;
+	ListLuaNamedFields(descriptor_, &fields);
+
+	map<string, string> vars;
+	vars["classname"] = classname_;
+	vars["full_name"] = descriptor_->full_name();
+
+	printer->Print(vars,
+		"static int $classname$_lua_index(lua_State* L) {\n"
+		"	::protobuf_lua::Ref* ref = ::protobuf_lua::CheckRef(L, 1);\n"
+		"	$classname$* message = static_cast< $classname$*>(ref->message);\n"
+		"	switch ($classname$_lua_FindField(L, 2)) {\n");
+	printer->Indent();
+	for (int i = 0; i < fields.size(); i++) {
+		const FieldDescriptor* field = fields[i];
+		if (field->is_repeated()) continue;
+
+		map<string, string> field_vars;
+		SetCommonFieldVariables(field, &field_vars);
+		printer->Print(field_vars,
+			"case $number$:\n");
+		printer->Indent();
+		if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+			field_vars["type"] = FieldMessageTypeName(field);
+			field_vars["full_name"] = field->message_type()->full_name();
+			printer->Print(field_vars,
+				"if (ref->readonly) {\n"
+				"	::protobuf_lua::PushView(L, &message->$name$(), \"$full_name$\", true, 1);\n"
+				"} else {\n"
+				"	::protobuf_lua::PushView(L, message->mutable_$name$(), \"$full_name$\", false, 1);\n"
+				"}\n");
+		} else {
+			PrintLuaPush(printer, field, "message->" + FieldName(field) + "()");
+		}
+		printer->Print(
+			"return 1;\n");
+		printer->Outdent();
+	}
+	printer->Outdent();
+	printer->Print(
+		"	}\n"
+		"	lua_pushvalue(L, 2);\n"
+		"	lua_rawget(L, lua_upvalueindex(2));\n"
+		"	return 1;\n"
+		"}\n"
+		"\n");
+
+	printer->Print(vars,
+		"static int $classname$_lua_newindex(lua_State* L) {\n"
+		"	$classname$* message = ::protobuf_lua::CheckMutable< $classname$ >(L, 1);\n"
+		"	switch ($classname$_lua_FindField(L, 2)) {\n");
+	printer->Indent();
+	for (int i = 0; i < fields.size(); i++) {
+		const FieldDescriptor* field = fields[i];
+
+		printer->Print(
+			"case $number$: {\n"
+			"	if (lua_isnil(L, 3)) {\n"
+			"		message->clear_$name$();\n"
+			"		return 0;\n"
+			"	}\n",
+			"number", SimpleItoa(field->number()),
+			"name", FieldName(field));
+		printer->Indent();
+		PrintLuaAssignField(printer, field, "3", "4", "0", true, true);
+		printer->Print(
+			"return 0;\n");
+		printer->Outdent();
+		printer->Print(
+			"}\n");
+	}
+	printer->Outdent();
+	printer->Print(vars,
+		"	}\n"
+		"	return luaL_error(L, \"$full_name$ has no field %s\",\n"
+		"		lua_type(L, 2) == LUA_TSTRING ? lua_tostring(L, 2) : luaL_typename(L, 2));\n"
+		"}\n"
+		"\n");
+}
+// end
+
+// ----------------------------------------------------
+// EnumGenerator
+// begin
+void EnumGenerator::GenerateLuaCApiMethods(io::Printer* printer) {
+	map<string, string> vars;
+	vars["classname"] = classname_;
+	vars["short_name"] = descriptor_->name();
+	vars["prefix"] = (descriptor_->containing_type() == NULL) ? "" : classname_ + "_";
+
+	printer->Print(vars,
+		"static int $classname$_lua_IsValid(lua_State* L) {\n"
+		"	lua_pushboolean(L, $classname$_IsValid(static_cast<int>(luaL_checkinteger(L, 1))));\n"
+		"	return 1;\n"
+		"}\n"
+		"\n");
+
+	if (HasDescriptorMethods(descriptor_->file())) {
+		printer->Print(vars,
+			"static int $classname$_lua_Name(lua_State* L) {\n"
+			"	int value = static_cast<int>(luaL_checkinteger(L, 1));\n"
+			"	luaL_argcheck(L, $classname$_IsValid(value), 1, \"invalid enum value\");\n"
+			"	::protobuf_lua::PushString(L, $classname$_Name(static_cast< $classname$ >(value)));\n"
+			"	return 1;\n"
+			"}\n"
+			"\n"
+			"static int $classname$_lua_Parse(lua_State* L) {\n"
+			"	$classname$ value;\n"
+			"	if ($classname$_Parse(luaL_checkstring(L, 1), &value)) {\n"
+			"		lua_pushinteger(L, value);\n"
+			"	} else {\n"
+			"		lua_pushnil(L);\n"
+			"	}\n"
+			"	return 1;\n"
+			"}\n"
+			"\n");
+	}
+
+	printer->Print(vars,
+		"void $classname$_RegisterToLua(lua_State* L) {\n"
+		"	static const ::protobuf_lua::Constant kValues[] = {\n");
+	for (int i = 0; i < descriptor_->value_count(); i++) {
+		vars["name"] = descriptor_->value(i)->name();
+		vars["number"] = SimpleItoa(descriptor_->value(i)->number());
+		printer->Print(vars,
+			"		{\"$name$\", $number$},\n");
+	}
+	printer->Print(vars,
+		"		{\"MIN\", $prefix$$short_name$_MIN},\n"
+		"		{\"MAX\", $prefix$$short_name$_MAX},\n"
+		"		{\"ARRAYSIZE\", $prefix$$short_name$_ARRAYSIZE},\n"
+		"		{NULL, 0}\n"
+		"	};\n"
+		"	static const luaL_Reg kFunctions[] = {\n"
+		"		{\"$classname$_IsValid\", &$classname$_lua_IsValid},\n");
+	if (HasDescriptorMethods(descriptor_->file())) {
+		printer->Print(vars,
+			"		{\"$classname$_Name\", &$classname$_lua_Name},\n"
+			"		{\"$classname$_Parse\", &$classname$_lua_Parse},\n");
+	}
+	printer->Print(vars,
+		"		{NULL, NULL}\n"
+		"	};\n"
+		"	::protobuf_lua::RegisterEnum(L, \"$classname$\", kValues, kFunctions);\n"
+		"}\n"
+		"\n");
+}
+// end
+
+// ----------------------------------------------------
+// MessageFieldGenerator
+void MessageFieldGenerator::GenerateLuaCApiFunctions(io::Printer* printer) const {
+	map<string, string> vars(variables_);
+	vars["full_name"] = descriptor_->message_type()->full_name();
+
+	// The const accessor hands out a read-only view, like the luabind
+	// binding of a const reference.
+	printer->Print(vars,
+		"static int $classname$_lua_$name$(lua_State* L) {\n"
+		"	const $classname$* message = ::protobuf_lua::Check< $classname$ >(L, 1);\n"
+		"	::protobuf_lua::PushView(L, &message->$name$(), \"$full_name$\", true, 1);\n"
+		"	return 1;\n"
+		"}\n"
+		"\n"
+		"static int $classname$_lua_mutable_$name$(lua_State* L) {\n"
+		"	$classname$* message = ::protobuf_lua::CheckMutable< $classname$ >(L, 1);\n"
+		"	::protobuf_lua::PushView(L, message->mutable_$name$(), \"$full_name$\", false, 1);\n"
+		"	return 1;\n"
+		"}\n"
+		"\n"
+		"static int $classname$_lua_release_$name$(lua_State* L) {\n"
+		"	$classname$* message = ::protobuf_lua::CheckMutable< $classname$ >(L, 1);\n"
+		"	$type$* value = message->release_$name$();\n"
+		"	if (value == NULL) {\n"
+		"		lua_pushnil(L);\n"
+		"		return 1;\n"
+		"	}\n"
+		"	::protobuf_lua::InvalidateViews(L, value);\n"
+		"	::protobuf_lua::Push(L, value, \"$full_name$\", true, false, 0);\n"
+		"	return 1;\n"
+		"}\n"
+		"\n");
+}
+
+void MessageFieldGenerator::GenerateLuaCApiRegistration(io::Printer* printer) const {
+	printer->Print(variables_,
+		"		{\"$name$\", &$classname$_lua_$name$},\n"
+		"		{\"mutable_$name$\", &$classname$_lua_mutable_$name$},\n"
+		"		{\"release_$name$\", &$classname$_lua_release_$name$},\n");
+}
+
+// ----------------------------------------------------
+// RepeatedMessageFieldGenerator
+void RepeatedMessageFieldGenerator::GenerateLuaCApiFunctions(io::Printer* printer) const {
+	map<string, string> vars(variables_);
+	vars["full_name"] = descriptor_->message_type()->full_name();
+
+	printer->Print(vars,
+		"static int $classname$_lua_get_$name$(lua_State* L) {\n"
+		"	const $classname$* message = ::protobuf_lua::Check< $classname$ >(L, 1);\n"
+		"	int index = ::protobuf_lua::CheckIndex(L, 2, message->$name$_size());\n"
+		"	::protobuf_lua::PushView(L, &message->$name$(index), \"$full_name$\", true, 1);\n"
+		"	return 1;\n"
+		"}\n"
+		"\n"
+		"static int $classname$_lua_get_mutable_$name$(lua_State* L) {\n"
+		"	$classname$* message = ::protobuf_lua::CheckMutable< $classname$ >(L, 1);\n"
+		"	int index = ::protobuf_lua::CheckIndex(L, 2, message->$name$_size());\n"
+		"	::protobuf_lua::PushView(L, message->mutable_$name$(index), \"$full_name$\", false, 1);\n"
+		"	return 1;\n"
+		"}\n"
+		"\n"
+		"static int $classname$_lua_add_$name$(lua_State* L) {\n"
+		"	$classname$* message = ::protobuf_lua::CheckMutable< $classname$ >(L, 1);\n"
+		"	::protobuf_lua::PushView(L, message->add_$name$(), \"$full_name$\", false, 1);\n"
+		"	return 1;\n"
+		"}\n"
+		"\n");
+}
+
+void RepeatedMessageFieldGenerator::GenerateLuaCApiRegistration(io::Printer* printer) const {
+	printer->Print(variables_,
+		"		{\"get_$name$\", &$classname$_lua_get_$name$},\n"
+		"		{\"get_mutable_$name$\", &$classname$_lua_get_mutable_$name$},\n"
+		"		{\"add_$name$\", &$classname$_lua_add_$name$},\n");
+}
+
+// ----------------------------------------------------
+// StringFieldGenerator
+void StringFieldGenerator::GenerateLuaCApiFunctions(io::Printer* printer) const {
+	// Like the luabind backend, only ctype=STRING fields are bound.
+	if (descriptor_->options().ctype() != FieldOptions::STRING) return;
+
+	PrintLuaCApiScalarFunctions(printer, descriptor_, variables_);
+
+	printer->Print(variables_,
+		"static int $classname$_lua_release_$name$(lua_State* L) {\n"
+		"	$classname$* message = ::protobuf_lua::CheckMutable< $classname$ >(L, 1);\n"
+		"	::std::string* value = message->release_$name$();\n"
+		"	if (value == NULL) {\n"
+		"		lua_pushnil(L);\n"
+		"		return 1;\n"
+		"	}\n"
+		"	::protobuf_lua::PushString(L, *value);\n"
+		"	delete value;\n"
+		"	return 1;\n"
+		"}\n"
+		"\n"
+		"static int $classname$_lua_$name$_view(lua_State* L) {\n"
+		"	const $classname$* message = ::protobuf_lua::Check< $classname$ >(L, 1);\n"
+		"	::protobuf_lua::PushBytesView(L, &message->$name$(), 1);\n"
+		"	return 1;\n"
+		"}\n"
+		"\n");
+}
+
+void StringFieldGenerator::GenerateLuaCApiRegistration(io::Printer* printer) const {
+	if (descriptor_->options().ctype() != FieldOptions::STRING) return;
+
+	printer->Print(variables_,
+		"		{\"$name$\", &$classname$_lua_$name$},\n"
+		"		{\"set_$name$\", &$classname$_lua_set_$name$},\n"
+		"		{\"release_$name$\", &$classname$_lua_release_$name$},\n"
+		"		{\"$name$_view\", &$classname$_lua_$name$_view},\n");
+}
+
+// ----------------------------------------------------
+// Repeated scalar fields (primitive, enum and string) share their shape.
+namespace {
+
+void PrintLuaCApiRepeatedScalarFunctions(io::Printer* printer,
+		const FieldDescriptor* field, const map<string, string>& variables) {
+	const string& name = variables.find("name")->second;
+
+	printer->Print(variables,
+		"static int $classname$_lua_get_$name$(lua_State* L) {\n"
+		"	const $classname$* message = ::protobuf_lua::Check< $classname$ >(L, 1);\n"
+		"	int index = ::protobuf_lua::CheckIndex(L, 2, message->$name$_size());\n");
+	printer->Indent();
+	PrintLuaPush(printer, field, "message->" + name + "(index)");
+	printer->Outdent();
+	printer->Print(
+		"	return 1;\n"
+		"}\n"
+		"\n");
+
+	printer->Print(variables,
+		"static int $classname$_lua_set_$name$(lua_State* L) {\n"
+		"	$classname$* message = ::protobuf_lua::CheckMutable< $classname$ >(L, 1);\n"
+		"	int index = ::protobuf_lua::CheckIndex(L, 2, message->$name$_size());\n");
+	printer->Indent();
+	string argument = PrintLuaCheck(printer, field, "3");
+	printer->Outdent();
+	printer->Print(
+		"	message->set_$name$(index, $argument$);\n"
+		"	return 0;\n"
+		"}\n"
+		"\n",
+		"name", name,
+		"argument", argument);
+
+	printer->Print(variables,
+		"static int $classname$_lua_add_$name$(lua_State* L) {\n"
+		"	$classname$* message = ::protobuf_lua::CheckMutable< $classname$ >(L, 1);\n");
+	printer->Indent();
+	argument = PrintLuaCheck(printer, field, "2");
+	printer->Outdent();
+	printer->Print(
+		"	message->add_$name$($argument$);\n"
+		"	return 0;\n"
+		"}\n"
+		"\n",
+		"name", name,
+		"argument", argument);
+}
+
+void PrintLuaCApiRepeatedScalarRegistration(io::Printer* printer,
+		const map<string, string>& variables) {
+	printer->Print(variables,
+		"		{\"get_$name$\", &$classname$_lua_get_$name$},\n"
+		"		{\"set_$name$\", &$classname$_lua_set_$name$},\n"
+		"		{\"add_$name$\", &$classname$_lua_add_$name$},\n");
+}
+
+// Bulk accessors of repeated numeric, bool and enum fields.
+void PrintLuaCApiRepeatedBulkFunctions(io::Printer* printer,
+		const FieldDescriptor* field, const map<string, string>& variables) {
+	PrintLuaRepeatedBulkHelpers(printer, field);
+
+	printer->Print(variables,
+		"static int $classname$_lua_get_all_$name$(lua_State* L) {\n"
+		"	const $classname$* message = ::protobuf_lua::Check< $classname$ >(L, 1);\n"
+		"	$classname$_lua_Push_$name$(L, *message, 0, message->$name$_size());\n"
+		"	return 1;\n"
+		"}\n"
+		"\n"
+		"static int $classname$_lua_get_range_$name$(lua_State* L) {\n"
+		"	const $classname$* message = ::protobuf_lua::Check< $classname$ >(L, 1);\n"
+		"	int first = static_cast<int>(luaL_checkinteger(L, 2));\n"
+		"	int count = static_cast<int>(luaL_checkinteger(L, 3));\n"
+		"	::protobuf_lua::CheckRange(L, first, count, message->$name$_size(), 2);\n"
+		"	$classname$_lua_Push_$name$(L, *message, first, count);\n"
+		"	return 1;\n"
+		"}\n"
+		"\n"
+		"static int $classname$_lua_set_all_$name$(lua_State* L) {\n"
+		"	$classname$* message = ::protobuf_lua::CheckMutable< $classname$ >(L, 1);\n"
+		"	int size = $classname$_lua_Store_$name$(L, message, 2, 0);\n"
+		"	message->mutable_$name$()->Truncate(size);\n"
+		"	return 0;\n"
+		"}\n"
+		"\n"
+		"static int $classname$_lua_set_range_$name$(lua_State* L) {\n"
+		"	$classname$* message = ::protobuf_lua::CheckMutable< $classname$ >(L, 1);\n"
+		"	int first = static_cast<int>(luaL_checkinteger(L, 2));\n"
+		"	::protobuf_lua::CheckRange(L, first, 0, message->$name$_size(), 2);\n"
+		"	$classname$_lua_Store_$name$(L, message, 3, first);\n"
+		"	return 0;\n"
+		"}\n"
+		"\n");
+}
+
+void PrintLuaCApiRepeatedBulkRegistration(io::Printer* printer,
+		const map<string, string>& variables) {
+	printer->Print(variables,
+		"		{\"get_all_$name$\", &$classname$_lua_get_all_$name$},\n"
+		"		{\"get_range_$name$\", &$classname$_lua_get_range_$name$},\n"
+		"		{\"set_all_$name$\", &$classname$_lua_set_all_$name$},\n"
+		"		{\"set_range_$name$\", &$classname$_lua_set_range_$name$},\n");
+}
+
+}  // namespace
+
+// ----------------------------------------------------
+// RepeatedStringFieldGenerator
+void RepeatedStringFieldGenerator::GenerateLuaCApiFunctions(io::Printer* printer) const {
+	// The accessors of other ctypes are private.
+	if (descriptor_->options().ctype() != FieldOptions::STRING) return;
+
+	PrintLuaCApiRepeatedScalarFunctions(printer, descriptor_, variables_);
+
+	printer->Print(variables_,
+		"static int $classname$_lua_get_$name$_view(lua_State* L) {\n"
+		"	const $classname$* message = ::protobuf_lua::Check< $classname$ >(L, 1);\n"
+		"	int index = ::protobuf_lua::CheckIndex(L, 2, message->$name$_size());\n"
+		"	::protobuf_lua::PushBytesView(L, &message->$name$(index), 1);\n"
+		"	return 1;\n"
+		"}\n"
+		"\n");
+}
+
+void RepeatedStringFieldGenerator::GenerateLuaCApiRegistration(io::Printer* printer) const {
+	if (descriptor_->options().ctype() != FieldOptions::STRING) return;
+
+	PrintLuaCApiRepeatedScalarRegistration(printer, variables_);
+	printer->Print(variables_,
+		"		{\"get_$name$_view\", &$classname$_lua_get_$name$_view},\n");
+}
+
+// ----------------------------------------------------
+// EnumFieldGenerator
+void EnumFieldGenerator::GenerateLuaCApiFunctions(io::Printer* printer) const {
+	PrintLuaCApiScalarFunctions(printer, descriptor_, variables_);
+}
+
+void EnumFieldGenerator::GenerateLuaCApiRegistration(io::Printer* printer) const {
+	printer->Print(variables_,
+		"		{\"$name$\", &$classname$_lua_$name$},\n"
+		"		{\"set_$name$\", &$classname$_lua_set_$name$},\n");
+}
+
+// ----------------------------------------------------
+// RepeatedEnumFieldGenerator
+void RepeatedEnumFieldGenerator::GenerateLuaCApiFunctions(io::Printer* printer) const {
+	PrintLuaCApiRepeatedScalarFunctions(printer, descriptor_, variables_);
+	PrintLuaCApiRepeatedBulkFunctions(printer, descriptor_, variables_);
+}
+
+void RepeatedEnumFieldGenerator::GenerateLuaCApiRegistration(io::Printer* printer) const {
+	PrintLuaCApiRepeatedScalarRegistration(printer, variables_);
+	PrintLuaCApiRepeatedBulkRegistration(printer, variables_);
+}
+
+// ----------------------------------------------------
+// PrimitiveFieldGenerator
+void PrimitiveFieldGenerator::GenerateLuaCApiFunctions(io::Printer* printer) const {
+	PrintLuaCApiScalarFunctions(printer, descriptor_, variables_);
+}
+
+void PrimitiveFieldGenerator::GenerateLuaCApiRegistration(io::Printer* printer) const {
+	printer->Print(variables_,
+		"		{\"$name$\", &$classname$_lua_$name$},\n"
+		"		{\"set_$name$\", &$classname$_lua_set_$name$},\n");
+}
+
+// ----------------------------------------------------
+// RepeatedPrimitiveFieldGenerator
+void RepeatedPrimitiveFieldGenerator::GenerateLuaCApiFunctions(io::Printer* printer) const {
+	PrintLuaCApiRepeatedScalarFunctions(printer, descriptor_, variables_);
+	PrintLuaCApiRepeatedBulkFunctions(printer, descriptor_, variables_);
+}
+
+void RepeatedPrimitiveFieldGenerator::GenerateLuaCApiRegistration(io::Printer* printer) const {
+	PrintLuaCApiRepeatedScalarRegistration(printer, variables_);
+	PrintLuaCApiRepeatedBulkRegistration(printer, variables_);
+}
+
+}  // namespace cpp
+}  // namespace compiler
+}  // namespace protobuf
+
+}  // namespace google
@@ -0,0 +1,2769 @@
+#include "cpp_patch_lua.h"
+
+#include <algorithm>
+#include <map>
+#include <google/protobuf/stubs/strutil.h>
+#include <google/protobuf/io/printer.h>
+#include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/wire_format.h>
+
+#include "cpp/cpp_file.h"
+#include "cpp/cpp_message.h"
+#include "cpp/cpp_helpers.h"
+
+namespace google {
+namespace protobuf {
+namespace compiler {
+namespace cpp {
+
+using internal::WireFormat;
+
+namespace {
+
+// Emitted into every .pb.h generated with lua_arena or lua_pool, before the
+// message classes.
+const char kLuaThreadLocal[] =
+	"#ifndef PROTOBUF_LUA_THREAD_LOCAL\n"
+	"#if defined(_MSC_VER)\n"
+	"#define PROTOBUF_LUA_THREAD_LOCAL __declspec(thread)\n"
+	"#else\n"
+	"#define PROTOBUF_LUA_THREAD_LOCAL __thread\n"
+	"#endif\n"
+	"#endif\n"
+	"\n";
+
+// Emitted into every .pb.h generated with lua_arena, before the message
+// classes, whose operator new and delete call New() and Delete().  It is all
+// inline, so the definitions in different headers are the same entity.
+const char kLuaArena[] =
+	"#ifndef PROTOBUF_LUA_ARENA_H__\n"
+	"#define PROTOBUF_LUA_ARENA_H__\n"
+	"\n"
+	"#include <stddef.h>\n"
+	"#include <new>\n"
+	"\n"
+	"namespace protobuf_lua_arena {\n"
+	"\n"
+	"// A region the messages are bump-allocated from while it is current on\n"
+	"// their thread.  Deleting such a message only counts it off: the blocks\n"
+	"// are freed together once the arena is closed and its last message is\n"
+	"// gone, so a message that outlives the scope stays valid.  The messages\n"
+	"// of one arena must not be deleted concurrently.\n"
+	"class Arena {\n"
+	" public:\n"
+	"  Arena() : blocks_(NULL), top_(NULL), limit_(NULL),\n"
+	"            next_size_(kMinBlockSize), live_(0), closed_(false) {}\n"
+	"\n"
+	"  static Arena*& Current() {\n"
+	"    static PROTOBUF_LUA_THREAD_LOCAL Arena* current = NULL;\n"
+	"    return current;\n"
+	"  }\n"
+	"\n"
+	"  void* Allocate(size_t size) {\n"
+	"    size = (size + kAlignment - 1) & ~static_cast<size_t>(kAlignment - 1);\n"
+	"    ++live_;\n"
+	"    if (size > kMaxBlockSize / 4) return AddBlock(size, false);\n"
+	"    if (static_cast<size_t>(limit_ - top_) < size) AddBlock(size, true);\n"
+	"    void* result = top_;\n"
+	"    top_ += size;\n"
+	"    return result;\n"
+	"  }\n"
+	"\n"
+	"  void Release() {\n"
+	"    if (--live_ == 0 && closed_) delete this;\n"
+	"  }\n"
+	"\n"
+	"  // Ends the scope; the arena deletes itself with its last message.\n"
+	"  void Close() {\n"
+	"    closed_ = true;\n"
+	"    if (live_ == 0) delete this;\n"
+	"  }\n"
+	"\n"
+	"  bool Contains(const void* pointer) const {\n"
+	"    const char* p = static_cast<const char*>(pointer);\n"
+	"    for (Block* block = blocks_; block != NULL; block = block->next) {\n"
+	"      if (block->data() <= p && p < block->data() + block->size) return true;\n"
+	"    }\n"
+	"    return false;\n"
+	"  }\n"
+	"\n"
+	" private:\n"
+	"  enum { kAlignment = 8, kMinBlockSize = 4096, kMaxBlockSize = 65536 };\n"
+	"\n"
+	"  // Two words, so the data that follows stays 8-aligned.\n"
+	"  struct Block {\n"
+	"    Block* next;\n"
+	"    size_t size;\n"
+	"    char* data() { return reinterpret_cast<char*>(this + 1); }\n"
+	"  };\n"
+	"\n"
+	"  ~Arena() {\n"
+	"    while (blocks_ != NULL) {\n"
+	"      Block* next = blocks_->next;\n"
+	"      ::operator delete(blocks_);\n"
+	"      blocks_ = next;\n"
+	"    }\n"
+	"  }\n"
+	"\n"
+	"  // Allocates a block of at least |size| bytes.  Unless it is to become the\n"
+	"  // current one, it is linked in behind it and holds a single allocation.\n"
+	"  char* AddBlock(size_t size, bool current) {\n"
+	"    if (current && size < next_size_) size = next_size_;\n"
+	"    Block* block = static_cast<Block*>(::operator new(sizeof(Block) + size));\n"
+	"    block->size = size;\n"
+	"    if (current || blocks_ == NULL) {\n"
+	"      block->next = blocks_;\n"
+	"      blocks_ = block;\n"
+	"    } else {\n"
+	"      block->next = blocks_->next;\n"
+	"      blocks_->next = block;\n"
+	"    }\n"
+	"    if (current) {\n"
+	"      top_ = block->data();\n"
+	"      limit_ = top_ + size;\n"
+	"      if (next_size_ < kMaxBlockSize) next_size_ *= 2;\n"
+	"    }\n"
+	"    return block->data();\n"
+	"  }\n"
+	"\n"
+	"  Block* blocks_;\n"
+	"  char* top_;\n"
+	"  char* limit_;\n"
+	"  size_t next_size_;\n"
+	"  int live_;\n"
+	"  bool closed_;\n"
+	"\n"
+	"  Arena(const Arena&);\n"
+	"  void operator=(const Arena&);\n"
+	"};\n"
+	"\n"
+	"// Every allocation is preceded by the arena it came from, NULL if it came\n"
+	"// from the heap.\n"
+	"union Header {\n"
+	"  Arena* arena;\n"
+	"  double align;\n"
+	"};\n"
+	"\n"
+	"inline void* New(size_t size) {\n"
+	"  Arena* arena = Arena::Current();\n"
+	"  Header* header = static_cast<Header*>(arena != NULL\n"
+	"      ? arena->Allocate(sizeof(Header) + size)\n"
+	"      : ::operator new(sizeof(Header) + size));\n"
+	"  header->arena = arena;\n"
+	"  return header + 1;\n"
+	"}\n"
+	"\n"
+	"inline bool InArena(const void* pointer) {\n"
+	"  return (static_cast<const Header*>(pointer) - 1)->arena != NULL;\n"
+	"}\n"
+	"\n"
+	"inline void Delete(void* pointer) {\n"
+	"  if (pointer == NULL) return;\n"
+	"  Header* header = static_cast<Header*>(pointer) - 1;\n"
+	"  if (header->arena != NULL) {\n"
+	"    header->arena->Release();\n"
+	"  } else {\n"
+	"    ::operator delete(header);\n"
+	"  }\n"
+	"}\n"
+	"\n"
+	"}  // namespace protobuf_lua_arena\n"
+	"\n"
+	"#endif  // PROTOBUF_LUA_ARENA_H__\n";
+
+// Emitted into every .pb.h generated with field_counters, before the message
+// classes.  Each message type registers a Type during static initialization;
+// its accessors bump the calling thread's counts, which Flush() adds to the
+// type's totals.
+const char kFieldCounters[] =
+	"#ifndef PROTOBUF_FIELD_COUNTERS_H__\n"
+	"#define PROTOBUF_FIELD_COUNTERS_H__\n"
+	"\n"
+	"#include <string>\n"
+	"\n"
+	"namespace protobuf_field_counters {\n"
+	"\n"
+	"// The counters of one message type: a read and a write count per field,\n"
+	"// in slots 2 * index and 2 * index + 1.\n"
+	"struct Type {\n"
+	"  const char* const* field_names;         // full names, by index\n"
+	"  int field_count;\n"
+	"  ::google::protobuf::uint64* (*local)();  // the calling thread's counts\n"
+	"  ::google::protobuf::uint64* totals;      // guarded by Lock()\n"
+	"  Type* next;\n"
+	"};\n"
+	"\n"
+	"inline ::google::protobuf::internal::Mutex& Lock() {\n"
+	"  static ::google::protobuf::internal::Mutex mutex;\n"
+	"  return mutex;\n"
+	"}\n"
+	"\n"
+	"inline Type*& Types() {\n"
+	"  static Type* types = NULL;\n"
+	"  return types;\n"
+	"}\n"
+	"\n"
+	"// How deep the calling thread is in the message's own generated methods\n"
+	"// (Clear(), parsing, serialization, ByteSize(), MergeFrom(),\n"
+	"// IsInitialized()), whose calls to the accessors are not counted.\n"
+	"inline int& InternalDepth() {\n"
+	"  static PROTOBUF_LUA_THREAD_LOCAL int depth = 0;\n"
+	"  return depth;\n"
+	"}\n"
+	"\n"
+	"struct InternalScope {\n"
+	"  InternalScope() { InternalDepth()++; }\n"
+	"  ~InternalScope() { InternalDepth()--; }\n"
+	"};\n"
+	"\n"
+	"inline void Count(::google::protobuf::uint64* counts, int slot) {\n"
+	"  if (InternalDepth() == 0) counts[slot]++;\n"
+	"}\n"
+	"\n"
+	"struct Registrar {\n"
+	"  explicit Registrar(Type* type) {\n"
+	"    ::google::protobuf::internal::MutexLock lock(&Lock());\n"
+	"    type->next = Types();\n"
+	"    Types() = type;\n"
+	"  }\n"
+	"};\n"
+	"\n"
+	"// Adds the calling thread's counts to the totals and zeroes them.  Every\n"
+	"// thread using the messages has to flush before its counts are dumped.\n"
+	"inline void Flush() {\n"
+	"  ::google::protobuf::internal::MutexLock lock(&Lock());\n"
+	"  for (Type* type = Types(); type != NULL; type = type->next) {\n"
+	"    ::google::protobuf::uint64* local = type->local();\n"
+	"    for (int i = 0; i < 2 * type->field_count; i++) {\n"
+	"      type->totals[i] += local[i];\n"
+	"      local[i] = 0;\n"
+	"    }\n"
+	"  }\n"
+	"}\n"
+	"\n"
+	"// Zeroes the totals and the calling thread's counts.\n"
+	"inline void Reset() {\n"
+	"  ::google::protobuf::internal::MutexLock lock(&Lock());\n"
+	"  for (Type* type = Types(); type != NULL; type = type->next) {\n"
+	"    ::google::protobuf::uint64* local = type->local();\n"
+	"    for (int i = 0; i < 2 * type->field_count; i++) {\n"
+	"      type->totals[i] = 0;\n"
+	"      local[i] = 0;\n"
+	"    }\n"
+	"  }\n"
+	"}\n"
+	"\n"
+	"inline void AppendCount(std::string* out, ::google::protobuf::uint64 count) {\n"
+	"  char buffer[24];\n"
+	"  char* end = buffer + sizeof(buffer);\n"
+	"  char* p = end;\n"
+	"  do {\n"
+	"    *--p = static_cast<char>('0' + count % 10);\n"
+	"    count /= 10;\n"
+	"  } while (count != 0);\n"
+	"  out->push_back(' ');\n"
+	"  out->append(p, end - p);\n"
+	"}\n"
+	"\n"
+	"// Flushes the calling thread and returns the totals, one\n"
+	"// \"<full field name> <reads> <writes>\" line per field: a layout_profile\n"
+	"// for the generator.\n"
+	"inline std::string Dump() {\n"
+	"  Flush();\n"
+	"  std::string out = \"# field reads writes\\n\";\n"
+	"  ::google::protobuf::internal::MutexLock lock(&Lock());\n"
+	"  for (Type* type = Types(); type != NULL; type = type->next) {\n"
+	"    for (int i = 0; i < type->field_count; i++) {\n"
+	"      out.append(type->field_names[i]);\n"
+	"      AppendCount(&out, type->totals[2 * i]);\n"
+	"      AppendCount(&out, type->totals[2 * i + 1]);\n"
+	"      out.push_back('\\n');\n"
+	"    }\n"
+	"  }\n"
+	"  return out;\n"
+	"}\n"
+	"\n"
+	"}  // namespace protobuf_field_counters\n"
+	"\n"
+	"#endif  // PROTOBUF_FIELD_COUNTERS_H__\n";
+
+// Emitted into every .pb.h generated with packed_fast_path or table_parser,
+// before the message classes.  ReadPacked() and ReadPackedEnum() read a
+// packed run straight out of the CodedInputStream's buffer when all of it
+// is there, reserving the RepeatedField once; otherwise they fall back to
+// reading element by element under a limit, as WireFormatLite does.
+const char kPackedReader[] =
+	"#ifndef PROTOBUF_PACKED_READER_H__\n"
+	"#define PROTOBUF_PACKED_READER_H__\n"
+	"\n"
+	"#include <string.h>\n"
+	"#include <google/protobuf/wire_format_lite.h>\n"
+	"#include <google/protobuf/wire_format_lite_inl.h>\n"
+	"\n"
+	"namespace protobuf_packed_reader {\n"
+	"\n"
+	"inline ::google::protobuf::uint64 LoadWord(const ::google::protobuf::uint8* p) {\n"
+	"  ::google::protobuf::uint64 word;\n"
+	"  memcpy(&word, p, sizeof(word));\n"
+	"  return word;\n"
+	"}\n"
+	"\n"
+	"// Returns the number of varints ending in [p, end), that is of the bytes\n"
+	"// without their high bit set, counting eight bytes at a time.\n"
+	"inline int CountVarints(const ::google::protobuf::uint8* p,\n"
+	"                        const ::google::protobuf::uint8* end) {\n"
+	"  int count = 0;\n"
+	"  for (; end - p >= 8; p += 8) {\n"
+	"    ::google::protobuf::uint64 stops =\n"
+	"        (~LoadWord(p) & GOOGLE_ULONGLONG(0x8080808080808080)) >> 7;\n"
+	"    // Sums the eight 0 or 1 bytes into the top one.\n"
+	"    count += static_cast<int>(\n"
+	"        (stops * GOOGLE_ULONGLONG(0x0101010101010101)) >> 56);\n"
+	"  }\n"
+	"  for (; p < end; p++) {\n"
+	"    if (*p < 0x80) count++;\n"
+	"  }\n"
+	"  return count;\n"
+	"}\n"
+	"\n"
+	"// Decodes the varint at |p|, which may be up to ten bytes long.  Returns\n"
+	"// the byte after it, or NULL if it doesn't end before |end|.\n"
+	"inline const ::google::protobuf::uint8* ReadVarintSlow(\n"
+	"    const ::google::protobuf::uint8* p, const ::google::protobuf::uint8* end,\n"
+	"    ::google::protobuf::uint64* value) {\n"
+	"  ::google::protobuf::uint64 result = 0;\n"
+	"  for (int shift = 0; shift < 70 && p < end; shift += 7) {\n"
+	"    ::google::protobuf::uint8 byte = *p++;\n"
+	"    result |= static_cast< ::google::protobuf::uint64>(byte & 0x7f) << shift;\n"
+	"    if (byte < 0x80) {\n"
+	"      *value = result;\n"
+	"      return p;\n"
+	"    }\n"
+	"  }\n"
+	"  return NULL;\n"
+	"}\n"
+	"\n"
+	"// Decodes the varint at |p| like ReadVarintSlow().  Bytes up to\n"
+	"// |readable_end| may be loaded past |end|.  On little-endian hosts a\n"
+	"// varint of up to eight bytes is decoded from one 64-bit load: the first\n"
+	"// byte without its high bit ends it, and the 7-bit groups are packed\n"
+	"// together in three steps instead of a loop over the bytes.\n"
+	"inline const ::google::protobuf::uint8* ReadVarint(\n"
+	"    const ::google::protobuf::uint8* p, const ::google::protobuf::uint8* end,\n"
+	"    const ::google::protobuf::uint8* readable_end,\n"
+	"    ::google::protobuf::uint64* value) {\n"
+	"  if (*p < 0x80) {\n"
+	"    *value = *p;\n"
+	"    return p + 1;\n"
+	"  }\n"
+	"#ifdef PROTOBUF_LITTLE_ENDIAN\n"
+	"  if (readable_end - p >= 8) {\n"
+	"    ::google::protobuf::uint64 word = LoadWord(p);\n"
+	"    ::google::protobuf::uint64 stops =\n"
+	"        ~word & GOOGLE_ULONGLONG(0x8080808080808080);\n"
+	"    if (stops != 0) {\n"
+	"      // All the bits up to and including the first stop.\n"
+	"      ::google::protobuf::uint64 mask = ((stops & (~stops + 1)) << 1) - 1;\n"
+	"      int length = static_cast<int>(\n"
+	"          ((mask & GOOGLE_ULONGLONG(0x0101010101010101)) *\n"
+	"           GOOGLE_ULONGLONG(0x0101010101010101)) >> 56);\n"
+	"      if (end - p < length) return NULL;\n"
+	"      ::google::protobuf::uint64 x =\n"
+	"          word & mask & GOOGLE_ULONGLONG(0x7f7f7f7f7f7f7f7f);\n"
+	"      x = (x & GOOGLE_ULONGLONG(0x007f007f007f007f)) |\n"
+	"          ((x & GOOGLE_ULONGLONG(0x7f007f007f007f00)) >> 1);\n"
+	"      x = (x & GOOGLE_ULONGLONG(0x00003fff00003fff)) |\n"
+	"          ((x & GOOGLE_ULONGLONG(0x3fff00003fff0000)) >> 2);\n"
+	"      x = (x & GOOGLE_ULONGLONG(0x000000000fffffff)) |\n"
+	"          ((x & GOOGLE_ULONGLONG(0x0fffffff00000000)) >> 4);\n"
+	"      *value = x;\n"
+	"      return p + length;\n"
+	"    }\n"
+	"  }\n"
+	"#endif\n"
+	"  return ReadVarintSlow(p, end, value);\n"
+	"}\n"
+	"\n"
+	"template <typename CType,\n"
+	"          ::google::protobuf::internal::WireFormatLite::FieldType DeclaredType>\n"
+	"inline CType FromVarint(::google::protobuf::uint64 value) {\n"
+	"  typedef ::google::protobuf::internal::WireFormatLite WireFormatLite;\n"
+	"  switch (DeclaredType) {\n"
+	"    case WireFormatLite::TYPE_SINT32:\n"
+	"      return static_cast<CType>(WireFormatLite::ZigZagDecode32(\n"
+	"          static_cast< ::google::protobuf::uint32>(value)));\n"
+	"    case WireFormatLite::TYPE_SINT64:\n"
+	"      return static_cast<CType>(WireFormatLite::ZigZagDecode64(value));\n"
+	"    case WireFormatLite::TYPE_BOOL:\n"
+	"      return static_cast<CType>(value != 0);\n"
+	"    default:\n"
+	"      return static_cast<CType>(value);\n"
+	"  }\n"
+	"}\n"
+	"\n"
+	"// Whether values of |DeclaredType| are fixed-size rather than varints.\n"
+	"template < ::google::protobuf::internal::WireFormatLite::FieldType DeclaredType>\n"
+	"struct FixedSize { static const bool value = false; };\n"
+	"#define PROTOBUF_PACKED_READER_FIXED_SIZE(TYPE)                              \\\n"
+	"  template <>                                                              \\\n"
+	"  struct FixedSize< ::google::protobuf::internal::WireFormatLite::TYPE> {     \\\n"
+	"    static const bool value = true;                                        \\\n"
+	"  };\n"
+	"PROTOBUF_PACKED_READER_FIXED_SIZE(TYPE_FIXED32)\n"
+	"PROTOBUF_PACKED_READER_FIXED_SIZE(TYPE_FIXED64)\n"
+	"PROTOBUF_PACKED_READER_FIXED_SIZE(TYPE_SFIXED32)\n"
+	"PROTOBUF_PACKED_READER_FIXED_SIZE(TYPE_SFIXED64)\n"
+	"PROTOBUF_PACKED_READER_FIXED_SIZE(TYPE_FLOAT)\n"
+	"PROTOBUF_PACKED_READER_FIXED_SIZE(TYPE_DOUBLE)\n"
+	"#undef PROTOBUF_PACKED_READER_FIXED_SIZE\n"
+	"\n"
+	"// Reads the values of a packed run in [p, end) into |values|.  Bytes up\n"
+	"// to |readable_end| may be loaded.  Enum values that |is_valid| rejects\n"
+	"// are dropped.\n"
+	"template <typename CType,\n"
+	"          ::google::protobuf::internal::WireFormatLite::FieldType DeclaredType,\n"
+	"          bool kFixedSize = FixedSize<DeclaredType>::value>\n"
+	"struct RunReader {\n"
+	"  static bool Read(const ::google::protobuf::uint8* p,\n"
+	"                   const ::google::protobuf::uint8* end,\n"
+	"                   const ::google::protobuf::uint8* readable_end,\n"
+	"                   bool (*is_valid)(int),\n"
+	"                   ::google::protobuf::RepeatedField<CType>* values) {\n"
+	"    // Every complete varint ends in one of the counted bytes, so the\n"
+	"    // reservation holds all the values the loop can add.\n"
+	"    values->Reserve(values->size() + CountVarints(p, end));\n"
+	"    while (p < end) {\n"
+	"      ::google::protobuf::uint64 varint;\n"
+	"      p = ReadVarint(p, end, readable_end, &varint);\n"
+	"      if (p == NULL) return false;\n"
+	"      CType value = FromVarint<CType, DeclaredType>(varint);\n"
+	"      if (is_valid == NULL || is_valid(static_cast<int>(value))) {\n"
+	"        values->AddAlreadyReserved(value);\n"
+	"      }\n"
+	"    }\n"
+	"    return true;\n"
+	"  }\n"
+	"};\n"
+	"\n"
+	"template <typename CType,\n"
+	"          ::google::protobuf::internal::WireFormatLite::FieldType DeclaredType>\n"
+	"struct RunReader<CType, DeclaredType, true> {\n"
+	"  static bool Read(const ::google::protobuf::uint8* p,\n"
+	"                   const ::google::protobuf::uint8* end,\n"
+	"                   const ::google::protobuf::uint8* readable_end,\n"
+	"                   bool (*is_valid)(int),\n"
+	"                   ::google::protobuf::RepeatedField<CType>* values) {\n"
+	"    typedef ::google::protobuf::internal::WireFormatLite WireFormatLite;\n"
+	"    if ((end - p) % sizeof(CType) != 0) return false;\n"
+	"    values->Reserve(values->size() + (end - p) / sizeof(CType));\n"
+	"    // On little-endian hosts each value is a plain copy.\n"
+	"    while (p < end) {\n"
+	"      CType value;\n"
+	"      p = WireFormatLite::ReadPrimitiveFromArray<CType, DeclaredType>(p, &value);\n"
+	"      values->AddAlreadyReserved(value);\n"
+	"    }\n"
+	"    return true;\n"
+	"  }\n"
+	"};\n"
+	"\n"
+	"// Reads the packed run of |length| bytes element by element.  Enum values\n"
+	"// that |is_valid| rejects are dropped.\n"
+	"template <typename CType,\n"
+	"          ::google::protobuf::internal::WireFormatLite::FieldType DeclaredType>\n"
+	"bool ReadPackedSlow(::google::protobuf::io::CodedInputStream* input,\n"
+	"                    ::google::protobuf::uint32 length, bool (*is_valid)(int),\n"
+	"                    ::google::protobuf::RepeatedField<CType>* values) {\n"
+	"  typedef ::google::protobuf::internal::WireFormatLite WireFormatLite;\n"
+	"  ::google::protobuf::io::CodedInputStream::Limit limit =\n"
+	"      input->PushLimit(length);\n"
+	"  while (input->BytesUntilLimit() > 0) {\n"
+	"    CType value;\n"
+	"    if (!WireFormatLite::ReadPrimitive<CType, DeclaredType>(input, &value)) {\n"
+	"      return false;\n"
+	"    }\n"
+	"    if (is_valid == NULL || is_valid(static_cast<int>(value))) {\n"
+	"      values->Add(value);\n"
+	"    }\n"
+	"  }\n"
+	"  input->PopLimit(limit);\n"
+	"  return true;\n"
+	"}\n"
+	"\n"
+	"template <typename CType,\n"
+	"          ::google::protobuf::internal::WireFormatLite::FieldType DeclaredType>\n"
+	"inline bool ReadPackedRun(::google::protobuf::io::CodedInputStream* input,\n"
+	"                          bool (*is_valid)(int),\n"
+	"                          ::google::protobuf::RepeatedField<CType>* values) {\n"
+	"  ::google::protobuf::uint32 length;\n"
+	"  if (!input->ReadVarint32(&length)) return false;\n"
+	"  const void* data;\n"
+	"  int size;\n"
+	"  input->GetDirectBufferPointerInline(&data, &size);\n"
+	"  if (size < 0 || static_cast< ::google::protobuf::uint32>(size) < length) {\n"
+	"    return ReadPackedSlow<CType, DeclaredType>(input, length, is_valid, values);\n"
+	"  }\n"
+	"\n"
+	"  const ::google::protobuf::uint8* p =\n"
+	"      static_cast<const ::google::protobuf::uint8*>(data);\n"
+	"  if (!RunReader<CType, DeclaredType>::Read(p, p + length, p + size,\n"
+	"                                           is_valid, values)) {\n"
+	"    return false;\n"
+	"  }\n"
+	"  input->Skip(length);\n"
+	"  return true;\n"
+	"}\n"
+	"\n"
+	"// Reads a packed run of |DeclaredType| values, the length included.\n"
+	"template <typename CType,\n"
+	"          ::google::protobuf::internal::WireFormatLite::FieldType DeclaredType>\n"
+	"inline bool ReadPacked(::google::protobuf::io::CodedInputStream* input,\n"
+	"                       ::google::protobuf::RepeatedField<CType>* values) {\n"
+	"  return ReadPackedRun<CType, DeclaredType>(input, NULL, values);\n"
+	"}\n"
+	"\n"
+	"// Reads a packed run of enum values, dropping those |is_valid| rejects.\n"
+	"inline bool ReadPackedEnum(::google::protobuf::io::CodedInputStream* input,\n"
+	"                           bool (*is_valid)(int),\n"
+	"                           ::google::protobuf::RepeatedField<int>* values) {\n"
+	"  return ReadPackedRun<int, ::google::protobuf::internal::WireFormatLite::TYPE_ENUM>(\n"
+	"      input, is_valid, values);\n"
+	"}\n"
+	"\n"
+	"}  // namespace protobuf_packed_reader\n"
+	"\n"
+	"#endif  // PROTOBUF_PACKED_READER_H__\n";
+
+// Emitted into every .pb.h generated with table_parser, after kPackedReader.
+// Parse() reads the fields a message's _parse_table_ lists and hands every
+// other tag back to the message's MergePartialFromCodedStream().  It is all
+// inline, so the definitions in different headers are the same entity and
+// the program has a single copy of the loop.
+const char kTableParser[] =
+	"#ifndef PROTOBUF_TABLE_PARSER_H__\n"
+	"#define PROTOBUF_TABLE_PARSER_H__\n"
+	"\n"
+	"#include <google/protobuf/wire_format_lite.h>\n"
+	"#include <google/protobuf/wire_format_lite_inl.h>\n"
+	"\n"
+	"namespace protobuf_table_parser {\n"
+	"\n"
+	"// A field Parse() reads.  |member| is a function the message class\n"
+	"// generates for the field, returning what one value is read into: the\n"
+	"// member of a number, bool or enum, or its RepeatedField, the string or\n"
+	"// message mutable_<field>() returns, or the string add_<field>() returns.\n"
+	"// Function addresses are constant expressions, so the tables are\n"
+	"// constant-initialized and a message parsed from another file's static\n"
+	"// initializer never finds them empty.\n"
+	"struct Field {\n"
+	"  int number;\n"
+	"  unsigned char type;      // a WireFormatLite::FieldType\n"
+	"  bool repeated;\n"
+	"  int has_bit;             // of singular numbers, bools and enums\n"
+	"  void* (*member)(::google::protobuf::MessageLite* message);\n"
+	"  bool (*is_valid)(int);   // of enums\n"
+	"};\n"
+	"\n"
+	"struct Table {\n"
+	"  const Field* fields;  // sorted by number\n"
+	"  int field_count;\n"
+	"};\n"
+	"\n"
+	"inline const Field* Find(const Table& table, int number) {\n"
+	"  // Fields numbered from 1 without gaps need no search.\n"
+	"  if (number > 0 && number <= table.field_count &&\n"
+	"      table.fields[number - 1].number == number) {\n"
+	"    return &table.fields[number - 1];\n"
+	"  }\n"
+	"  int low = 0;\n"
+	"  int high = table.field_count;\n"
+	"  while (low < high) {\n"
+	"    int middle = (low + high) / 2;\n"
+	"    if (table.fields[middle].number < number) {\n"
+	"      low = middle + 1;\n"
+	"    } else {\n"
+	"      high = middle;\n"
+	"    }\n"
+	"  }\n"
+	"  return low < table.field_count && table.fields[low].number == number\n"
+	"      ? &table.fields[low] : NULL;\n"
+	"}\n"
+	"\n"
+	"inline void SetHasBit(::google::protobuf::uint32* has_bits, const Field& field) {\n"
+	"  has_bits[field.has_bit / 32] |= 1u << (field.has_bit % 32);\n"
+	"}\n"
+	"\n"
+	"template <typename CType,\n"
+	"          ::google::protobuf::internal::WireFormatLite::FieldType DeclaredType>\n"
+	"inline bool ReadNumber(::google::protobuf::io::CodedInputStream* input,\n"
+	"                       const Field& field, bool packed, void* member,\n"
+	"                       ::google::protobuf::uint32* has_bits) {\n"
+	"  typedef ::google::protobuf::internal::WireFormatLite WireFormatLite;\n"
+	"  if (packed) {\n"
+	"    return ::protobuf_packed_reader::ReadPacked<CType, DeclaredType>(\n"
+	"        input, static_cast< ::google::protobuf::RepeatedField<CType>*>(member));\n"
+	"  }\n"
+	"  CType value;\n"
+	"  if (!WireFormatLite::ReadPrimitive<CType, DeclaredType>(input, &value)) {\n"
+	"    return false;\n"
+	"  }\n"
+	"  if (field.repeated) {\n"
+	"    static_cast< ::google::protobuf::RepeatedField<CType>*>(member)->Add(value);\n"
+	"  } else {\n"
+	"    *static_cast<CType*>(member) = value;\n"
+	"    SetHasBit(has_bits, field);\n"
+	"  }\n"
+	"  return true;\n"
+	"}\n"
+	"\n"
+	"// Only lite messages put their enums in a table; invalid values are\n"
+	"// dropped, as they have no unknown fields to keep them in.\n"
+	"inline bool ReadEnum(::google::protobuf::io::CodedInputStream* input,\n"
+	"                     const Field& field, bool packed, void* member,\n"
+	"                     ::google::protobuf::uint32* has_bits) {\n"
+	"  typedef ::google::protobuf::internal::WireFormatLite WireFormatLite;\n"
+	"  if (packed) {\n"
+	"    return ::protobuf_packed_reader::ReadPackedEnum(\n"
+	"        input, field.is_valid,\n"
+	"        static_cast< ::google::protobuf::RepeatedField<int>*>(member));\n"
+	"  }\n"
+	"  int value;\n"
+	"  if (!WireFormatLite::ReadPrimitive<int, WireFormatLite::TYPE_ENUM>(\n"
+	"          input, &value)) {\n"
+	"    return false;\n"
+	"  }\n"
+	"  if (!field.is_valid(value)) {\n"
+	"    // Dropped.\n"
+	"  } else if (field.repeated) {\n"
+	"    static_cast< ::google::protobuf::RepeatedField<int>*>(member)->Add(value);\n"
+	"  } else {\n"
+	"    *static_cast<int*>(member) = value;\n"
+	"    SetHasBit(has_bits, field);\n"
+	"  }\n"
+	"  return true;\n"
+	"}\n"
+	"\n"
+	"// The member function already marked the string present and gave it its\n"
+	"// own storage, as mutable_<field>() does.\n"
+	"inline bool ReadString(::google::protobuf::io::CodedInputStream* input,\n"
+	"                       void* member) {\n"
+	"  return ::google::protobuf::internal::WireFormatLite::ReadBytes(\n"
+	"      input, static_cast< ::std::string*>(member));\n"
+	"}\n"
+	"\n"
+	"// Only singular messages are in tables; the member function returns\n"
+	"// mutable_<field>() as a MessageLite.\n"
+	"inline bool ReadMessage(::google::protobuf::io::CodedInputStream* input,\n"
+	"                        void* member) {\n"
+	"  return ::google::protobuf::internal::WireFormatLite::ReadMessage(\n"
+	"      input, static_cast< ::google::protobuf::MessageLite*>(member));\n"
+	"}\n"
+	"\n"
+	"// Reads the fields |table| lists into |message|, whose has-bits are\n"
+	"// |has_bits|, up to the end of the input or the first tag the table\n"
+	"// doesn't cover, which is left in |*tag|; 0 at the end.  A tag of a listed\n"
+	"// field with the wrong wire type is left there too.  Returns false if the\n"
+	"// input is malformed.\n"
+	"inline bool Parse(::google::protobuf::MessageLite* message,\n"
+	"                  ::google::protobuf::uint32* has_bits,\n"
+	"                  const Table& table,\n"
+	"                  ::google::protobuf::io::CodedInputStream* input,\n"
+	"                  ::google::protobuf::uint32* tag) {\n"
+	"  typedef ::google::protobuf::internal::WireFormatLite WireFormatLite;\n"
+	"  const Field* end = table.fields + table.field_count;\n"
+	"  const Field* field = table.fields;\n"
+	"  for (;;) {\n"
+	"    *tag = input->ReadTag();\n"
+	"    int number = WireFormatLite::GetTagFieldNumber(*tag);\n"
+	"\n"
+	"    // Fields mostly repeat or follow in order of number.\n"
+	"    if (field->number != number) {\n"
+	"      if (field + 1 != end && field[1].number == number) {\n"
+	"        ++field;\n"
+	"      } else {\n"
+	"        field = Find(table, number);\n"
+	"        if (field == NULL) return true;\n"
+	"      }\n"
+	"    }\n"
+	"\n"
+	"    WireFormatLite::FieldType type =\n"
+	"        static_cast<WireFormatLite::FieldType>(field->type);\n"
+	"    WireFormatLite::WireType wire_type = WireFormatLite::GetTagWireType(*tag);\n"
+	"    bool packed = false;\n"
+	"    if (wire_type != WireFormatLite::WireTypeForFieldType(type)) {\n"
+	"      // Repeated numbers are accepted packed whether declared so or not.\n"
+	"      if (!field->repeated ||\n"
+	"          wire_type != WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {\n"
+	"        return true;\n"
+	"      }\n"
+	"      packed = true;\n"
+	"    }\n"
+	"\n"
+	"    void* member = field->member(message);\n"
+	"    bool ok;\n"
+	"    switch (type) {\n"
+	"#define PROTOBUF_TABLE_PARSER_NUMBER(CTYPE, TYPE)                            \\\n"
+	"      case WireFormatLite::TYPE:                                           \\\n"
+	"        ok = ReadNumber<CTYPE, WireFormatLite::TYPE>(                      \\\n"
+	"            input, *field, packed, member, has_bits);                      \\\n"
+	"        break;\n"
+	"      PROTOBUF_TABLE_PARSER_NUMBER(double, TYPE_DOUBLE)\n"
+	"      PROTOBUF_TABLE_PARSER_NUMBER(float, TYPE_FLOAT)\n"
+	"      PROTOBUF_TABLE_PARSER_NUMBER(::google::protobuf::int64, TYPE_INT64)\n"
+	"      PROTOBUF_TABLE_PARSER_NUMBER(::google::protobuf::uint64, TYPE_UINT64)\n"
+	"      PROTOBUF_TABLE_PARSER_NUMBER(::google::protobuf::int32, TYPE_INT32)\n"
+	"      PROTOBUF_TABLE_PARSER_NUMBER(::google::protobuf::uint64, TYPE_FIXED64)\n"
+	"      PROTOBUF_TABLE_PARSER_NUMBER(::google::protobuf::uint32, TYPE_FIXED32)\n"
+	"      PROTOBUF_TABLE_PARSER_NUMBER(bool, TYPE_BOOL)\n"
+	"      PROTOBUF_TABLE_PARSER_NUMBER(::google::protobuf::uint32, TYPE_UINT32)\n"
+	"      PROTOBUF_TABLE_PARSER_NUMBER(::google::protobuf::int32, TYPE_SFIXED32)\n"
+	"      PROTOBUF_TABLE_PARSER_NUMBER(::google::protobuf::int64, TYPE_SFIXED64)\n"
+	"      PROTOBUF_TABLE_PARSER_NUMBER(::google::protobuf::int32, TYPE_SINT32)\n"
+	"      PROTOBUF_TABLE_PARSER_NUMBER(::google::protobuf::int64, TYPE_SINT64)\n"
+	"#undef PROTOBUF_TABLE_PARSER_NUMBER\n"
+	"      case WireFormatLite::TYPE_ENUM:\n"
+	"        ok = ReadEnum(input, *field, packed, member, has_bits);\n"
+	"        break;\n"
+	"      case WireFormatLite::TYPE_STRING:\n"
+	"      case WireFormatLite::TYPE_BYTES:\n"
+	"        ok = ReadString(input, member);\n"
+	"        break;\n"
+	"      case WireFormatLite::TYPE_MESSAGE:\n"
+	"        ok = ReadMessage(input, member);\n"
+	"        break;\n"
+	"      default:\n"
+	"        // Groups are never in a table.\n"
+	"        return true;\n"
+	"    }\n"
+	"    if (!ok) return false;\n"
+	"  }\n"
+	"}\n"
+	"\n"
+	"}  // namespace protobuf_table_parser\n"
+	"\n"
+	"#endif  // PROTOBUF_TABLE_PARSER_H__\n";
+
+// Emitted into common.pb.h with lua_lazy, inside namespace google::protobuf.
+const char kLuaLazyRuntime[] =
+	"// With lua_lazy, InitLuaBindEnvironment() hands an array of these to\n"
+	"// InstallLuaLazyTypes() rather than registering every type up front.\n"
+	"struct LuaLazyType {\n"
+	"  const char* name;                 // a global |registrar| defines\n"
+	"  void (*registrar)(lua_State* L);\n"
+	"  const char* dependencies;         // space-separated globals it needs\n"
+	"};\n"
+	"\n"
+	"// __index of the globals table.  Upvalue 1 maps the names not registered\n"
+	"// yet to their index into the LuaLazyType array in upvalue 2; upvalue 3\n"
+	"// is the __index the globals had before, if any.\n"
+	"inline int LuaLazyIndex(lua_State* L) {\n"
+	"  lua_pushvalue(L, 2);\n"
+	"  lua_rawget(L, lua_upvalueindex(1));\n"
+	"  if (lua_type(L, -1) == LUA_TNUMBER) {\n"
+	"    const LuaLazyType* type = static_cast<const LuaLazyType*>(\n"
+	"      lua_touserdata(L, lua_upvalueindex(2))) + lua_tointeger(L, -1);\n"
+	"    lua_pop(L, 1);\n"
+	"    // Forgotten first, so that a failing registrar is not run again.\n"
+	"    lua_pushvalue(L, 2);\n"
+	"    lua_pushnil(L);\n"
+	"    lua_rawset(L, lua_upvalueindex(1));\n"
+	"    type->registrar(L);\n"
+	"\n"
+	"    // Looking the dependencies up registers those still missing.\n"
+	"    const char* name = type->dependencies;\n"
+	"    while (*name != '\\0') {\n"
+	"      const char* end = strchr(name, ' ');\n"
+	"      if (end == NULL) end = name + strlen(name);\n"
+	"      lua_pushlstring(L, name, end - name);\n"
+	"      lua_gettable(L, 1);\n"
+	"      lua_pop(L, 1);\n"
+	"      name = *end == ' ' ? end + 1 : end;\n"
+	"    }\n"
+	"\n"
+	"    lua_pushvalue(L, 2);\n"
+	"    lua_rawget(L, 1);\n"
+	"    return 1;\n"
+	"  }\n"
+	"  lua_pop(L, 1);\n"
+	"\n"
+	"  if (lua_isfunction(L, lua_upvalueindex(3))) {\n"
+	"    lua_pushvalue(L, lua_upvalueindex(3));\n"
+	"    lua_pushvalue(L, 1);\n"
+	"    lua_pushvalue(L, 2);\n"
+	"    lua_call(L, 2, 1);\n"
+	"  } else if (lua_istable(L, lua_upvalueindex(3))) {\n"
+	"    lua_pushvalue(L, 2);\n"
+	"    lua_gettable(L, lua_upvalueindex(3));\n"
+	"  } else {\n"
+	"    lua_pushnil(L);\n"
+	"  }\n"
+	"  return 1;\n"
+	"}\n"
+	"\n"
+	"// Installs LuaLazyIndex() for |types|, terminated by a NULL name, which\n"
+	"// must outlive the state.\n"
+	"inline void InstallLuaLazyTypes(lua_State* L, const LuaLazyType* types) {\n"
+	"  lua_newtable(L);\n"
+	"  for (int i = 0; types[i].name != NULL; i++) {\n"
+	"    lua_pushinteger(L, i);\n"
+	"    lua_setfield(L, -2, types[i].name);\n"
+	"  }\n"
+	"  lua_pushlightuserdata(L, const_cast<LuaLazyType*>(types));\n"
+	"\n"
+	"#if LUA_VERSION_NUM >= 502\n"
+	"  lua_pushglobaltable(L);\n"
+	"#else\n"
+	"  lua_pushvalue(L, LUA_GLOBALSINDEX);\n"
+	"#endif\n"
+	"  if (!lua_getmetatable(L, -1)) {\n"
+	"    lua_newtable(L);\n"
+	"    lua_pushvalue(L, -1);\n"
+	"    lua_setmetatable(L, -3);\n"
+	"  }\n"
+	"  lua_getfield(L, -1, \"__index\");\n"
+	"  lua_pushvalue(L, -5);\n"
+	"  lua_pushvalue(L, -5);\n"
+	"  lua_pushvalue(L, -3);\n"
+	"  lua_pushcclosure(L, &LuaLazyIndex, 3);\n"
+	"  lua_setfield(L, -3, \"__index\");\n"
+	"  lua_pop(L, 5);\n"
+	"}\n"
+	"\n";
+
+// Helpers only the luabind backend needs, emitted after kLuaRuntime.
+const char kLuaBindRuntime[] =
+	"#include <stdexcept>\n"
+	"\n"
+	"namespace {\n"
+	"namespace protobuf_lua {\n"
+	"\n"
+	"// luabind calls the bound functions from C++ frames, which a Lua error\n"
+	"// would longjmp through, so they throw instead and luabind raises the\n"
+	"// error.  ProtectedCall() calls |function| with the |arguments| values on\n"
+	"// top of the stack in protected mode, leaving |results| values, and turns\n"
+	"// a Lua error into a luabind::error, which keeps the error on the stack.\n"
+	"inline void ProtectedCall(lua_State* L, lua_CFunction function, int arguments,\n"
+	"    int results) {\n"
+	"  lua_pushcfunction(L, function);\n"
+	"  lua_insert(L, -arguments - 1);\n"
+	"  if (lua_pcall(L, arguments, results, 0) != 0) throw luabind::error(L);\n"
+	"}\n"
+	"\n"
+	"// Imports the table at slot 2 into the Type at light userdata slot 1.\n"
+	"template <typename Type>\n"
+	"int Import(lua_State* L) {\n"
+	"  static_cast<Type*>(lua_touserdata(L, 1))->ImportFromLua(L, 2);\n"
+	"  return 0;\n"
+	"}\n"
+	"\n"
+	"// Pushes the table of the Type at light userdata slot 1.\n"
+	"template <typename Type>\n"
+	"int PushTable(lua_State* L) {\n"
+	"  static_cast<const Type*>(lua_touserdata(L, 1))->ToTable(L);\n"
+	"  return 1;\n"
+	"}\n"
+	"\n"
+	"// luaL_checklstring(), throwing.\n"
+	"inline const char* CheckString(lua_State* L, int index, size_t* size) {\n"
+	"  if (!lua_isstring(L, index)) {\n"
+	"    throw std::invalid_argument(std::string(\"string expected, got \") +\n"
+	"      luaL_typename(L, index));\n"
+	"  }\n"
+	"  return lua_tolstring(L, index, size);\n"
+	"}\n"
+	"\n"
+	"// CheckRange(), throwing.\n"
+	"inline void CheckRange(int first, int count, int size) {\n"
+	"  if (first < 0 || first > size) throw std::out_of_range(\"index out of range\");\n"
+	"  if (count < 0 || count > size - first) throw std::out_of_range(\"count out of range\");\n"
+	"}\n"
+	"\n"
+	"// Returns the borrowed view of |message|, a sub-message of the message at\n"
+	"// stack slot |owner|; see FindView().  Type is const for read-only views.\n"
+	"// luabind cannot invalidate a view, so one kept past release_ still\n"
+	"// points at the released message.\n"
+	"template <typename Type>\n"
+	"luabind::object View(lua_State* L, Type* message, bool readonly, int owner) {\n"
+	"  if (!FindView(L, message, readonly, owner)) {\n"
+	"    owner = AbsIndex(L, owner);\n"
+	"    luabind::object(L, message).push(L);\n"
+	"    CacheView(L, message, readonly, owner);\n"
+	"  }\n"
+	"  luabind::object view(luabind::from_stack(L, -1));\n"
+	"  lua_pop(L, 1);\n"
+	"  return view;\n"
+	"}\n"
+	"\n"
+	"}  // namespace protobuf_lua\n"
+	"}  // namespace\n"
+	"\n";
+
+// The luabind holder of messages registered with lua_pool.  luabind creates
+// every instance with a plain new and offers no hook to hand out an existing
+// one, so with luabind only the buffers of pooled messages are recycled, not
+// the messages themselves: the holder swaps the contents of a pooled
+// instance into the fresh one, which takes over its grown strings, repeated
+// fields and sub-messages, and deletes the emptied pooled instance.  Each
+// construction still costs a new, a delete and a ByteSize() to tell a copy
+// from an empty message.  When the userdata is collected the message is
+// recycled.  Copying transfers ownership, as with std::auto_ptr.
+const char kLuaBindPoolPtr[] =
+	"namespace {\n"
+	"namespace protobuf_lua {\n"
+	"\n"
+	"template <typename Type>\n"
+	"class PoolPtr {\n"
+	" public:\n"
+	"  typedef Type element_type;\n"
+	"\n"
+	"  explicit PoolPtr(Type* message = NULL) : message_(message) {\n"
+	"    if (message_ == NULL || message_->ByteSize() != 0) return;\n"
+	"    Type* pooled = Type::Acquire();\n"
+	"    if (pooled != NULL) {\n"
+	"      message_->Swap(pooled);\n"
+	"      delete pooled;\n"
+	"    }\n"
+	"  }\n"
+	"  PoolPtr(const PoolPtr& other) : message_(other.release()) {}\n"
+	"  ~PoolPtr() { Type::Recycle(message_); }\n"
+	"\n"
+	"  PoolPtr& operator=(const PoolPtr& other) {\n"
+	"    if (&other != this) {\n"
+	"      Type::Recycle(message_);\n"
+	"      message_ = other.release();\n"
+	"    }\n"
+	"    return *this;\n"
+	"  }\n"
+	"\n"
+	"  Type* get() const { return message_; }\n"
+	"  Type& operator*() const { return *message_; }\n"
+	"  Type* operator->() const { return message_; }\n"
+	"\n"
+	"  Type* release() const {\n"
+	"    Type* message = message_;\n"
+	"    message_ = NULL;\n"
+	"    return message;\n"
+	"  }\n"
+	"\n"
+	" private:\n"
+	"  mutable Type* message_;\n"
+	"};\n"
+	"\n"
+	"template <typename Type>\n"
+	"Type* get_pointer(const PoolPtr<Type>& pointer) {\n"
+	"  return pointer.get();\n"
+	"}\n"
+	"\n"
+	"}  // namespace protobuf_lua\n"
+	"}  // namespace\n"
+	"\n";
+
+const char kLuaRuntime[] =
+	"#include <string.h>\n"
+	"#include <algorithm>\n"
+	"#include <google/protobuf/io/coded_stream.h>\n"
+	"#include <google/protobuf/wire_format_lite_inl.h>\n"
+	"\n"
+	"#ifndef PROTOBUF_LUA_RAWLEN\n"
+	"#if LUA_VERSION_NUM >= 502\n"
+	"#define PROTOBUF_LUA_RAWLEN lua_rawlen\n"
+	"#define PROTOBUF_LUA_SETUSERVALUE lua_setuservalue\n"
+	"#else\n"
+	"#define PROTOBUF_LUA_RAWLEN lua_objlen\n"
+	"#define PROTOBUF_LUA_SETUSERVALUE lua_setfenv\n"
+	"#endif\n"
+	"#endif\n"
+	"\n"
+	"namespace {\n"
+	"namespace protobuf_lua {\n"
+	"\n"
+	"// A named integer exposed to Lua: a field number or an enum value.\n"
+	"// Arrays of them end with a NULL name.\n"
+	"struct Constant {\n"
+	"  const char* name;\n"
+	"  int value;\n"
+	"};\n"
+	"\n"
+	"// Stores |constants| into the object at |index|, which need not be a\n"
+	"// plain table: luabind classes take them through __newindex.\n"
+	"inline void SetConstants(lua_State* L, int index, const Constant* constants) {\n"
+	"  for (; constants->name != NULL; constants++) {\n"
+	"    lua_pushinteger(L, constants->value);\n"
+	"    lua_setfield(L, index, constants->name);\n"
+	"  }\n"
+	"}\n"
+	"\n"
+	"// Pushes a new table holding |constants|, sized up front for them and\n"
+	"// |extra| more fields, and filled with raw sets.\n"
+	"inline void PushConstants(lua_State* L, const Constant* constants, int extra) {\n"
+	"  int count = 0;\n"
+	"  while (constants[count].name != NULL) count++;\n"
+	"  lua_createtable(L, 0, count + extra);\n"
+	"  for (; constants->name != NULL; constants++) {\n"
+	"    lua_pushstring(L, constants->name);\n"
+	"    lua_pushinteger(L, constants->value);\n"
+	"    lua_rawset(L, -3);\n"
+	"  }\n"
+	"}\n"
+	"\n"
+	"// One slot of a message's field name table; see FindField().\n"
+	"struct FieldSlot {\n"
+	"  const char* name;\n"
+	"  size_t size;\n"
+	"  int number;\n"
+	"};\n"
+	"\n"
+	"// Seeded FNV-1a with a final mix, so that the low bits used as table\n"
+	"// indexes depend on every byte.  Must match the generator's copy.\n"
+	"inline ::google::protobuf::uint32 HashKey(const char* key, size_t size,\n"
+	"    ::google::protobuf::uint32 seed) {\n"
+	"  ::google::protobuf::uint32 hash = 2166136261u ^ seed;\n"
+	"  for (size_t i = 0; i < size; i++) {\n"
+	"    hash ^= static_cast<unsigned char>(key[i]);\n"
+	"    hash *= 16777619u;\n"
+	"  }\n"
+	"  hash ^= hash >> 16;\n"
+	"  hash *= 0x85ebca6bu;\n"
+	"  hash ^= hash >> 13;\n"
+	"  return hash;\n"
+	"}\n"
+	"\n"
+	"// Looks |key| up in a perfect hash table built by the code generator: the\n"
+	"// unseeded hash selects the seed for the second hash, which selects the\n"
+	"// only slot |key| can be in.  Returns the field number, or 0.\n"
+	"inline int FindField(const FieldSlot* slots, ::google::protobuf::uint32 slot_mask,\n"
+	"    const ::google::protobuf::uint32* seeds, ::google::protobuf::uint32 seed_mask,\n"
+	"    const char* key, size_t size) {\n"
+	"  ::google::protobuf::uint32 seed = seeds[HashKey(key, size, 0) & seed_mask];\n"
+	"  const FieldSlot& slot = slots[HashKey(key, size, seed) & slot_mask];\n"
+	"  return (slot.size == size && memcmp(slot.name, key, size) == 0) ? slot.number : 0;\n"
+	"}\n"
+	"\n"
+	"inline int AbsIndex(lua_State* L, int index) {\n"
+	"  return (index > 0 || index <= LUA_REGISTRYINDEX) ? index : lua_gettop(L) + index + 1;\n"
+	"}\n"
+	"\n"
+	"// 64-bit and unsigned 32-bit fields only fit lua_Integer from 5.3 on.\n"
+	"inline void PushInteger64(lua_State* L, ::google::protobuf::int64 value) {\n"
+	"#if LUA_VERSION_NUM >= 503\n"
+	"  lua_pushinteger(L, static_cast<lua_Integer>(value));\n"
+	"#else\n"
+	"  lua_pushnumber(L, static_cast<lua_Number>(value));\n"
+	"#endif\n"
+	"}\n"
+	"\n"
+	"inline ::google::protobuf::int64 CheckInteger64(lua_State* L, int index) {\n"
+	"#if LUA_VERSION_NUM >= 503\n"
+	"  return static_cast< ::google::protobuf::int64>(luaL_checkinteger(L, index));\n"
+	"#else\n"
+	"  return static_cast< ::google::protobuf::int64>(luaL_checknumber(L, index));\n"
+	"#endif\n"
+	"}\n"
+	"\n"
+	"inline ::google::protobuf::int64 ToInteger64(lua_State* L, int index) {\n"
+	"#if LUA_VERSION_NUM >= 503\n"
+	"  return static_cast< ::google::protobuf::int64>(lua_tointeger(L, index));\n"
+	"#else\n"
+	"  return static_cast< ::google::protobuf::int64>(lua_tonumber(L, index));\n"
+	"#endif\n"
+	"}\n"
+	"\n"
+	"inline void PushString(lua_State* L, const ::std::string& value) {\n"
+	"  lua_pushlstring(L, value.data(), value.size());\n"
+	"}\n"
+	"\n"
+	"// A read-only view of a string field, so that a large payload can be\n"
+	"// measured and sliced without copying all of it into the Lua heap.  The\n"
+	"// view pins the message it was taken from but points at the field itself:\n"
+	"// it goes stale once the field is released, and a view of an unset field\n"
+	"// keeps showing the default value.\n"
+	"struct BytesView {\n"
+	"  const ::std::string* value;\n"
+	"};\n"
+	"\n"
+	"inline const ::std::string& CheckBytesView(lua_State* L, int index) {\n"
+	"  return *static_cast<BytesView*>(\n"
+	"      luaL_checkudata(L, index, \"protobuf.BytesView\"))->value;\n"
+	"}\n"
+	"\n"
+	"// Clamps the 1-based positions i..j, negative ones counting from the end as\n"
+	"// in string.sub(), to |size|.  Returns false if the range is empty.\n"
+	"inline bool BytesViewRange(lua_Integer size, lua_Integer* i, lua_Integer* j) {\n"
+	"  if (*i < 0) *i += size + 1;\n"
+	"  if (*j < 0) *j += size + 1;\n"
+	"  if (*i < 1) *i = 1;\n"
+	"  if (*j > size) *j = size;\n"
+	"  return *i <= *j;\n"
+	"}\n"
+	"\n"
+	"int BytesViewLen(lua_State* L) {\n"
+	"  lua_pushinteger(L, static_cast<lua_Integer>(CheckBytesView(L, 1).size()));\n"
+	"  return 1;\n"
+	"}\n"
+	"\n"
+	"int BytesViewToString(lua_State* L) {\n"
+	"  PushString(L, CheckBytesView(L, 1));\n"
+	"  return 1;\n"
+	"}\n"
+	"\n"
+	"// view:sub(i [, j]) copies out just the bytes i..j.\n"
+	"int BytesViewSub(lua_State* L) {\n"
+	"  const ::std::string& value = CheckBytesView(L, 1);\n"
+	"  lua_Integer i = luaL_optinteger(L, 2, 1);\n"
+	"  lua_Integer j = luaL_optinteger(L, 3, -1);\n"
+	"  if (BytesViewRange(static_cast<lua_Integer>(value.size()), &i, &j)) {\n"
+	"    lua_pushlstring(L, value.data() + i - 1, static_cast<size_t>(j - i + 1));\n"
+	"  } else {\n"
+	"    lua_pushliteral(L, \"\");\n"
+	"  }\n"
+	"  return 1;\n"
+	"}\n"
+	"\n"
+	"// view:byte([i [, j]]) works like string.byte().\n"
+	"int BytesViewByte(lua_State* L) {\n"
+	"  const ::std::string& value = CheckBytesView(L, 1);\n"
+	"  lua_Integer i = luaL_optinteger(L, 2, 1);\n"
+	"  lua_Integer j = luaL_optinteger(L, 3, i);\n"
+	"  if (!BytesViewRange(static_cast<lua_Integer>(value.size()), &i, &j)) return 0;\n"
+	"  int count = static_cast<int>(j - i + 1);\n"
+	"  luaL_checkstack(L, count, \"byte range too large\");\n"
+	"  for (lua_Integer k = i; k <= j; ++k) {\n"
+	"    lua_pushinteger(L, static_cast<unsigned char>(value[static_cast<size_t>(k - 1)]));\n"
+	"  }\n"
+	"  return count;\n"
+	"}\n"
+	"\n"
+	"// Pushes a view of |value|, which must outlive the view unless it belongs\n"
+	"// to the message at stack slot |owner| (0 for none).\n"
+	"inline void PushBytesView(lua_State* L, const ::std::string* value, int owner) {\n"
+	"  if (owner != 0) owner = AbsIndex(L, owner);\n"
+	"  BytesView* view = static_cast<BytesView*>(lua_newuserdata(L, sizeof(BytesView)));\n"
+	"  view->value = value;\n"
+	"  if (luaL_newmetatable(L, \"protobuf.BytesView\")) {\n"
+	"    lua_pushcfunction(L, &BytesViewLen);\n"
+	"    lua_setfield(L, -2, \"__len\");\n"
+	"    lua_pushcfunction(L, &BytesViewToString);\n"
+	"    lua_setfield(L, -2, \"__tostring\");\n"
+	"    lua_createtable(L, 0, 4);\n"
+	"    lua_pushcfunction(L, &BytesViewLen);\n"
+	"    lua_setfield(L, -2, \"len\");\n"
+	"    lua_pushcfunction(L, &BytesViewToString);\n"
+	"    lua_setfield(L, -2, \"tostring\");\n"
+	"    lua_pushcfunction(L, &BytesViewSub);\n"
+	"    lua_setfield(L, -2, \"sub\");\n"
+	"    lua_pushcfunction(L, &BytesViewByte);\n"
+	"    lua_setfield(L, -2, \"byte\");\n"
+	"    lua_setfield(L, -2, \"__index\");\n"
+	"  }\n"
+	"  lua_setmetatable(L, -2);\n"
+	"\n"
+	"  if (owner != 0) {\n"
+	"    lua_createtable(L, 1, 0);\n"
+	"    lua_pushvalue(L, owner);\n"
+	"    lua_rawseti(L, -2, 1);\n"
+	"    PROTOBUF_LUA_SETUSERVALUE(L, -2);\n"
+	"  }\n"
+	"}\n"
+	"\n"
+	"// Raises an argument error unless elements [first, first + count) of a\n"
+	"// repeated field of |size| elements exist.  |arg| is the argument |first|\n"
+	"// came from, and |count| the next one.\n"
+	"inline void CheckRange(lua_State* L, int first, int count, int size, int arg) {\n"
+	"  luaL_argcheck(L, 0 <= first && first <= size, arg, \"index out of range\");\n"
+	"  luaL_argcheck(L, 0 <= count && count <= size - first, arg + 1, \"count out of range\");\n"
+	"}\n"
+	"\n"
+	"// Pushes a length-delimited string read from |input|, straight out of the\n"
+	"// input buffer when the whole string is in it.\n"
+	"inline bool ReadString(lua_State* L, ::google::protobuf::io::CodedInputStream* input) {\n"
+	"  ::google::protobuf::uint32 length;\n"
+	"  if (!input->ReadVarint32(&length)) return false;\n"
+	"  const void* data;\n"
+	"  int size;\n"
+	"  if (input->GetDirectBufferPointer(&data, &size) &&\n"
+	"      static_cast< ::google::protobuf::uint32>(size) >= length) {\n"
+	"    lua_pushlstring(L, static_cast<const char*>(data), length);\n"
+	"    return input->Skip(static_cast<int>(length));\n"
+	"  }\n"
+	"  ::std::string value;\n"
+	"  if (!input->ReadString(&value, static_cast<int>(length))) return false;\n"
+	"  PushString(L, value);\n"
+	"  return true;\n"
+	"}\n"
+	"\n"
+	"// Pushes the sequence under |name| in the table at stack slot |table|,\n"
+	"// adding an empty one if there is none, and returns its length.\n"
+	"inline int PushSequence(lua_State* L, int table, const char* name) {\n"
+	"  lua_pushstring(L, name);\n"
+	"  lua_rawget(L, table);\n"
+	"  if (lua_istable(L, -1)) return static_cast<int>(PROTOBUF_LUA_RAWLEN(L, -1));\n"
+	"  lua_pop(L, 1);\n"
+	"  lua_newtable(L);\n"
+	"  lua_pushstring(L, name);\n"
+	"  lua_pushvalue(L, -2);\n"
+	"  lua_rawset(L, table);\n"
+	"  return 0;\n"
+	"}\n"
+	"\n"
+	"// Decodes a length-delimited |Type| read from |input| into the table on top\n"
+	"// of the stack, or into a new table replacing a nil there.\n"
+	"template <typename Type>\n"
+	"bool DecodeMessage(lua_State* L, ::google::protobuf::io::CodedInputStream* input) {\n"
+	"  ::google::protobuf::uint32 length;\n"
+	"  if (!input->ReadVarint32(&length)) return false;\n"
+	"  if (!input->IncrementRecursionDepth()) return false;\n"
+	"  ::google::protobuf::io::CodedInputStream::Limit limit = input->PushLimit(length);\n"
+	"  if (!Type::DecodeToLua(L, input) || !input->ConsumedEntireMessage()) return false;\n"
+	"  input->PopLimit(limit);\n"
+	"  input->DecrementRecursionDepth();\n"
+	"  return true;\n"
+	"}\n"
+	"\n"
+	"// Decodes group |number| of type |Type| into the table on top of the stack,\n"
+	"// or into a new table replacing a nil there.\n"
+	"template <typename Type>\n"
+	"bool DecodeGroup(lua_State* L, int number, ::google::protobuf::io::CodedInputStream* input) {\n"
+	"  if (!input->IncrementRecursionDepth()) return false;\n"
+	"  if (!Type::DecodeToLua(L, input)) return false;\n"
+	"  if (!input->LastTagWas(::google::protobuf::internal::WireFormatLite::MakeTag(number,\n"
+	"      ::google::protobuf::internal::WireFormatLite::WIRETYPE_END_GROUP))) {\n"
+	"    return false;\n"
+	"  }\n"
+	"  input->DecrementRecursionDepth();\n"
+	"  return true;\n"
+	"}\n"
+	"\n"
+	"// Pushes the table decoded from the |Type| serialized in |data|, or nil if\n"
+	"// the data is malformed.\n"
+	"template <typename Type>\n"
+	"void PushDecoded(lua_State* L, const char* data, size_t size) {\n"
+	"  int top = lua_gettop(L);\n"
+	"  lua_pushnil(L);\n"
+	"  ::google::protobuf::io::CodedInputStream input(\n"
+	"    reinterpret_cast<const ::google::protobuf::uint8*>(data), static_cast<int>(size));\n"
+	"  if (!Type::DecodeToLua(L, &input) || !input.ConsumedEntireMessage()) {\n"
+	"    lua_settop(L, top);\n"
+	"    lua_pushnil(L);\n"
+	"  }\n"
+	"}\n"
+	"\n"
+	"// Type.decode(data)\n"
+	"template <typename Type>\n"
+	"int Decode(lua_State* L) {\n"
+	"  size_t size;\n"
+	"  const char* data = luaL_checklstring(L, 1, &size);\n"
+	"  PushDecoded<Type>(L, data, size);\n"
+	"  return 1;\n"
+	"}\n"
+	"\n"
+	"// How deep tables of messages may nest in import() and encode(): the\n"
+	"// recursion limit CodedInputStream applies to decode(), which also keeps a\n"
+	"// table that contains itself from overflowing the C stack.\n"
+	"const int kMaxNestingDepth = 100;\n"
+	"\n"
+	"inline void CheckNestingDepth(lua_State* L, int depth) {\n"
+	"  if (depth > kMaxNestingDepth) {\n"
+	"    luaL_error(L, \"messages nested more than %d levels deep\", kMaxNestingDepth);\n"
+	"  }\n"
+	"}\n"
+	"\n"
+	"// The sizes of the sub-messages and packed fields met while sizing a table,\n"
+	"// in the order encoding meets them again.  They live in a userdata at a\n"
+	"// fixed stack slot, so that a Lua error leaves nothing to free.\n"
+	"struct SizeCache {\n"
+	"  int count;\n"
+	"  int capacity;\n"
+	"  int sizes[1];\n"
+	"};\n"
+	"\n"
+	"inline void PushSizeCache(lua_State* L, int capacity) {\n"
+	"  SizeCache* cache = static_cast<SizeCache*>(\n"
+	"    lua_newuserdata(L, sizeof(SizeCache) + (capacity - 1) * sizeof(int)));\n"
+	"  cache->count = 0;\n"
+	"  cache->capacity = capacity;\n"
+	"}\n"
+	"\n"
+	"// Returns the position of a new entry in the size cache at |index|.\n"
+	"inline int ReserveSize(lua_State* L, int index) {\n"
+	"  SizeCache* cache = static_cast<SizeCache*>(lua_touserdata(L, index));\n"
+	"  if (cache->count == cache->capacity) {\n"
+	"    PushSizeCache(L, cache->capacity * 2);\n"
+	"    SizeCache* grown = static_cast<SizeCache*>(lua_touserdata(L, -1));\n"
+	"    memcpy(grown->sizes, cache->sizes, cache->count * sizeof(int));\n"
+	"    grown->count = cache->count;\n"
+	"    lua_replace(L, index);\n"
+	"    cache = grown;\n"
+	"  }\n"
+	"  return cache->count++;\n"
+	"}\n"
+	"\n"
+	"inline void SetSize(lua_State* L, int index, int position, int size) {\n"
+	"  static_cast<SizeCache*>(lua_touserdata(L, index))->sizes[position] = size;\n"
+	"}\n"
+	"\n"
+	"inline ::google::protobuf::uint8* WriteStringToArray(::google::protobuf::uint32 tag,\n"
+	"    const char* data, size_t size, ::google::protobuf::uint8* target) {\n"
+	"  target = ::google::protobuf::io::CodedOutputStream::WriteTagToArray(tag, target);\n"
+	"  target = ::google::protobuf::io::CodedOutputStream::WriteVarint32ToArray(\n"
+	"    static_cast< ::google::protobuf::uint32>(size), target);\n"
+	"  return ::google::protobuf::io::CodedOutputStream::WriteRawToArray(\n"
+	"    data, static_cast<int>(size), target);\n"
+	"}\n"
+	"\n"
+	"// Pushes the serialized |Type| the table at |index| describes.  The table\n"
+	"// is walked twice: once to check it and size everything, and once to\n"
+	"// write straight into the buffer of the resulting string.\n"
+	"template <typename Type>\n"
+	"void PushEncoded(lua_State* L, int index) {\n"
+	"  index = AbsIndex(L, index);\n"
+	"  luaL_checktype(L, index, LUA_TTABLE);\n"
+	"  PushSizeCache(L, 16);\n"
+	"  int cache = lua_gettop(L);\n"
+	"  int size = Type::ByteSizeFromLua(L, index, cache, 0);\n"
+	"  const int* sizes = static_cast<SizeCache*>(lua_touserdata(L, cache))->sizes;\n"
+	"#if LUA_VERSION_NUM >= 502\n"
+	"  luaL_Buffer buffer;\n"
+	"  ::google::protobuf::uint8* target = reinterpret_cast< ::google::protobuf::uint8*>(\n"
+	"    luaL_buffinitsize(L, &buffer, size));\n"
+	"  Type::EncodeFromLua(L, index, &sizes, target);\n"
+	"  luaL_pushresultsize(&buffer, size);\n"
+	"#else\n"
+	"  ::google::protobuf::uint8* target = static_cast< ::google::protobuf::uint8*>(\n"
+	"    lua_newuserdata(L, size));\n"
+	"  Type::EncodeFromLua(L, index, &sizes, target);\n"
+	"  lua_pushlstring(L, reinterpret_cast<const char*>(target), size);\n"
+	"  lua_remove(L, -2);\n"
+	"#endif\n"
+	"  lua_remove(L, cache);\n"
+	"}\n"
+	"\n"
+	"// Type.encode(table)\n"
+	"template <typename Type>\n"
+	"int Encode(lua_State* L) {\n"
+	"  PushEncoded<Type>(L, 1);\n"
+	"  return 1;\n"
+	"}\n"
+	"\n"
+	"// Sub-messages reach Lua as borrowed views, userdata pointing into the\n"
+	"// message owning them.  The registry caches them by pointer in weak-valued\n"
+	"// tables, one for read-only and one for writable views, so that reading\n"
+	"// msg.pos.x in a loop reuses a single userdata.  A weak-keyed table maps\n"
+	"// every view to its owner, keeping the owner alive as long as the view.\n"
+	"#define PROTOBUF_LUA_VIEWS \"protobuf.views\"\n"
+	"#define PROTOBUF_LUA_READONLY_VIEWS \"protobuf.readonly_views\"\n"
+	"#define PROTOBUF_LUA_VIEW_OWNERS \"protobuf.view_owners\"\n"
+	"\n"
+	"// Pushes the registry table |name|, creating it with the weak |mode|.\n"
+	"inline void PushWeakTable(lua_State* L, const char* name, const char* mode) {\n"
+	"  lua_getfield(L, LUA_REGISTRYINDEX, name);\n"
+	"  if (lua_istable(L, -1)) return;\n"
+	"  lua_pop(L, 1);\n"
+	"  lua_newtable(L);\n"
+	"  lua_createtable(L, 0, 1);\n"
+	"  lua_pushstring(L, mode);\n"
+	"  lua_setfield(L, -2, \"__mode\");\n"
+	"  lua_setmetatable(L, -2);\n"
+	"  lua_pushvalue(L, -1);\n"
+	"  lua_setfield(L, LUA_REGISTRYINDEX, name);\n"
+	"}\n"
+	"\n"
+	"// Pushes the cached view of |message| and returns true if there is one\n"
+	"// borrowed from the message at stack slot |owner|; pushes nothing\n"
+	"// otherwise.\n"
+	"inline bool FindView(lua_State* L, const void* message, bool readonly, int owner) {\n"
+	"  owner = AbsIndex(L, owner);\n"
+	"  PushWeakTable(L, readonly ? PROTOBUF_LUA_READONLY_VIEWS : PROTOBUF_LUA_VIEWS, \"v\");\n"
+	"  lua_pushlightuserdata(L, const_cast<void*>(message));\n"
+	"  lua_rawget(L, -2);\n"
+	"  if (!lua_isnil(L, -1)) {\n"
+	"    PushWeakTable(L, PROTOBUF_LUA_VIEW_OWNERS, \"k\");\n"
+	"    lua_pushvalue(L, -2);\n"
+	"    lua_rawget(L, -2);\n"
+	"    bool found = lua_rawequal(L, -1, owner) != 0;\n"
+	"    lua_pop(L, 2);\n"
+	"    if (found) {\n"
+	"      lua_remove(L, -2);\n"
+	"      return true;\n"
+	"    }\n"
+	"  }\n"
+	"  lua_pop(L, 2);\n"
+	"  return false;\n"
+	"}\n"
+	"\n"
+	"// Caches the view on top of the stack as borrowed from the message at\n"
+	"// stack slot |owner|.\n"
+	"inline void CacheView(lua_State* L, const void* message, bool readonly, int owner) {\n"
+	"  owner = AbsIndex(L, owner);\n"
+	"  int view = lua_gettop(L);\n"
+	"  PushWeakTable(L, readonly ? PROTOBUF_LUA_READONLY_VIEWS : PROTOBUF_LUA_VIEWS, \"v\");\n"
+	"  lua_pushlightuserdata(L, const_cast<void*>(message));\n"
+	"  lua_pushvalue(L, view);\n"
+	"  lua_rawset(L, -3);\n"
+	"  PushWeakTable(L, PROTOBUF_LUA_VIEW_OWNERS, \"k\");\n"
+	"  lua_pushvalue(L, view);\n"
+	"  lua_pushvalue(L, owner);\n"
+	"  lua_rawset(L, -3);\n"
+	"  lua_pop(L, 2);\n"
+	"}\n"
+	"\n"
+	"// Drops the cached views of |message|, which is about to change hands, and\n"
+	"// pushes the writable and the read-only one, or nil for either.\n"
+	"inline void ForgetViews(lua_State* L, const void* message) {\n"
+	"  for (int readonly = 0; readonly < 2; readonly++) {\n"
+	"    PushWeakTable(L, readonly ? PROTOBUF_LUA_READONLY_VIEWS : PROTOBUF_LUA_VIEWS, \"v\");\n"
+	"    lua_pushlightuserdata(L, const_cast<void*>(message));\n"
+	"    lua_rawget(L, -2);\n"
+	"    lua_pushlightuserdata(L, const_cast<void*>(message));\n"
+	"    lua_pushnil(L);\n"
+	"    lua_rawset(L, -4);\n"
+	"    lua_remove(L, -2);\n"
+	"  }\n"
+	"}\n"
+	"\n"
+	"// Drops the cached views borrowed from the messages at stack slots |first|\n"
+	"// and |second|, whose sub-messages are about to trade places, and from\n"
+	"// those views in turn, and pushes a sequence of them.  This walks the\n"
+	"// whole cache, which Swap() can afford.\n"
+	"inline void ForgetOwnedViews(lua_State* L, int first, int second) {\n"
+	"  first = AbsIndex(L, first);\n"
+	"  second = AbsIndex(L, second);\n"
+	"  lua_newtable(L);\n"
+	"  int views = lua_gettop(L);\n"
+	"  lua_newtable(L);\n"
+	"  int owners = views + 1;\n"
+	"  lua_pushvalue(L, first);\n"
+	"  lua_pushboolean(L, 1);\n"
+	"  lua_rawset(L, owners);\n"
+	"  lua_pushvalue(L, second);\n"
+	"  lua_pushboolean(L, 1);\n"
+	"  lua_rawset(L, owners);\n"
+	"  PushWeakTable(L, PROTOBUF_LUA_VIEW_OWNERS, \"k\");\n"
+	"  int count = 0;\n"
+	"  int found;\n"
+	"  do {\n"
+	"    found = count;\n"
+	"    for (int readonly = 0; readonly < 2; readonly++) {\n"
+	"      PushWeakTable(L, readonly ? PROTOBUF_LUA_READONLY_VIEWS : PROTOBUF_LUA_VIEWS, \"v\");\n"
+	"      lua_pushnil(L);\n"
+	"      while (lua_next(L, -2)) {\n"
+	"        lua_pushvalue(L, -1);\n"
+	"        lua_rawget(L, owners + 1);\n"
+	"        lua_rawget(L, owners);\n"
+	"        bool borrowed = lua_toboolean(L, -1) != 0;\n"
+	"        lua_pop(L, 1);\n"
+	"        if (borrowed) {\n"
+	"          lua_pushvalue(L, -1);\n"
+	"          lua_pushboolean(L, 1);\n"
+	"          lua_rawset(L, owners);\n"
+	"          lua_rawseti(L, views, ++count);\n"
+	"          lua_pushvalue(L, -1);\n"
+	"          lua_pushnil(L);\n"
+	"          lua_rawset(L, -4);\n"
+	"        } else {\n"
+	"          lua_pop(L, 1);\n"
+	"        }\n"
+	"      }\n"
+	"      lua_pop(L, 1);\n"
+	"    }\n"
+	"  } while (count != found);\n"
+	"  lua_pop(L, 2);\n"
+	"}\n"
+	"\n"
+	"// Pushes the global table pb, creating it if need be.\n"
+	"inline void PushPbTable(lua_State* L) {\n"
+	"  lua_getglobal(L, \"pb\");\n"
+	"  if (!lua_istable(L, -1)) {\n"
+	"    lua_pop(L, 1);\n"
+	"    lua_newtable(L);\n"
+	"    lua_pushvalue(L, -1);\n"
+	"    lua_setglobal(L, \"pb\");\n"
+	"  }\n"
+	"}\n"
+	"\n"
+	"#ifdef PROTOBUF_FIELD_COUNTERS_H__\n"
+	"// pb.field_counters() returns protobuf_field_counters::Dump().\n"
+	"inline int DumpFieldCounters(lua_State* L) {\n"
+	"  std::string dump = ::protobuf_field_counters::Dump();\n"
+	"  lua_pushlstring(L, dump.data(), dump.size());\n"
+	"  return 1;\n"
+	"}\n"
+	"\n"
+	"inline int ResetFieldCounters(lua_State* L) {\n"
+	"  ::protobuf_field_counters::Reset();\n"
+	"  return 0;\n"
+	"}\n"
+	"\n"
+	"// Sets pb.field_counters and pb.reset_field_counters.\n"
+	"inline void RegisterFieldCounters(lua_State* L) {\n"
+	"  PushPbTable(L);\n"
+	"  lua_pushcfunction(L, &DumpFieldCounters);\n"
+	"  lua_setfield(L, -2, \"field_counters\");\n"
+	"  lua_pushcfunction(L, &ResetFieldCounters);\n"
+	"  lua_setfield(L, -2, \"reset_field_counters\");\n"
+	"  lua_pop(L, 1);\n"
+	"}\n"
+	"#endif  // PROTOBUF_FIELD_COUNTERS_H__\n"
+	"\n"
+	"#ifdef PROTOBUF_LUA_ARENA_H__\n"
+	"// While pb.with_arena() runs, the registry holds under this key a sequence\n"
+	"// of the userdata pushed for messages in its arena, each followed by the\n"
+	"// message it wraps.\n"
+	"#define PROTOBUF_LUA_ARENA_SCOPE \"protobuf.arena_scope\"\n"
+	"\n"
+	"// Adds the userdata on top of the stack, which wraps |message|, to the\n"
+	"// current scope, if any.\n"
+	"inline void TrackArenaMessage(lua_State* L, const void* message) {\n"
+	"  lua_getfield(L, LUA_REGISTRYINDEX, PROTOBUF_LUA_ARENA_SCOPE);\n"
+	"  if (lua_istable(L, -1)) {\n"
+	"    int size = static_cast<int>(PROTOBUF_LUA_RAWLEN(L, -1));\n"
+	"    lua_pushvalue(L, -2);\n"
+	"    lua_rawseti(L, -2, size + 1);\n"
+	"    lua_pushlightuserdata(L, const_cast<void*>(message));\n"
+	"    lua_rawseti(L, -2, size + 2);\n"
+	"  }\n"
+	"  lua_pop(L, 1);\n"
+	"}\n"
+	"\n"
+	"// pb.with_arena(fn, ...) calls fn(...) with a fresh arena current, so the\n"
+	"// messages it creates are bump-allocated, and returns what fn returns.\n"
+	"// Afterwards the userdata tracked for the arena are finalized, which frees\n"
+	"// the arena unless C++ still holds some of its messages, and views of its\n"
+	"// messages leave the cache, so that the next access makes a fresh one.\n"
+	"inline int WithArena(lua_State* L) {\n"
+	"  luaL_checktype(L, 1, LUA_TFUNCTION);\n"
+	"  int arguments = lua_gettop(L) - 1;\n"
+	"  lua_getfield(L, LUA_REGISTRYINDEX, PROTOBUF_LUA_ARENA_SCOPE);\n"
+	"  lua_insert(L, 1);\n"
+	"  lua_newtable(L);\n"
+	"  lua_pushvalue(L, -1);\n"
+	"  lua_setfield(L, LUA_REGISTRYINDEX, PROTOBUF_LUA_ARENA_SCOPE);\n"
+	"  lua_insert(L, 2);\n"
+	"\n"
+	"  ::protobuf_lua_arena::Arena* arena = new ::protobuf_lua_arena::Arena;\n"
+	"  ::protobuf_lua_arena::Arena* previous = ::protobuf_lua_arena::Arena::Current();\n"
+	"  ::protobuf_lua_arena::Arena::Current() = arena;\n"
+	"  int status = lua_pcall(L, arguments, LUA_MULTRET, 0);\n"
+	"  ::protobuf_lua_arena::Arena::Current() = previous;\n"
+	"\n"
+	"  int size = static_cast<int>(PROTOBUF_LUA_RAWLEN(L, 2));\n"
+	"  for (int i = 1; i <= size; i += 2) {\n"
+	"    lua_rawgeti(L, 2, i + 1);\n"
+	"    ForgetViews(L, lua_touserdata(L, -1));\n"
+	"    lua_pop(L, 3);\n"
+	"    lua_rawgeti(L, 2, i);\n"
+	"    if (luaL_getmetafield(L, -1, \"__gc\")) {\n"
+	"      lua_insert(L, -2);\n"
+	"      lua_call(L, 1, 0);\n"
+	"    } else {\n"
+	"      lua_pop(L, 1);\n"
+	"    }\n"
+	"  }\n"
+	"  arena->Close();\n"
+	"  lua_pushvalue(L, 1);\n"
+	"  lua_setfield(L, LUA_REGISTRYINDEX, PROTOBUF_LUA_ARENA_SCOPE);\n"
+	"\n"
+	"  if (status != 0) lua_error(L);\n"
+	"  return lua_gettop(L) - 2;\n"
+	"}\n"
+	"\n"
+	"// Sets pb.with_arena.\n"
+	"inline void RegisterArena(lua_State* L) {\n"
+	"  PushPbTable(L);\n"
+	"  lua_pushcfunction(L, &WithArena);\n"
+	"  lua_setfield(L, -2, \"with_arena\");\n"
+	"  lua_pop(L, 1);\n"
+	"}\n"
+	"#endif  // PROTOBUF_LUA_ARENA_H__\n"
+	"\n"
+	"}  // namespace protobuf_lua\n"
+	"}  // namespace\n"
+	"\n";
+
+// Mirrors protobuf_lua::HashKey() in kLuaRuntime.
+uint32 LuaFieldHash(const string& key, uint32 seed) {
+	uint32 hash = 2166136261u ^ seed;
+	for (int i = 0; i < key.size(); i++) {
+		hash ^= static_cast<uint8>(key[i]);
+		hash *= 16777619u;
+	}
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6bu;
+	hash ^= hash >> 13;
+	return hash;
+}
+
+// A perfect hash over field names, in the "hash and displace" style: the
+// unseeded hash of a name picks an entry of |seeds|, and hashing the name
+// again with that seed gives its slot.  Both tables are powers of two.
+struct LuaFieldTable {
+	vector<const FieldDescriptor*> slots;  // NULL for an empty slot
+	vector<uint32> seeds;
+};
+
+// Give up on a bucket after this many seeds and retry with more slots.
+const uint32 kMaxLuaFieldSeed = 1 << 16;
+
+void BuildLuaFieldTable(const vector<const FieldDescriptor*>& fields,
+		LuaFieldTable* table) {
+	int seed_count = 1;
+	while (seed_count < fields.size()) seed_count <<= 1;
+
+	for (int slot_count = seed_count; ; slot_count <<= 1) {
+		vector<vector<int> > buckets(seed_count);
+		int largest = 0;
+		for (int i = 0; i < fields.size(); i++) {
+			vector<int>& bucket = buckets[LuaFieldHash(fields[i]->name(), 0) & (seed_count - 1)];
+			bucket.push_back(i);
+			largest = max(largest, static_cast<int>(bucket.size()));
+		}
+
+		table->slots.assign(slot_count, NULL);
+		table->seeds.assign(seed_count, 0);
+
+		// Place the largest buckets first, while most slots are still free.
+		bool placed_all = true;
+		for (int size = largest; size > 0 && placed_all; size--) {
+			for (int b = 0; b < seed_count && placed_all; b++) {
+				const vector<int>& bucket = buckets[b];
+				if (bucket.size() != size) continue;
+
+				placed_all = false;
+				for (uint32 seed = 1; seed < kMaxLuaFieldSeed && !placed_all; seed++) {
+					vector<int> taken;
+					for (int i = 0; i < bucket.size(); i++) {
+						int slot = LuaFieldHash(fields[bucket[i]]->name(), seed) & (slot_count - 1);
+						if (table->slots[slot] != NULL ||
+								find(taken.begin(), taken.end(), slot) != taken.end()) {
+							break;
+						}
+						taken.push_back(slot);
+					}
+					if (taken.size() != bucket.size()) continue;
+
+					for (int i = 0; i < bucket.size(); i++) {
+						table->slots[taken[i]] = fields[bucket[i]];
+					}
+					table->seeds[b] = seed;
+					placed_all = true;
+				}
+			}
+		}
+		if (placed_all) return;
+	}
+}
+
+// Prints code storing the table or message at |index| into |target|, an
+// expression of the field's message type.  A table is imported at nesting
+// depth |depth|.
+void PrintLuaAssignMessage(io::Printer* printer, map<string, string> vars,
+		const string& index, const string& target, const string& depth,
+		bool clear, bool accept_messages) {
+	vars["index"] = index;
+	vars["target"] = target;
+	vars["depth"] = depth;
+
+	if (!accept_messages) {
+		printer->Print(vars,
+			"luaL_checktype(L, $index$, LUA_TTABLE);\n");
+		if (clear) {
+			printer->Print(vars,
+				"$target$->Clear();\n");
+		}
+		printer->Print(vars,
+			"$target$->ImportFromLua(L, $index$, $depth$);\n");
+		return;
+	}
+
+	printer->Print(vars,
+		"if (lua_istable(L, $index$)) {\n");
+	if (clear) {
+		printer->Print(vars,
+			"  $target$->Clear();\n");
+	}
+	printer->Print(vars,
+		"  $target$->ImportFromLua(L, $index$, $depth$);\n"
+		"} else {\n"
+		"  const $type$* from = ::protobuf_lua::CheckMessage< $type$ >(L, $index$, \"$full_name$\");\n"
+		"  $type$* to = $target$;\n"
+		"  if (from != to) to->CopyFrom(*from);\n"
+		"}\n");
+}
+
+// ListLuaNamedFields() in field number order, which is the order fields are
+// serialized in.
+void ListLuaFieldsByNumber(const Descriptor* descriptor,
+		vector<const FieldDescriptor*>* fields) {
+	vector<const FieldDescriptor*> named;
+	ListLuaNamedFields(descriptor, &named);
+	scoped_array<const FieldDescriptor*> ordered_fields(
+		SortFieldsByNumber(descriptor));
+	fields->clear();
+	for (int i = 0; i < descriptor->field_count(); i++) {
+		if (find(named.begin(), named.end(), ordered_fields[i]) != named.end()) {
+			fields->push_back(ordered_fields[i]);
+		}
+	}
+}
+
+// Prints code decoding one occurrence of |field| into the message's table,
+// or, for a repeated field, appending it to the sequence at |sequence|.  A
+// sub-message is merged into the table the field already holds, if any.
+// Enum values the enum does not define are dropped.
+void PrintLuaDecodeField(io::Printer* printer, const FieldDescriptor* field,
+		const string& sequence) {
+	map<string, string> vars;
+	SetCommonFieldVariables(field, &vars);
+	vars["sequence"] = sequence;
+
+	const char* store = field->is_repeated() ?
+		"lua_rawseti(L, $sequence$, ++$name$_size);\n" :
+		"lua_rawset(L, table);\n";
+	const char* key = field->is_repeated() ? "" :
+		"lua_pushliteral(L, \"$name$\");\n";
+
+	switch (field->cpp_type()) {
+		case FieldDescriptor::CPPTYPE_STRING:
+			printer->Print(vars, key);
+			printer->Print(
+				"DO_(::protobuf_lua::ReadString(L, input));\n");
+			printer->Print(vars, store);
+			return;
+		case FieldDescriptor::CPPTYPE_MESSAGE:
+			vars["type"] = FieldMessageTypeName(field);
+			if (field->is_repeated()) {
+				printer->Print(
+					"lua_pushnil(L);\n");
+			} else {
+				printer->Print(vars,
+					"lua_pushliteral(L, \"$name$\");\n"
+					"lua_pushvalue(L, -1);\n"
+					"lua_rawget(L, table);\n");
+			}
+			if (field->type() == FieldDescriptor::TYPE_GROUP) {
+				printer->Print(vars,
+					"DO_(::protobuf_lua::DecodeGroup< $type$ >(L, $number$, input));\n");
+			} else {
+				printer->Print(vars,
+					"DO_(::protobuf_lua::DecodeMessage< $type$ >(L, input));\n");
+			}
+			printer->Print(vars, store);
+			return;
+		case FieldDescriptor::CPPTYPE_ENUM:
+			vars["type"] = "int";
+			break;
+		default:
+			vars["type"] = PrimitiveTypeName(field->cpp_type());
+			break;
+	}
+
+	vars["wire_format_field_type"] =
+		"::google::protobuf::internal::WireFormatLite::" + FieldDescriptorProto_Type_Name(
+			static_cast<FieldDescriptorProto_Type>(field->type()));
+	printer->Print(vars,
+		"$type$ value;\n"
+		"DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<\n"
+		"         $type$, $wire_format_field_type$>(\n"
+		"       input, &value)));\n");
+	if (field->cpp_type() == FieldDescriptor::CPPTYPE_ENUM) {
+		printer->Print(
+			"if ($type$_IsValid(value)) {\n",
+			"type", ClassName(field->enum_type(), true));
+		printer->Indent();
+	}
+	printer->Print(vars, key);
+	PrintLuaPush(printer, field, "value");
+	printer->Print(vars, store);
+	if (field->cpp_type() == FieldDescriptor::CPPTYPE_ENUM) {
+		printer->Outdent();
+		printer->Print("}\n");
+	}
+}
+
+// Prints code decoding a packed |field| into the sequence at |sequence|.
+void PrintLuaDecodePacked(io::Printer* printer, const FieldDescriptor* field,
+		const string& sequence) {
+	printer->Print(
+		"::google::protobuf::uint32 length;\n"
+		"DO_(input->ReadVarint32(&length));\n"
+		"::google::protobuf::io::CodedInputStream::Limit limit = input->PushLimit(length);\n"
+		"while (input->BytesUntilLimit() > 0) {\n");
+	printer->Indent();
+	PrintLuaDecodeField(printer, field, sequence);
+	printer->Outdent();
+	printer->Print(
+		"}\n"
+		"input->PopLimit(limit);\n");
+}
+
+// Returns the encoded size, without the tag, of the value PrintLuaCheck()
+// left in "value", or of the string whose size is in "value_size".
+string LuaValueSize(const FieldDescriptor* field) {
+	switch (field->type()) {
+		case FieldDescriptor::TYPE_FIXED32:
+		case FieldDescriptor::TYPE_FIXED64:
+		case FieldDescriptor::TYPE_SFIXED32:
+		case FieldDescriptor::TYPE_SFIXED64:
+		case FieldDescriptor::TYPE_FLOAT:
+		case FieldDescriptor::TYPE_DOUBLE:
+		case FieldDescriptor::TYPE_BOOL:
+			return string("::google::protobuf::internal::WireFormatLite::k") +
+				DeclaredTypeMethodName(field->type()) + "Size";
+		case FieldDescriptor::TYPE_STRING:
+		case FieldDescriptor::TYPE_BYTES:
+			return "::google::protobuf::io::CodedOutputStream::VarintSize32("
+				"static_cast< ::google::protobuf::uint32>(value_size)) + static_cast<int>(value_size)";
+		default:
+			return string("::google::protobuf::internal::WireFormatLite::") +
+				DeclaredTypeMethodName(field->type()) + "Size(value)";
+	}
+}
+
+// Returns an expression converting the Lua value on top of the stack, which
+// has been checked already, to |field|'s type.
+string LuaToValue(const FieldDescriptor* field) {
+	string type = PrimitiveTypeName(field->cpp_type());
+	switch (field->cpp_type()) {
+		case FieldDescriptor::CPPTYPE_INT32:
+			return "static_cast< ::google::protobuf::int32>(lua_tointeger(L, -1))";
+		case FieldDescriptor::CPPTYPE_UINT32:
+		case FieldDescriptor::CPPTYPE_INT64:
+		case FieldDescriptor::CPPTYPE_UINT64:
+			return "static_cast< " + type + ">(::protobuf_lua::ToInteger64(L, -1))";
+		case FieldDescriptor::CPPTYPE_DOUBLE:
+		case FieldDescriptor::CPPTYPE_FLOAT:
+			return "static_cast< " + type + ">(lua_tonumber(L, -1))";
+		case FieldDescriptor::CPPTYPE_BOOL:
+			return "lua_toboolean(L, -1) != 0";
+		case FieldDescriptor::CPPTYPE_ENUM:
+			return "static_cast<int>(lua_tointeger(L, -1))";
+		default:
+			GOOGLE_LOG(FATAL) << "Can't get here.";
+			return "";
+	}
+}
+
+// Prints code checking the value of |field| on top of the stack and adding
+// its size to |total|; |packed| leaves out the tag.
+void PrintLuaSizeValue(io::Printer* printer, const FieldDescriptor* field,
+		const string& total, bool packed) {
+	map<string, string> vars;
+	SetCommonFieldVariables(field, &vars);
+	vars["total"] = total;
+	vars["tag_size"] = packed ? "" : vars["tag_size"] + " + ";
+
+	if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+		vars["type"] = FieldMessageTypeName(field);
+		printer->Print(vars,
+			"luaL_checktype(L, -1, LUA_TTABLE);\n");
+		if (field->type() == FieldDescriptor::TYPE_GROUP) {
+			printer->Print(vars,
+				"$total$ += $tag_size$$type$::ByteSizeFromLua(L, lua_gettop(L), cache, depth + 1);\n");
+		} else {
+			printer->Print(vars,
+				"int position = ::protobuf_lua::ReserveSize(L, cache);\n"
+				"int size = $type$::ByteSizeFromLua(L, lua_gettop(L), cache, depth + 1);\n"
+				"::protobuf_lua::SetSize(L, cache, position, size);\n"
+				"$total$ += $tag_size$::google::protobuf::io::CodedOutputStream::VarintSize32(size) + size;\n");
+		}
+		return;
+	}
+
+	// The size of a string or of a fixed-size value does not depend on the
+	// value, so those are only checked.
+	switch (field->type()) {
+		case FieldDescriptor::TYPE_FIXED32:
+		case FieldDescriptor::TYPE_FIXED64:
+		case FieldDescriptor::TYPE_SFIXED64:
+			printer->Print("::protobuf_lua::CheckInteger64(L, -1);\n");
+			break;
+		case FieldDescriptor::TYPE_SFIXED32:
+			printer->Print("luaL_checkinteger(L, -1);\n");
+			break;
+		case FieldDescriptor::TYPE_FLOAT:
+		case FieldDescriptor::TYPE_DOUBLE:
+			printer->Print("luaL_checknumber(L, -1);\n");
+			break;
+		case FieldDescriptor::TYPE_BOOL:
+			printer->Print("luaL_checkany(L, -1);\n");
+			break;
+		case FieldDescriptor::TYPE_STRING:
+		case FieldDescriptor::TYPE_BYTES:
+			printer->Print(
+				"size_t value_size;\n"
+				"luaL_checklstring(L, -1, &value_size);\n");
+			break;
+		default:
+			PrintLuaCheck(printer, field, "-1");
+			break;
+	}
+	vars["size"] = LuaValueSize(field);
+	printer->Print(vars,
+		"$total$ += $tag_size$$size$;\n");
+}
+
+// Prints code writing the value of |field| on top of the stack to "target";
+// |packed| leaves out the tag.
+void PrintLuaEncodeValue(io::Printer* printer, const FieldDescriptor* field,
+		bool packed) {
+	map<string, string> vars;
+	SetCommonFieldVariables(field, &vars);
+	vars["tag"] = SimpleItoa(WireFormat::MakeTag(field));
+
+	switch (field->cpp_type()) {
+		case FieldDescriptor::CPPTYPE_MESSAGE:
+			vars["type"] = FieldMessageTypeName(field);
+			if (field->type() == FieldDescriptor::TYPE_GROUP) {
+				vars["end_tag"] = SimpleItoa(internal::WireFormatLite::MakeTag(
+					field->number(), internal::WireFormatLite::WIRETYPE_END_GROUP));
+				printer->Print(vars,
+					"target = ::google::protobuf::io::CodedOutputStream::WriteTagToArray($tag$, target);\n"
+					"target = $type$::EncodeFromLua(L, lua_gettop(L), sizes, target);\n"
+					"target = ::google::protobuf::io::CodedOutputStream::WriteTagToArray($end_tag$, target);\n");
+			} else {
+				printer->Print(vars,
+					"target = ::google::protobuf::io::CodedOutputStream::WriteTagToArray($tag$, target);\n"
+					"target = ::google::protobuf::io::CodedOutputStream::WriteVarint32ToArray(\n"
+					"  static_cast< ::google::protobuf::uint32>(*(*sizes)++), target);\n"
+					"target = $type$::EncodeFromLua(L, lua_gettop(L), sizes, target);\n");
+			}
+			return;
+		case FieldDescriptor::CPPTYPE_STRING:
+			printer->Print(vars,
+				"size_t size;\n"
+				"const char* data = lua_tolstring(L, -1, &size);\n"
+				"target = ::protobuf_lua::WriteStringToArray($tag$, data, size, target);\n");
+			return;
+		default:
+			break;
+	}
+
+	vars["value"] = LuaToValue(field);
+	if (packed) {
+		printer->Print(vars,
+			"target = ::google::protobuf::internal::WireFormatLite::\n"
+			"  Write$declared_type$NoTagToArray($value$, target);\n");
+	} else {
+		printer->Print(vars,
+			"target = ::google::protobuf::internal::WireFormatLite::\n"
+			"  Write$declared_type$ToArray($number$, $value$, target);\n");
+	}
+}
+
+}  // namespace
+
+void PrintLuaRuntime(io::Printer* printer) {
+	printer->Print(kLuaRuntime);
+}
+
+void PrintLuaLazyRuntime(io::Printer* printer) {
+	printer->Print(kLuaLazyRuntime);
+}
+
+void PrintLuaPush(io::Printer* printer, const FieldDescriptor* field,
+		const string& value) {
+	const char* push = NULL;
+	switch (field->cpp_type()) {
+		case FieldDescriptor::CPPTYPE_INT32:
+		case FieldDescriptor::CPPTYPE_ENUM:
+			push = "lua_pushinteger(L, $value$);\n";
+			break;
+		case FieldDescriptor::CPPTYPE_UINT32:
+		case FieldDescriptor::CPPTYPE_INT64:
+		case FieldDescriptor::CPPTYPE_UINT64:
+			push = "::protobuf_lua::PushInteger64(L, $value$);\n";
+			break;
+		case FieldDescriptor::CPPTYPE_DOUBLE:
+		case FieldDescriptor::CPPTYPE_FLOAT:
+			push = "lua_pushnumber(L, $value$);\n";
+			break;
+		case FieldDescriptor::CPPTYPE_BOOL:
+			push = "lua_pushboolean(L, $value$);\n";
+			break;
+		case FieldDescriptor::CPPTYPE_STRING:
+			push = "::protobuf_lua::PushString(L, $value$);\n";
+			break;
+		case FieldDescriptor::CPPTYPE_MESSAGE:
+			GOOGLE_LOG(FATAL) << "Can't get here.";
+			break;
+	}
+	printer->Print(push, "value", value);
+}
+
+string PrintLuaCheck(io::Printer* printer, const FieldDescriptor* field,
+		const string& index) {
+	map<string, string> vars;
+	vars["index"] = index;
+
+	switch (field->cpp_type()) {
+		case FieldDescriptor::CPPTYPE_INT32:
+			printer->Print(vars,
+				"::google::protobuf::int32 value = static_cast< ::google::protobuf::int32>(luaL_checkinteger(L, $index$));\n");
+			return "value";
+		case FieldDescriptor::CPPTYPE_UINT32:
+		case FieldDescriptor::CPPTYPE_INT64:
+		case FieldDescriptor::CPPTYPE_UINT64:
+			vars["type"] = PrimitiveTypeName(field->cpp_type());
+			printer->Print(vars,
+				"$type$ value = static_cast< $type$>(::protobuf_lua::CheckInteger64(L, $index$));\n");
+			return "value";
+		case FieldDescriptor::CPPTYPE_DOUBLE:
+		case FieldDescriptor::CPPTYPE_FLOAT:
+			vars["type"] = PrimitiveTypeName(field->cpp_type());
+			printer->Print(vars,
+				"$type$ value = static_cast< $type$>(luaL_checknumber(L, $index$));\n");
+			return "value";
+		case FieldDescriptor::CPPTYPE_BOOL:
+			printer->Print(vars,
+				"luaL_checkany(L, $index$);\n"
+				"bool value = lua_toboolean(L, $index$) != 0;\n");
+			return "value";
+		case FieldDescriptor::CPPTYPE_ENUM:
+			vars["type"] = ClassName(field->enum_type(), true);
+			printer->Print(vars,
+				"int value = static_cast<int>(luaL_checkinteger(L, $index$));\n"
+				"luaL_argcheck(L, $type$_IsValid(value), $index$, \"invalid enum value\");\n");
+			return "static_cast< " + vars["type"] + " >(value)";
+		case FieldDescriptor::CPPTYPE_STRING:
+			printer->Print(vars,
+				"size_t value_size;\n"
+				"const char* value = luaL_checklstring(L, $index$, &value_size);\n");
+			return "value, value_size";
+		case FieldDescriptor::CPPTYPE_MESSAGE:
+			GOOGLE_LOG(FATAL) << "Can't get here.";
+			break;
+	}
+	return "";
+}
+
+void PrintLuaAssignField(io::Printer* printer, const FieldDescriptor* field,
+		const string& value, const string& item, const string& depth,
+		bool replace, bool accept_messages) {
+	map<string, string> vars;
+	SetCommonFieldVariables(field, &vars);
+	vars["value"] = value;
+	vars["item"] = item;
+	if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+		vars["type"] = FieldMessageTypeName(field);
+		vars["full_name"] = field->message_type()->full_name();
+	}
+
+	if (!field->is_repeated()) {
+		if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+			PrintLuaAssignMessage(printer, vars, value,
+				"message->mutable_" + vars["name"] + "()", depth, replace, accept_messages);
+		} else {
+			vars["argument"] = PrintLuaCheck(printer, field, value);
+			printer->Print(vars,
+				"message->set_$name$($argument$);\n");
+		}
+		return;
+	}
+
+	printer->Print(vars,
+		"luaL_checktype(L, $value$, LUA_TTABLE);\n");
+	if (replace) {
+		printer->Print(vars,
+			"message->clear_$name$();\n");
+	}
+	printer->Print(vars,
+		"int size = static_cast<int>(PROTOBUF_LUA_RAWLEN(L, $value$));\n"
+		"message->mutable_$name$()->Reserve(message->$name$_size() + size);\n"
+		"for (int i = 1; i <= size; i++) {\n");
+	printer->Indent();
+	printer->Print(vars,
+		"lua_rawgeti(L, $value$, i);\n");
+	if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+		PrintLuaAssignMessage(printer, vars, item,
+			"message->add_" + vars["name"] + "()", depth, false, accept_messages);
+	} else {
+		vars["argument"] = PrintLuaCheck(printer, field, item);
+		printer->Print(vars,
+			"message->add_$name$($argument$);\n");
+	}
+	printer->Print(
+		"lua_pop(L, 1);\n");
+	printer->Outdent();
+	printer->Print(
+		"}\n");
+}
+
+void PrintLuaRepeatedBulkHelpers(io::Printer* printer,
+		const FieldDescriptor* field) {
+	map<string, string> vars;
+	SetCommonFieldVariables(field, &vars);
+	vars["type"] = PrimitiveTypeName(field->cpp_type());
+	vars["value"] = LuaToValue(field);
+	vars["expected"] = field->cpp_type() == FieldDescriptor::CPPTYPE_BOOL ?
+		"boolean" : "number";
+
+	printer->Print(vars,
+		"// Pushes elements [first, first + count) of $name$ as a sequence.\n"
+		"static void $classname$_lua_Push_$name$(lua_State* L, const $classname$& message,\n"
+		"    int first, int count) {\n"
+		"  const $type$* data = message.$name$().data() + first;\n"
+		"  lua_createtable(L, count, 0);\n"
+		"  for (int i = 0; i < count; i++) {\n");
+	printer->Indent();
+	printer->Indent();
+	PrintLuaPush(printer, field, "data[i]");
+	printer->Outdent();
+	printer->Outdent();
+	printer->Print(vars,
+		"    lua_rawseti(L, -2, i + 1);\n"
+		"  }\n"
+		"}\n"
+		"\n"
+		"// Stores the sequence at |index| over $name$ from element |first| on,\n"
+		"// appending whatever runs past the end, and returns its length.  The\n"
+		"// values are converted into the space past the end first, so a bad one\n"
+		"// leaves the field untouched.\n"
+		"static int $classname$_lua_Store_$name$(lua_State* L, $classname$* message,\n"
+		"    int index, int first) {\n"
+		"  index = ::protobuf_lua::AbsIndex(L, index);\n"
+		"  luaL_checktype(L, index, LUA_TTABLE);\n"
+		"  ::google::protobuf::RepeatedField< $type$ >* field = message->mutable_$name$();\n"
+		"  int old_size = field->size();\n"
+		"  int size = static_cast<int>(PROTOBUF_LUA_RAWLEN(L, index));\n"
+		"  field->Reserve(old_size + size);\n"
+		"  for (int i = 1; i <= size; i++) {\n"
+		"    lua_rawgeti(L, index, i);\n");
+	if (field->cpp_type() == FieldDescriptor::CPPTYPE_ENUM) {
+		// Enum values are validated in the same pass that converts them.
+		vars["enum"] = ClassName(field->enum_type(), true);
+		printer->Print(vars,
+			"    if (lua_type(L, -1) != LUA_TNUMBER || !$enum$_IsValid($value$)) {\n"
+			"      field->Truncate(old_size);\n"
+			"      luaL_error(L, \"bad element #%d for $name$ (invalid enum value)\", i);\n"
+			"    }\n");
+	} else {
+		if (field->cpp_type() == FieldDescriptor::CPPTYPE_BOOL) {
+			printer->Print(vars,
+				"    if (lua_type(L, -1) != LUA_TBOOLEAN) {\n");
+		} else {
+			printer->Print(vars,
+				"    if (lua_type(L, -1) != LUA_TNUMBER) {\n");
+		}
+		printer->Print(vars,
+			"      field->Truncate(old_size);\n"
+			"      luaL_error(L, \"bad element #%d for $name$ ($expected$ expected, got %s)\",\n"
+			"          i, luaL_typename(L, -1));\n"
+			"    }\n");
+	}
+	printer->Print(vars,
+		"    field->AddAlreadyReserved($value$);\n"
+		"    lua_pop(L, 1);\n"
+		"  }\n"
+		"  $type$* data = field->mutable_data();\n"
+		"  ::std::copy(data + old_size, data + old_size + size, data + first);\n"
+		"  field->Truncate(::std::max(old_size, first + size));\n"
+		"  return size;\n"
+		"}\n"
+		"\n");
+}
+
+void ListLuaNamedFields(const Descriptor* descriptor,
+		vector<const FieldDescriptor*>* fields) {
+	fields->clear();
+	for (int i = 0; i < descriptor->field_count(); i++) {
+		const FieldDescriptor* field = descriptor->field(i);
+		if (field->cpp_type() != FieldDescriptor::CPPTYPE_STRING ||
+				field->options().ctype() == FieldOptions::STRING) {
+			fields->push_back(field);
+		}
+	}
+}
+
+void PrintLuaFieldLookup(io::Printer* printer, const string& classname,
+		const vector<const FieldDescriptor*>& fields) {
+	LuaFieldTable table;
+	BuildLuaFieldTable(fields, &table);
+
+	map<string, string> vars;
+	vars["classname"] = classname;
+	vars["slot_mask"] = SimpleItoa(static_cast<int>(table.slots.size() - 1));
+	vars["seed_mask"] = SimpleItoa(static_cast<int>(table.seeds.size() - 1));
+
+	printer->Print(vars,
+		"// Returns the number of the field named by the string at |index|, or 0.\n"
+		"static int $classname$_lua_FindField(lua_State* L, int index) {\n"
+		"  static const ::protobuf_lua::FieldSlot kSlots[] = {\n");
+	for (int i = 0; i < table.slots.size(); i++) {
+		const FieldDescriptor* field = table.slots[i];
+		if (field == NULL) {
+			printer->Print("    {\"\", 0, 0},\n");
+		} else {
+			printer->Print("    {\"$name$\", $size$, $number$},\n",
+				"name", field->name(),
+				"size", SimpleItoa(static_cast<int>(field->name().size())),
+				"number", SimpleItoa(field->number()));
+		}
+	}
+	printer->Print(
+		"  };\n"
+		"  static const ::google::protobuf::uint32 kSeeds[] = {\n");
+	for (int i = 0; i < table.seeds.size(); i++) {
+		printer->Print("    $seed$u,\n", "seed", SimpleItoa(table.seeds[i]));
+	}
+	printer->Print(vars,
+		"  };\n"
+		"  if (lua_type(L, index) != LUA_TSTRING) return 0;\n"
+		"  size_t size;\n"
+		"  const char* key = lua_tolstring(L, index, &size);\n"
+		"  return ::protobuf_lua::FindField(kSlots, $slot_mask$u, kSeeds, $seed_mask$u, key, size);\n"
+		"}\n"
+		"\n");
+}
+
+// ----------------------------------------------------
+// FileGenerator
+// begin
+void FileGenerator::GenerateLuaArena(io::Printer* printer) {
+	if (options_.lua_arena || options_.lua_pool > 0 || options_.field_counters) {
+		printer->Print(kLuaThreadLocal);
+	}
+	if (options_.lua_arena) {
+		printer->Print(kLuaArena);
+	}
+	if (options_.field_counters) {
+		printer->Print(kFieldCounters);
+	}
+	if (options_.packed_fast_path || options_.table_parser) {
+		printer->Print(kPackedReader);
+	}
+	if (options_.table_parser) {
+		printer->Print(kTableParser);
+	}
+}
+
+void FileGenerator::GenerateLuaRuntime(io::Printer* printer) {
+	if (options_.lua_backend == Options::LUA_BACKEND_CAPI) {
+		printer->Print(
+			"extern \"C\" {\n"
+			"#include <lua.h>\n"
+			"#include <lauxlib.h>\n"
+			"}\n"
+			"\n");
+		PrintLuaRuntime(printer);
+		GenerateLuaCApiRuntime(printer);
+	} else {
+		// Everything using it is behind the same guard.
+		printer->Print("#ifdef LUABIND_API\n");
+		PrintLuaRuntime(printer);
+		printer->Print(kLuaBindRuntime);
+		if (options_.lua_pool > 0) {
+			printer->Print(kLuaBindPoolPtr);
+		}
+		printer->Print("#endif  // LUABIND_API\n");
+	}
+}
+// end
+
+// ----------------------------------------------------
+// MessageGenerator
+// begin
+
+// Acquire() and Recycle(), which keep up to lua_pool cleared instances per
+// thread.  Clear() leaves the capacity of strings, repeated fields and
+// sub-messages in place, so a recycled message is refilled without
+// allocating.  Messages from an arena are not pooled.
+void MessageGenerator::GenerateLuaPool(io::Printer* printer) {
+	if (options_.lua_pool <= 0) return;
+
+	map<string, string> vars;
+	vars["classname"] = classname_;
+	vars["capacity"] = SimpleItoa(options_.lua_pool);
+	printer->Print(vars,
+		"\n"
+		"namespace {\n"
+		"PROTOBUF_LUA_THREAD_LOCAL $classname$* $classname$_lua_pool_[$capacity$];\n"
+		"PROTOBUF_LUA_THREAD_LOCAL int $classname$_lua_pool_size_ = 0;\n"
+		"}  // namespace\n"
+		"\n"
+		"$classname$* $classname$::Acquire() {\n");
+	if (options_.lua_arena) {
+		printer->Print(
+			"  if (::protobuf_lua_arena::Arena::Current() != NULL) return NULL;\n");
+	}
+	printer->Print(vars,
+		"  if ($classname$_lua_pool_size_ == 0) return NULL;\n"
+		"  return $classname$_lua_pool_[--$classname$_lua_pool_size_];\n"
+		"}\n"
+		"\n"
+		"void $classname$::Recycle($classname$* message) {\n"
+		"  if (message == NULL) return;\n");
+	if (options_.lua_arena) {
+		printer->Print(vars,
+			"  if ($classname$_lua_pool_size_ == $capacity$ ||\n"
+			"      ::protobuf_lua_arena::InArena(message)) {\n");
+	} else {
+		printer->Print(vars,
+			"  if ($classname$_lua_pool_size_ == $capacity$) {\n");
+	}
+	printer->Print(vars,
+		"    delete message;\n"
+		"    return;\n"
+		"  }\n"
+		"  message->Clear();\n"
+		"  $classname$_lua_pool_[$classname$_lua_pool_size_++] = message;\n"
+		"}\n");
+}
+
+// $classname$_field_counts(), the calling thread's access counts the inline
+// accessors bump with field_counters.
+void MessageGenerator::GenerateFieldCountsAccessor(io::Printer* printer) {
+	if (!options_.field_counters || descriptor_->field_count() == 0) return;
+
+	printer->Print(
+		"inline ::google::protobuf::uint64* $classname$_field_counts() {\n"
+		"  static PROTOBUF_LUA_THREAD_LOCAL ::google::protobuf::uint64 counts[$size$];\n"
+		"  return counts;\n"
+		"}\n"
+		"\n",
+		"classname", classname_,
+		"size", SimpleItoa(2 * descriptor_->field_count()));
+}
+
+// With field_counters, opens the generated methods that call the field
+// accessors, so that only calls from outside the message are counted.
+void MessageGenerator::GenerateFieldCountsScope(io::Printer* printer) {
+	if (!options_.field_counters || descriptor_->field_count() == 0) return;
+
+	printer->Print(
+		"::protobuf_field_counters::InternalScope field_counters_scope;\n");
+}
+
+// Registers the counters of the message type with protobuf_field_counters.
+void MessageGenerator::GenerateFieldCountsRegistration(io::Printer* printer) {
+	if (!options_.field_counters || descriptor_->field_count() == 0) return;
+
+	map<string, string> vars;
+	vars["classname"] = classname_;
+	vars["field_count"] = SimpleItoa(descriptor_->field_count());
+	printer->Print(vars,
+		"namespace {\n"
+		"\n"
+		"const char* const $classname$_field_names_[] = {\n");
+	for (int i = 0; i < descriptor_->field_count(); i++) {
+		printer->Print(
+			"  \"$full_name$\",\n",
+			"full_name", descriptor_->field(i)->full_name());
+	}
+	printer->Print(vars,
+		"};\n"
+		"::google::protobuf::uint64 $classname$_field_totals_[2 * $field_count$];\n"
+		"::protobuf_field_counters::Type $classname$_field_counters_ = {\n"
+		"  $classname$_field_names_, $field_count$, &$classname$_field_counts,\n"
+		"  $classname$_field_totals_, NULL\n"
+		"};\n"
+		"::protobuf_field_counters::Registrar $classname$_field_counters_registrar_(\n"
+		"  &$classname$_field_counters_);\n"
+		"\n"
+		"}  // namespace\n"
+		"\n");
+}
+
+// ImportFromLua() walks the table once with lua_next() and dispatches every
+// string key through the field name hash; other keys are ignored.  Repeated
+// fields are appended to, with room for the whole sequence reserved up
+// front, and message fields are imported recursively, one |depth| deeper.
+void MessageGenerator::GenerateLuaImport(io::Printer* printer) {
+	vector<const FieldDescriptor*> fields;
+	ListLuaNamedFields(descriptor_, &fields);
+	bool accept_messages = options_.lua_backend == Options::LUA_BACKEND_CAPI;
+
+	printer->Print(
+		"void $classname$::ImportFromLua(lua_State* L, int index, int depth) {\n"
+		"  if (index < 0 && index > LUA_REGISTRYINDEX) index += lua_gettop(L) + 1;\n"
+		"  luaL_checktype(L, index, LUA_TTABLE);\n"
+		"  ::protobuf_lua::CheckNestingDepth(L, depth);\n",
+		"classname", classname_);
+	if (fields.empty()) {
+		printer->Print(
+			"}\n"
+			"\n");
+		return;
+	}
+
+	printer->Print(
+		"  $classname$* message = this;\n"
+		"  luaL_checkstack(L, 4, NULL);\n"
+		"  lua_pushnil(L);\n"
+		"  while (lua_next(L, index) != 0) {\n"
+		"    int top = lua_gettop(L);\n"
+		"    switch ($classname$_lua_FindField(L, top - 1)) {\n",
+		"classname", classname_);
+	printer->Indent();
+	printer->Indent();
+	printer->Indent();
+	for (int i = 0; i < fields.size(); i++) {
+		printer->Print(
+			"case $number$: {\n",
+			"number", SimpleItoa(fields[i]->number()));
+		printer->Indent();
+		PrintLuaAssignField(printer, fields[i], "top", "top + 1", "depth + 1", false,
+			accept_messages);
+		printer->Print(
+			"break;\n");
+		printer->Outdent();
+		printer->Print(
+			"}\n");
+	}
+	printer->Outdent();
+	printer->Outdent();
+	printer->Outdent();
+	printer->Print(
+		"    }\n"
+		"    lua_pop(L, 1);\n"
+		"  }\n"
+		"}\n"
+		"\n");
+}
+
+// DecodeToLua() has the shape of MergePartialFromCodedStream(): a switch on
+// the field number, checking the wire type and guessing the next tag, with
+// every value stored into the table on top of the stack instead of into a
+// message.  A nil there is replaced with a new table, and decoding into an
+// existing one merges as MergeFrom() does: singular fields are overwritten,
+// repeated fields appended to and sub-messages merged in turn.  The
+// sequences of repeated fields are looked up or created up front and kept on
+// the stack for appending.
+void MessageGenerator::GenerateLuaDecoder(io::Printer* printer) {
+	vector<const FieldDescriptor*> fields;
+	ListLuaFieldsByNumber(descriptor_, &fields);
+
+	// Where each repeated field's sequence lives on the stack.
+	map<const FieldDescriptor*, string> sequences;
+	for (int i = 0; i < fields.size(); i++) {
+		if (fields[i]->is_repeated()) {
+			sequences[fields[i]] = "table + " + SimpleItoa(static_cast<int>(sequences.size() + 1));
+		}
+	}
+
+	printer->Print(
+		"bool $classname$::DecodeToLua(lua_State* L, ::google::protobuf::io::CodedInputStream* input) {\n"
+		"#define DO_(EXPRESSION) if (!(EXPRESSION)) return false\n"
+		"  luaL_checkstack(L, $slots$, NULL);\n"
+		"  if (lua_isnil(L, -1)) {\n"
+		"    lua_pop(L, 1);\n"
+		"    lua_createtable(L, 0, $count$);\n"
+		"  }\n"
+		"  int table = lua_gettop(L);\n",
+		"classname", classname_,
+		"slots", SimpleItoa(static_cast<int>(sequences.size() + 3)),
+		"count", SimpleItoa(static_cast<int>(fields.size())));
+	for (int i = 0; i < fields.size(); i++) {
+		if (!fields[i]->is_repeated()) continue;
+		printer->Print(
+			"  int $name$_size = ::protobuf_lua::PushSequence(L, table, \"$name$\");\n",
+			"name", FieldName(fields[i]));
+	}
+	printer->Print(
+		"  ::google::protobuf::uint32 tag;\n"
+		"  while ((tag = input->ReadTag()) != 0) {\n");
+	printer->Indent();
+	printer->Indent();
+
+	if (!fields.empty()) {
+		printer->Print(
+			"switch (::google::protobuf::internal::WireFormatLite::GetTagFieldNumber(tag)) {\n");
+		printer->Indent();
+
+		for (int i = 0; i < fields.size(); i++) {
+			const FieldDescriptor* field = fields[i];
+			bool packed = field->options().packed();
+
+			printer->Print(
+				"case $number$: {\n",
+				"number", SimpleItoa(field->number()));
+			printer->Indent();
+
+			printer->Print(
+				"if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag) ==\n"
+				"    ::google::protobuf::internal::WireFormatLite::WIRETYPE_$wiretype$) {\n",
+				"wiretype", kWireTypeNames[WireFormat::WireTypeForField(field)]);
+			if (i > 0 || (field->is_repeated() && !packed)) {
+				printer->Print(
+					" parse_$name$:\n",
+					"name", field->name());
+			}
+			printer->Indent();
+			if (packed) {
+				PrintLuaDecodePacked(printer, field, sequences[field]);
+			} else {
+				PrintLuaDecodeField(printer, field, sequences[field]);
+			}
+			printer->Outdent();
+
+			// Accept unexpectedly packed or unpacked values.
+			if (field->is_packable()) {
+				printer->Print(
+					"} else if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag)\n"
+					"           == ::google::protobuf::internal::WireFormatLite::\n"
+					"              WIRETYPE_$wiretype$) {\n",
+					"wiretype", packed ?
+						kWireTypeNames[WireFormat::WireTypeForFieldType(field->type())] :
+						"LENGTH_DELIMITED");
+				printer->Indent();
+				if (packed) {
+					PrintLuaDecodeField(printer, field, sequences[field]);
+				} else {
+					PrintLuaDecodePacked(printer, field, sequences[field]);
+				}
+				printer->Outdent();
+			}
+
+			printer->Print(
+				"} else {\n"
+				"  goto handle_uninterpreted;\n"
+				"}\n");
+
+			if (field->is_repeated() && !packed) {
+				printer->Print(
+					"if (input->ExpectTag($tag$)) goto parse_$name$;\n",
+					"tag", SimpleItoa(WireFormat::MakeTag(field)),
+					"name", field->name());
+			}
+			if (i + 1 < fields.size()) {
+				printer->Print(
+					"if (input->ExpectTag($next_tag$)) goto parse_$next_name$;\n",
+					"next_tag", SimpleItoa(WireFormat::MakeTag(fields[i + 1])),
+					"next_name", fields[i + 1]->name());
+			}
+			printer->Print(
+				"break;\n");
+
+			printer->Outdent();
+			printer->Print("}\n\n");
+		}
+
+		printer->Print(
+			"default: {\n"
+			"handle_uninterpreted:\n");
+		printer->Indent();
+	}
+
+	printer->Print(
+		"if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag) ==\n"
+		"    ::google::protobuf::internal::WireFormatLite::WIRETYPE_END_GROUP) {\n"
+		"  lua_settop(L, table);\n"
+		"  return true;\n"
+		"}\n"
+		"DO_(::google::protobuf::internal::WireFormatLite::SkipField(input, tag));\n");
+
+	if (!fields.empty()) {
+		printer->Print(
+			"break;\n");
+		printer->Outdent();
+		printer->Print(
+			"}\n");
+		printer->Outdent();
+		printer->Print(
+			"}\n");
+	}
+
+	printer->Outdent();
+	printer->Outdent();
+	printer->Print(
+		"  }\n"
+		"  lua_settop(L, table);\n"
+		"  return true;\n"
+		"#undef DO_\n"
+		"}\n"
+		"\n");
+}
+
+// EncodeFromLua() writes the fields of a table in the order and with the
+// tags SerializeWithCachedSizesToArray() uses, into a buffer sized by
+// ByteSizeFromLua().  ByteSizeFromLua() also checks the table and its
+// nesting depth, so that EncodeFromLua() can convert values without checking
+// them again, and records the sizes of sub-messages and packed fields in the
+// size cache at stack slot |cache|, where EncodeFromLua() finds them in the
+// same order.
+void MessageGenerator::GenerateLuaEncoder(io::Printer* printer) {
+	vector<const FieldDescriptor*> fields;
+	ListLuaFieldsByNumber(descriptor_, &fields);
+
+	printer->Print(
+		"int $classname$::ByteSizeFromLua(lua_State* L, int index, int cache, int depth) {\n"
+		"  ::protobuf_lua::CheckNestingDepth(L, depth);\n"
+		"  int total_size = 0;\n"
+		"  luaL_checkstack(L, 3, NULL);\n",
+		"classname", classname_);
+	printer->Indent();
+	for (int i = 0; i < fields.size(); i++) {
+		const FieldDescriptor* field = fields[i];
+		map<string, string> vars;
+		SetCommonFieldVariables(field, &vars);
+
+		printer->Print(vars,
+			"lua_pushliteral(L, \"$name$\");\n"
+			"lua_rawget(L, index);\n"
+			"if (!lua_isnil(L, -1)) {\n");
+		printer->Indent();
+		if (!field->is_repeated()) {
+			PrintLuaSizeValue(printer, field, "total_size", false);
+		} else {
+			bool packed = field->options().packed();
+			printer->Print(
+				"luaL_checktype(L, -1, LUA_TTABLE);\n"
+				"int count = static_cast<int>(PROTOBUF_LUA_RAWLEN(L, -1));\n");
+			if (packed) {
+				printer->Print(
+					"int data_size = 0;\n");
+			}
+			printer->Print(
+				"for (int i = 1; i <= count; i++) {\n"
+				"  lua_rawgeti(L, -1, i);\n");
+			printer->Indent();
+			PrintLuaSizeValue(printer, field, packed ? "data_size" : "total_size", packed);
+			printer->Outdent();
+			printer->Print(
+				"  lua_pop(L, 1);\n"
+				"}\n");
+			if (packed) {
+				printer->Print(vars,
+					"if (count > 0) {\n"
+					"  ::protobuf_lua::SetSize(L, cache, ::protobuf_lua::ReserveSize(L, cache), data_size);\n"
+					"  total_size += $tag_size$ +\n"
+					"    ::google::protobuf::io::CodedOutputStream::VarintSize32(data_size) + data_size;\n"
+					"}\n");
+			}
+		}
+		printer->Outdent();
+		printer->Print(
+			"}\n"
+			"lua_pop(L, 1);\n");
+	}
+	printer->Outdent();
+	printer->Print(
+		"  return total_size;\n"
+		"}\n"
+		"\n");
+
+	printer->Print(
+		"::google::protobuf::uint8* $classname$::EncodeFromLua(lua_State* L, int index,\n"
+		"    const int** sizes, ::google::protobuf::uint8* target) {\n"
+		"  luaL_checkstack(L, 3, NULL);\n",
+		"classname", classname_);
+	printer->Indent();
+	for (int i = 0; i < fields.size(); i++) {
+		const FieldDescriptor* field = fields[i];
+		map<string, string> vars;
+		SetCommonFieldVariables(field, &vars);
+		vars["tag"] = SimpleItoa(WireFormat::MakeTag(field));
+
+		printer->Print(vars,
+			"lua_pushliteral(L, \"$name$\");\n"
+			"lua_rawget(L, index);\n"
+			"if (!lua_isnil(L, -1)) {\n");
+		printer->Indent();
+		if (!field->is_repeated()) {
+			PrintLuaEncodeValue(printer, field, false);
+		} else {
+			bool packed = field->options().packed();
+			printer->Print(
+				"int count = static_cast<int>(PROTOBUF_LUA_RAWLEN(L, -1));\n");
+			if (packed) {
+				printer->Print(vars,
+					"if (count > 0) {\n"
+					"  target = ::google::protobuf::io::CodedOutputStream::WriteTagToArray($tag$, target);\n"
+					"  target = ::google::protobuf::io::CodedOutputStream::WriteVarint32ToArray(\n"
+					"    static_cast< ::google::protobuf::uint32>(*(*sizes)++), target);\n"
+					"}\n");
+			}
+			printer->Print(
+				"for (int i = 1; i <= count; i++) {\n"
+				"  lua_rawgeti(L, -1, i);\n");
+			printer->Indent();
+			PrintLuaEncodeValue(printer, field, packed);
+			printer->Outdent();
+			printer->Print(
+				"  lua_pop(L, 1);\n"
+				"}\n");
+		}
+		printer->Outdent();
+		printer->Print(
+			"}\n"
+			"lua_pop(L, 1);\n");
+	}
+	printer->Outdent();
+	printer->Print(
+		"  return target;\n"
+		"}\n"
+		"\n");
+}
+
+// ToTable() pushes a new table holding the fields that are set, with every
+// repeated field as a sequence (empty or not) and sub-messages converted
+// recursively.  Tables are created at their final size, and keys are pushed
+// as literals and stored with lua_rawset(), so that nothing is rehashed and
+// no key goes through strlen().
+void MessageGenerator::GenerateLuaToTable(io::Printer* printer) {
+	vector<const FieldDescriptor*> fields;
+	ListLuaNamedFields(descriptor_, &fields);
+
+	printer->Print(
+		"void $classname$::ToTable(lua_State* L) const {\n"
+		"  luaL_checkstack(L, 4, NULL);\n"
+		"  lua_createtable(L, 0, $count$);\n",
+		"classname", classname_,
+		"count", SimpleItoa(static_cast<int>(fields.size())));
+	printer->Indent();
+
+	for (int i = 0; i < fields.size(); i++) {
+		const FieldDescriptor* field = fields[i];
+		map<string, string> vars;
+		SetCommonFieldVariables(field, &vars);
+
+		if (!field->is_repeated()) {
+			printer->Print(vars,
+				"if (has_$name$()) {\n"
+				"  lua_pushliteral(L, \"$name$\");\n");
+			printer->Indent();
+			if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+				printer->Print(vars,
+					"$name$().ToTable(L);\n");
+			} else {
+				PrintLuaPush(printer, field, vars["name"] + "()");
+			}
+			printer->Outdent();
+			printer->Print(
+				"  lua_rawset(L, -3);\n"
+				"}\n");
+			continue;
+		}
+
+		printer->Print(vars,
+			"{\n"
+			"  int size = $name$_size();\n"
+			"  lua_pushliteral(L, \"$name$\");\n"
+			"  lua_createtable(L, size, 0);\n"
+			"  for (int i = 0; i < size; i++) {\n");
+		printer->Indent();
+		printer->Indent();
+		if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+			printer->Print(vars,
+				"$name$(i).ToTable(L);\n");
+		} else {
+			PrintLuaPush(printer, field, vars["name"] + "(i)");
+		}
+		printer->Outdent();
+		printer->Outdent();
+		printer->Print(
+			"    lua_rawseti(L, -2, i + 1);\n"
+			"  }\n"
+			"  lua_rawset(L, -3);\n"
+			"}\n");
+	}
+
+	printer->Outdent();
+	printer->Print(
+		"}\n"
+		"\n");
+}
+// end
+
+}  // namespace cpp
+}  // namespace compiler
+}  // namespace protobuf
+
+}  // namespace google
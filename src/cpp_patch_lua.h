@@ -0,0 +1,80 @@
+#ifndef GOOGLE_PROTOBUF_PATCH_CPP_LUA_H__
+#define GOOGLE_PROTOBUF_PATCH_CPP_LUA_H__
+
+#include <string>
+#include <vector>
+
+#include <google/protobuf/stubs/common.h>
+
+// Code generation shared by the luabind and capi backends wherever the
+// generated code talks to the Lua C API directly.
+
+namespace google {
+namespace protobuf {
+
+class Descriptor;
+class FieldDescriptor;
+
+namespace io {
+class Printer;
+}
+
+namespace compiler {
+namespace cpp {
+
+// Prints the helpers all of the code below relies on.  They go into an
+// unnamed namespace at global scope, after lua.h has been included.
+void PrintLuaRuntime(io::Printer* printer);
+
+// Prints LuaLazyType and InstallLuaLazyTypes(), which common.pb.h uses with
+// lua_lazy.  They go into namespace google::protobuf, after lua.h has been
+// included.
+void PrintLuaLazyRuntime(io::Printer* printer);
+
+// Prints code pushing |value|, a C++ expression of |field|'s type.
+void PrintLuaPush(io::Printer* printer, const FieldDescriptor* field,
+	const string& value);
+
+// Prints code converting stack slot |index| to |field|'s type, raising a Lua
+// error if it does not fit.  Returns the arguments to pass to the field's
+// setter (strings are passed as data and size).
+string PrintLuaCheck(io::Printer* printer, const FieldDescriptor* field,
+	const string& index);
+
+// Prints code storing the Lua value at stack slot |value| into |field| of
+// |message|.  A repeated field takes a sequence and uses slot |item| for its
+// elements; it is appended to unless |replace| is set.  A message field
+// takes a table, which is imported at nesting depth |depth|, or with
+// |accept_messages| also a message of the field's type, which is copied.
+void PrintLuaAssignField(io::Printer* printer, const FieldDescriptor* field,
+	const string& value, const string& item, const string& depth, bool replace,
+	bool accept_messages);
+
+// Prints two helpers for the bulk accessors of |field|, a repeated numeric,
+// bool or enum field: "<classname>_lua_Push_<name>(L, message, first, count)"
+// pushes a range of elements as a sequence, and
+// "<classname>_lua_Store_<name>(L, message, index, first)" stores the
+// sequence at stack slot |index| from element |first| on.  Enum values are
+// checked against the enum's _IsValid() as they are converted.
+void PrintLuaRepeatedBulkHelpers(io::Printer* printer,
+	const FieldDescriptor* field);
+
+// Fills |fields| with the fields of |descriptor| that Lua can refer to by
+// name.  Strings with an unknown ctype have private accessors and are left
+// out.
+void ListLuaNamedFields(const Descriptor* descriptor,
+	vector<const FieldDescriptor*>* fields);
+
+// Prints "static int <classname>_lua_FindField(lua_State* L, int index)",
+// which maps the field name at stack slot |index| to the field's number, or
+// to 0 for anything else.  The names are looked up in a perfect hash built
+// here, so that a lookup costs two hashes of the key and one compare.
+void PrintLuaFieldLookup(io::Printer* printer, const string& classname,
+	const vector<const FieldDescriptor*>& fields);
+
+}  // namespace cpp
+}  // namespace compiler
+}  // namespace protobuf
+}  // namespace google
+
+#endif  // GOOGLE_PROTOBUF_PATCH_CPP_LUA_H__
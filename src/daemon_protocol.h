@@ -0,0 +1,154 @@
+#ifndef GOOGLE_PROTOBUF_PATCH_DAEMON_PROTOCOL_H__
+#define GOOGLE_PROTOBUF_PATCH_DAEMON_PROTOCOL_H__
+
+// Framing shared by "protoc-gen-luabind --daemon" and protoc-gen-luabind-shim.
+// The shim sends two frames, its working directory and then the serialized
+// CodeGeneratorRequest it got from protoc, and the daemon answers with one
+// frame holding the serialized CodeGeneratorResponse.  The daemon resolves
+// relative paths in the generator parameter against the shim's directory,
+// where protoc runs, rather than its own.  A frame is a 4-byte little-endian
+// length followed by that many bytes.
+//
+// Each side checks that the other runs as the same user before trusting it
+// with a request or a response.
+//
+// Kept free of protobuf so that the shim stays a tiny executable with nothing
+// to initialise.
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+
+namespace google {
+namespace protobuf {
+namespace compiler {
+
+// Frames larger than this are treated as corrupt.
+static const size_t kMaxDaemonFrameSize = 512 << 20;
+
+inline bool ReadFully(int fd, char* data, size_t size) {
+	while (size > 0) {
+		ssize_t n = read(fd, data, size);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return false;
+		data += n;
+		size -= n;
+	}
+	return true;
+}
+
+inline bool WriteFully(int fd, const char* data, size_t size) {
+	while (size > 0) {
+		ssize_t n = write(fd, data, size);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return false;
+		data += n;
+		size -= n;
+	}
+	return true;
+}
+
+inline bool ReadFrame(int fd, std::string* data) {
+	unsigned char header[4];
+	if (!ReadFully(fd, reinterpret_cast<char*>(header), sizeof(header))) {
+		return false;
+	}
+	size_t size = header[0] | (header[1] << 8) | (header[2] << 16) |
+		(static_cast<size_t>(header[3]) << 24);
+	if (size > kMaxDaemonFrameSize) return false;
+
+	data->resize(size);
+	return size == 0 || ReadFully(fd, &(*data)[0], size);
+}
+
+inline bool WriteFrame(int fd, const std::string& data) {
+	if (data.size() > kMaxDaemonFrameSize) return false;
+	unsigned char header[4] = {
+		static_cast<unsigned char>(data.size()),
+		static_cast<unsigned char>(data.size() >> 8),
+		static_cast<unsigned char>(data.size() >> 16),
+		static_cast<unsigned char>(data.size() >> 24),
+	};
+	return WriteFully(fd, reinterpret_cast<const char*>(header), sizeof(header)) &&
+		WriteFully(fd, data.data(), data.size());
+}
+
+// protoc-gen-luabind.sock in $XDG_RUNTIME_DIR, or else daemon.sock in
+// /tmp/protoc-gen-luabind-<uid>.  Both directories are private to the user;
+// see CheckPrivateDirectory().
+inline std::string BuiltinDaemonSocketPath() {
+	const char* runtime_dir = getenv("XDG_RUNTIME_DIR");
+	if (runtime_dir != NULL && *runtime_dir == '/') {
+		return std::string(runtime_dir) + "/protoc-gen-luabind.sock";
+	}
+
+	char buffer[64];
+	snprintf(buffer, sizeof(buffer), "/tmp/protoc-gen-luabind-%u/daemon.sock",
+		static_cast<unsigned>(geteuid()));
+	return buffer;
+}
+
+// $PROTOC_GEN_LUABIND_SOCKET if set, otherwise BuiltinDaemonSocketPath().
+inline std::string DefaultDaemonSocketPath() {
+	const char* path = getenv("PROTOC_GEN_LUABIND_SOCKET");
+	if (path != NULL && *path != '\0') return path;
+	return BuiltinDaemonSocketPath();
+}
+
+// Fails unless the directory holding |socket_path| is a real directory that
+// belongs to this user and nobody else may enter, so that no other user can
+// put their own socket in the daemon's place.  With |create| set, a missing
+// directory is created with mode 0700 first.
+inline bool CheckPrivateDirectory(const std::string& socket_path, bool create,
+		std::string* error) {
+	std::string directory = socket_path.substr(0, socket_path.rfind('/'));
+	if (directory.empty()) directory = "/";
+
+	struct stat info;
+	if (lstat(directory.c_str(), &info) != 0 && errno == ENOENT && create) {
+		mkdir(directory.c_str(), 0700);
+	}
+	if (lstat(directory.c_str(), &info) != 0) {
+		*error = directory + ": " + strerror(errno);
+		return false;
+	}
+	if (!S_ISDIR(info.st_mode) || info.st_uid != geteuid() ||
+			(info.st_mode & (S_IRWXG | S_IRWXO)) != 0) {
+		*error = directory + " is not a directory private to this user.";
+		return false;
+	}
+	return true;
+}
+
+// Whether the process at the other end of the unix socket |fd| runs as this
+// user.
+inline bool PeerIsSameUser(int fd) {
+#ifdef SO_PEERCRED
+	struct ucred credentials;
+	socklen_t size = sizeof(credentials);
+	if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &size) != 0) {
+		return false;
+	}
+	return credentials.uid == geteuid();
+#else
+	uid_t uid;
+	gid_t gid;
+	if (getpeereid(fd, &uid, &gid) != 0) return false;
+	return uid == geteuid();
+#endif
+}
+
+}  // namespace compiler
+}  // namespace protobuf
+}  // namespace google
+
+#endif  // !_WIN32
+
+#endif  // GOOGLE_PROTOBUF_PATCH_DAEMON_PROTOCOL_H__
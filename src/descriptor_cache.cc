@@ -0,0 +1,334 @@
+#include "descriptor_cache.h"
+
+#include <set>
+
+#include <google/protobuf/compiler/plugin.pb.h>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/descriptor.pb.h>
+
+namespace google {
+namespace protobuf {
+namespace compiler {
+
+namespace {
+
+// Cached files that were not part of this many consecutive requests are
+// dropped, together with their pool once nothing else uses it.
+const int kMaxIdleRequests = 32;
+
+class StringErrorCollector : public DescriptorPool::ErrorCollector {
+public:
+	explicit StringErrorCollector(string* error) : error_(error) {}
+
+	void AddError(const string& filename, const string& element_name,
+			const Message* descriptor, ErrorLocation location,
+			const string& message) {
+		if (!error_->empty()) error_->append("\n");
+		error_->append(filename + ": " + element_name + ": " + message);
+	}
+
+private:
+	string* error_;
+};
+
+// Builds the files of |request| listed in |names| into |pool|, in the order
+// protoc sent them, which puts every import before the files using it.
+bool BuildFiles(DescriptorPool* pool, const CodeGeneratorRequest& request,
+		const set<string>& names, string* error) {
+	StringErrorCollector collector(error);
+	for (int i = 0; i < request.proto_file_size(); i++) {
+		const FileDescriptorProto& proto = request.proto_file(i);
+		if (names.count(proto.name()) == 0) continue;
+		if (pool->BuildFileCollectingErrors(proto, &collector) == NULL) {
+			return false;
+		}
+	}
+	return true;
+}
+
+}  // namespace
+
+string Fingerprint(const string& data) {
+	uint64 hash = GOOGLE_ULONGLONG(14695981039346656037);
+	for (int i = 0; i < data.size(); i++) {
+		hash ^= static_cast<uint8>(data[i]);
+		hash *= GOOGLE_ULONGLONG(1099511628211);
+	}
+
+	static const char kHexDigits[] = "0123456789abcdef";
+	string result(16, '0');
+	for (int i = 15; i >= 0; i--) {
+		result[i] = kHexDigits[hash & 0xf];
+		hash >>= 4;
+	}
+	return result;
+}
+
+bool ComputeFileKeys(const CodeGeneratorRequest& request,
+		map<string, string>* keys, map<string, string>* materials, string* error) {
+	for (int i = 0; i < request.proto_file_size(); i++) {
+		const FileDescriptorProto& proto = request.proto_file(i);
+
+		string data;
+		proto.SerializeToString(&data);
+		for (int j = 0; j < proto.dependency_size(); j++) {
+			map<string, string>::const_iterator dependency =
+				keys->find(proto.dependency(j));
+			if (dependency == keys->end()) {
+				*error = proto.name() + ": protoc did not send dependency " +
+					proto.dependency(j) + " before the file importing it.";
+				return false;
+			}
+			data.push_back('\0');
+			data.append(dependency->second);
+		}
+
+		(*keys)[proto.name()] = Fingerprint(data);
+		if (materials != NULL) {
+			(*materials)[proto.name()].swap(data);
+		}
+	}
+	return true;
+}
+
+DescriptorCache::DescriptorCache() : generation_(0) {}
+
+DescriptorCache::~DescriptorCache() {
+	// Overlays go before the pools they are layered over.
+	while (!pools_.empty()) {
+		set<const DescriptorPool*> underlays;
+		for (map<const DescriptorPool*, CachedPool>::iterator it = pools_.begin();
+				it != pools_.end(); ++it) {
+			underlays.insert(it->second.underlay);
+		}
+		map<const DescriptorPool*, CachedPool>::iterator it = pools_.begin();
+		while (it != pools_.end()) {
+			if (underlays.count(it->first) == 0) {
+				delete it->first;
+				pools_.erase(it++);
+			} else {
+				++it;
+			}
+		}
+	}
+}
+
+bool DescriptorCache::Acquire(const CodeGeneratorRequest& request,
+		vector<const FileDescriptor*>* parsed_files, string* error) {
+	map<string, string> keys;
+	if (!ComputeFileKeys(request, &keys, NULL, error)) {
+		return false;
+	}
+	for (int i = 0; i < request.file_to_generate_size(); i++) {
+		const string& name = request.file_to_generate(i);
+		if (keys.count(name) == 0) {
+			*error = "protoc asked plugin to generate a file but "
+				"did not provide a descriptor for the file: " + name;
+			return false;
+		}
+	}
+
+	// Lease the targets we have already built and plan a pool for the rest.
+	parsed_files->assign(request.file_to_generate_size(), NULL);
+	vector<string> missed;
+	const DescriptorPool* underlay = NULL;
+	set<string> names;
+	{
+		MutexLock lock(&mutex_);
+		++generation_;
+
+		// Everything this request mentions counts as used, so that imports
+		// which become targets later on are still around.
+		set<const DescriptorPool*> candidates;
+		for (map<string, string>::iterator it = keys.begin(); it != keys.end(); ++it) {
+			map<string, CachedFile>::iterator cached = files_.find(it->second);
+			if (cached != files_.end()) {
+				cached->second.last_used = generation_;
+				candidates.insert(cached->second.file->pool());
+			}
+		}
+
+		for (int i = 0; i < request.file_to_generate_size(); i++) {
+			const string& name = request.file_to_generate(i);
+			map<string, CachedFile>::iterator cached = files_.find(keys[name]);
+			if (cached != files_.end()) {
+				(*parsed_files)[i] = cached->second.file;
+				Ref(cached->second.file->pool());
+			} else {
+				missed.push_back(name);
+			}
+		}
+
+		if (missed.empty()) {
+			Evict();
+			return true;
+		}
+
+		// Layer over whichever pool holding part of this request leaves the
+		// fewest files to build; a fresh pool is the fallback.
+		PlanBuild(NULL, request, keys, missed, &names);
+		for (set<const DescriptorPool*>::iterator it = candidates.begin();
+				it != candidates.end(); ++it) {
+			set<string> layered_names;
+			PlanBuild(*it, request, keys, missed, &layered_names);
+			if (layered_names.size() < names.size()) {
+				underlay = *it;
+				names.swap(layered_names);
+			}
+		}
+		if (underlay != NULL) {
+			Ref(underlay);
+		}
+	}
+
+	// Build without the lock, so that other requests are not held up.  A
+	// file may still clash with a symbol some unrelated file left in the
+	// underlay, so a layered build that fails is retried in a fresh pool,
+	// which also reports the errors a one-shot run would.
+	DescriptorPool* pool = NULL;
+	bool built = true;
+	if (!names.empty()) {
+		pool = underlay != NULL ? new DescriptorPool(underlay) : new DescriptorPool;
+		built = BuildFiles(pool, request, names, error);
+		if (!built && underlay != NULL) {
+			delete pool;
+			error->clear();
+			names.clear();
+			PlanBuild(NULL, request, keys, missed, &names);
+			pool = new DescriptorPool;
+			built = BuildFiles(pool, request, names, error);
+			MutexLock lock(&mutex_);
+			Unref(underlay);
+			underlay = NULL;
+		}
+	}
+
+	MutexLock lock(&mutex_);
+	if (!built) {
+		delete pool;
+		for (int i = 0; i < parsed_files->size(); i++) {
+			if ((*parsed_files)[i] != NULL) {
+				Unref((*parsed_files)[i]->pool());
+			}
+		}
+		if (underlay != NULL) {
+			Unref(underlay);
+		}
+		parsed_files->clear();
+		return false;
+	}
+
+	// The lease on |underlay| becomes the new pool's reference to it.
+	const DescriptorPool* target_pool = underlay;
+	if (pool != NULL) {
+		CachedPool& cached_pool = pools_[pool];
+		cached_pool.underlay = underlay;
+		for (set<string>::iterator it = names.begin(); it != names.end(); ++it) {
+			const string& key = keys[*it];
+			cached_pool.keys[*it] = key;
+			if (files_.count(key) == 0) {
+				CachedFile& cached = files_[key];
+				cached.file = pool->FindFileByName(*it);
+				cached.last_used = generation_;
+				Ref(pool);
+			}
+		}
+		target_pool = pool;
+	}
+
+	for (int i = 0; i < request.file_to_generate_size(); i++) {
+		if ((*parsed_files)[i] == NULL) {
+			const FileDescriptor* file =
+				target_pool->FindFileByName(request.file_to_generate(i));
+			Ref(file->pool());
+			(*parsed_files)[i] = file;
+		}
+	}
+	if (pool == NULL) {
+		Unref(underlay);
+	}
+
+	Evict();
+	return true;
+}
+
+void DescriptorCache::Release(const vector<const FileDescriptor*>& parsed_files) {
+	MutexLock lock(&mutex_);
+	for (int i = 0; i < parsed_files.size(); i++) {
+		Unref(parsed_files[i]->pool());
+	}
+}
+
+string DescriptorCache::ResolvedKey(const DescriptorPool* pool,
+		const string& name) const {
+	while (pool != NULL) {
+		map<const DescriptorPool*, CachedPool>::const_iterator it = pools_.find(pool);
+		GOOGLE_CHECK(it != pools_.end());
+		map<string, string>::const_iterator key = it->second.keys.find(name);
+		if (key != it->second.keys.end()) {
+			return key->second;
+		}
+		pool = it->second.underlay;
+	}
+	return "";
+}
+
+void DescriptorCache::PlanBuild(const DescriptorPool* underlay,
+		const CodeGeneratorRequest& request, const map<string, string>& keys,
+		const vector<string>& targets, set<string>* names) const {
+	map<string, int> index;
+	for (int i = 0; i < request.proto_file_size(); i++) {
+		index[request.proto_file(i).name()] = i;
+	}
+
+	set<string> visited;
+	vector<string> pending(targets);
+	while (!pending.empty()) {
+		string name = pending.back();
+		pending.pop_back();
+		if (!visited.insert(name).second) continue;
+
+		// Stop at imports the underlay already resolves to the right version.
+		if (ResolvedKey(underlay, name) == keys.find(name)->second) continue;
+
+		names->insert(name);
+		const FileDescriptorProto& proto = request.proto_file(index[name]);
+		for (int j = 0; j < proto.dependency_size(); j++) {
+			pending.push_back(proto.dependency(j));
+		}
+	}
+}
+
+void DescriptorCache::Ref(const DescriptorPool* pool) {
+	++pools_[pool].refs;
+}
+
+void DescriptorCache::Unref(const DescriptorPool* pool) {
+	while (pool != NULL) {
+		map<const DescriptorPool*, CachedPool>::iterator it = pools_.find(pool);
+		GOOGLE_CHECK(it != pools_.end());
+		if (--it->second.refs > 0) return;
+
+		// Dropping the last reference to a pool releases its underlay too.
+		pool = it->second.underlay;
+		delete it->first;
+		pools_.erase(it);
+	}
+}
+
+void DescriptorCache::Evict() {
+	map<string, CachedFile>::iterator it = files_.begin();
+	while (it != files_.end()) {
+		if (generation_ - it->second.last_used > kMaxIdleRequests) {
+			const DescriptorPool* pool = it->second.file->pool();
+			files_.erase(it++);
+			Unref(pool);
+		} else {
+			++it;
+		}
+	}
+}
+
+}  // namespace compiler
+}  // namespace protobuf
+}  // namespace google
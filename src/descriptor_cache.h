@@ -0,0 +1,100 @@
+#ifndef GOOGLE_PROTOBUF_PATCH_DESCRIPTOR_CACHE_H__
+#define GOOGLE_PROTOBUF_PATCH_DESCRIPTOR_CACHE_H__
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <google/protobuf/stubs/common.h>
+
+namespace google {
+namespace protobuf {
+
+class DescriptorPool;
+class FileDescriptor;
+
+namespace compiler {
+
+class CodeGeneratorRequest;
+
+// 64-bit FNV-1a of |data| as 16 lowercase hex digits.
+string Fingerprint(const string& data);
+
+// Maps every file in |request| to a key covering its serialized
+// FileDescriptorProto and, transitively, the keys of everything it imports,
+// so equal keys always build equal descriptors.  If |materials| is not NULL
+// it receives the exact bytes each key was computed from.  Relies on protoc
+// listing dependencies before the files that use them.
+bool ComputeFileKeys(const CodeGeneratorRequest& request,
+	map<string, string>* keys, map<string, string>* materials, string* error);
+
+// Keeps built FileDescriptors alive across the requests served by one
+// daemon process.  A target whose key has been seen recently reuses the
+// descriptor from the pool that built it first.  The files that missed are
+// built in a new pool layered over a cached one that already resolves their
+// unchanged imports, so a miss only costs as much as what changed.  The
+// generator never looks symbols up by name, so old versions still visible
+// through the underlay cannot leak into its output.  Pools are built
+// without holding the lock, which only guards the lookup and the publish.
+// Thread-safe.
+class DescriptorCache {
+public:
+	DescriptorCache();
+	~DescriptorCache();
+
+	// Resolves request.file_to_generate() into |parsed_files|, building a
+	// new pool only for the files (and the imports) that missed.  The
+	// descriptors stay valid until they are handed back to Release().
+	bool Acquire(const CodeGeneratorRequest& request,
+		vector<const FileDescriptor*>* parsed_files, string* error);
+	void Release(const vector<const FileDescriptor*>& parsed_files);
+
+private:
+	struct CachedFile {
+		const FileDescriptor* file;
+		int last_used;
+	};
+
+	// |keys| maps the name of each file built in the pool itself to its key;
+	// files resolved through |underlay| are not listed.
+	struct CachedPool {
+		CachedPool() : refs(0), underlay(NULL) {}
+
+		int refs;
+		const DescriptorPool* underlay;
+		map<string, string> keys;
+	};
+
+	// Returns the key of the version of |name| that |pool| resolves, looking
+	// through its underlays, or the empty string if it resolves none.
+	string ResolvedKey(const DescriptorPool* pool, const string& name) const;
+
+	// Collects into |names| the files a pool layered over |underlay| (or a
+	// fresh one, if it is NULL) has to build so that |targets| resolve with
+	// the versions in |keys|.  A file the underlay holds in another version
+	// is built again; the new pool's own files shadow the underlay's.
+	void PlanBuild(const DescriptorPool* underlay,
+		const CodeGeneratorRequest& request, const map<string, string>& keys,
+		const vector<string>& targets, set<string>* names) const;
+
+	// Each pool is referenced once per cached file it built, once per leased
+	// descriptor and once per pool layered over it; it is deleted when the
+	// count drops to zero.
+	void Ref(const DescriptorPool* pool);
+	void Unref(const DescriptorPool* pool);
+	void Evict();
+
+	Mutex mutex_;
+	int generation_;
+	map<string, CachedFile> files_;
+	map<const DescriptorPool*, CachedPool> pools_;
+
+	GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(DescriptorCache);
+};
+
+}  // namespace compiler
+}  // namespace protobuf
+}  // namespace google
+
+#endif  // GOOGLE_PROTOBUF_PATCH_DESCRIPTOR_CACHE_H__
@@ -0,0 +1,154 @@
+#include "generation_cache.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#define getpid _getpid
+#else
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+#include <google/protobuf/compiler/plugin.pb.h>
+#include <google/protobuf/stubs/strutil.h>
+
+#include "descriptor_cache.h"
+
+namespace google {
+namespace protobuf {
+namespace compiler {
+
+namespace {
+
+// Bump whenever the entry layout changes.
+const char kEntryMagic[] = "protoc-gen-luabind cache 1\n";
+
+// Leads the key material of every entry, so that entries written by another
+// build of the plugin are misses.  Bump whenever the generated code changes.
+const char kGeneratorVersion[] = "protoc-gen-luabind 1";
+
+bool ReadFile(const string& path, string* data) {
+	FILE* file = fopen(path.c_str(), "rb");
+	if (file == NULL) return false;
+
+	data->clear();
+	char buffer[8192];
+	size_t n;
+	while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		data->append(buffer, n);
+	}
+	bool ok = !ferror(file);
+	fclose(file);
+	return ok;
+}
+
+bool WriteFile(const string& path, const string& data) {
+	FILE* file = fopen(path.c_str(), "wb");
+	if (file == NULL) return false;
+
+	bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+	return fclose(file) == 0 && ok;
+}
+
+}  // namespace
+
+GenerationCache::GenerationCache(const string& directory)
+	: directory_(directory),
+	next_temporary_(0) {
+	// Only the last component is created; a missing parent is most likely a
+	// typo that should not be papered over.
+#ifdef _WIN32
+	_mkdir(directory_.c_str());
+#else
+	mkdir(directory_.c_str(), 0777);
+#endif
+}
+
+GenerationCache::~GenerationCache() {}
+
+string GenerationCache::KeyMaterial(const string& parameter,
+		const string& file_material) {
+	string material = kGeneratorVersion;
+	material.push_back(' ');
+	material.append(SimpleItoa(GOOGLE_PROTOBUF_VERSION));
+	material.push_back('\0');
+	material.append(parameter);
+	material.push_back('\0');
+	material.append(file_material);
+	return material;
+}
+
+string GenerationCache::EntryPath(const string& material) const {
+	return directory_ + "/" + Fingerprint(material) + ".pbcache";
+}
+
+bool GenerationCache::Lookup(const string& material,
+		CodeGeneratorResponse* response) const {
+	// A miss must not leave a partially parsed entry behind.
+	response->Clear();
+
+	string data;
+	if (!ReadFile(EntryPath(material), &data)) {
+		return false;
+	}
+
+	// magic, material size, '\n', material, serialized CodeGeneratorResponse
+	const int magic_size = sizeof(kEntryMagic) - 1;
+	if (data.compare(0, magic_size, kEntryMagic) != 0) {
+		return false;
+	}
+	string::size_type newline = data.find('\n', magic_size);
+	if (newline == string::npos) {
+		return false;
+	}
+	string size_text = data.substr(magic_size, newline - magic_size);
+	string::size_type material_size = strtoul(size_text.c_str(), NULL, 10);
+	if (size_text != SimpleItoa(static_cast<uint64>(material_size)) ||
+			data.size() - (newline + 1) < material_size ||
+			data.compare(newline + 1, material_size, material) != 0) {
+		return false;
+	}
+
+	string::size_type body = newline + 1 + material_size;
+	if (!response->ParseFromArray(data.data() + body, data.size() - body)) {
+		response->Clear();
+		return false;
+	}
+	return true;
+}
+
+void GenerationCache::Store(const string& material,
+		const CodeGeneratorResponse& response) {
+	string data = kEntryMagic;
+	data.append(SimpleItoa(static_cast<uint64>(material.size())));
+	data.push_back('\n');
+	data.append(material);
+	if (!response.AppendToString(&data)) {
+		return;
+	}
+
+	int temporary;
+	{
+		MutexLock lock(&mutex_);
+		temporary = next_temporary_++;
+	}
+
+	string path = EntryPath(material);
+	string temporary_path = path + "." + SimpleItoa(static_cast<int>(getpid())) +
+		"." + SimpleItoa(temporary) + ".tmp";
+	if (!WriteFile(temporary_path, data) ||
+			rename(temporary_path.c_str(), path.c_str()) != 0) {
+		// On Windows rename() refuses to replace an entry another process
+		// stored first, which is just as good.
+		remove(temporary_path.c_str());
+	}
+}
+
+}  // namespace compiler
+}  // namespace protobuf
+}  // namespace google
@@ -0,0 +1,55 @@
+#ifndef GOOGLE_PROTOBUF_PATCH_GENERATION_CACHE_H__
+#define GOOGLE_PROTOBUF_PATCH_GENERATION_CACHE_H__
+
+#include <string>
+
+#include <google/protobuf/stubs/common.h>
+
+namespace google {
+namespace protobuf {
+namespace compiler {
+
+class CodeGeneratorResponse;
+
+// Content-addressed store for the output of CodeGenerator::Generate(),
+// enabled with the cache_dir=PATH plugin option.  Entries are keyed by a
+// fingerprint of the plugin version, the generator parameter, the file's
+// serialized descriptor and the keys of everything it imports (see
+// ComputeFileKeys()).  That key material is kept in the entry and compared
+// on lookup, so a fingerprint collision is a miss rather than wrong output.
+//
+// Entries are written to a temporary file and renamed into place, so any
+// number of plugin processes may share one directory.  Nothing is ever
+// evicted: wipe the directory to reclaim space.
+class GenerationCache {
+public:
+	explicit GenerationCache(const string& directory);
+	~GenerationCache();
+
+	// Returns the material an entry for |file_material| (as produced by
+	// ComputeFileKeys()) generated with |parameter| is keyed by.
+	static string KeyMaterial(const string& parameter, const string& file_material);
+
+	// Fills |response| with the files stored for |material|.  Returns false,
+	// leaving |response| empty, on a miss or an unreadable entry.
+	bool Lookup(const string& material, CodeGeneratorResponse* response) const;
+
+	// Best effort: failing to write an entry only costs a later miss.
+	void Store(const string& material, const CodeGeneratorResponse& response);
+
+private:
+	string EntryPath(const string& material) const;
+
+	string directory_;
+
+	Mutex mutex_;
+	int next_temporary_;
+
+	GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(GenerationCache);
+};
+
+}  // namespace compiler
+}  // namespace protobuf
+}  // namespace google
+
+#endif  // GOOGLE_PROTOBUF_PATCH_GENERATION_CACHE_H__
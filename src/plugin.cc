@@ -32,8 +32,12 @@
 
 #include <google/protobuf/compiler/plugin.h>
 
+#include <algorithm>
 #include <iostream>
+#include <map>
 #include <set>
+#include <stdlib.h>
+#include <string.h>
 
 #ifdef _WIN32
 #include <io.h>
@@ -55,16 +59,43 @@
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 
 #include <google/protobuf/io/printer.h>
+#include <google/protobuf/stubs/strutil.h>
 
 #include "cpp/cpp_helpers.h"
 #include "cpp/cpp_generator.h"
 #include "cpp/cpp_file.h"
+#include "cpp/cpp_options.h"
 #include "cpp_patch.h"
+#include "cpp_patch_lua.h"
+#include "descriptor_cache.h"
+#include "generation_cache.h"
+#include "plugin_daemon.h"
+
+// Worker threads for jobs=N.  Included last so that <windows.h> macros such
+// as GetMessage cannot leak into the protobuf headers above.
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <process.h>
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
 
 namespace google {
 namespace protobuf {
 namespace compiler {
 
+static void PrintLuaBindIncludes(io::Printer* printer) {
+	INC_LUA_HEADERS
+
+	LUABIND_USING_DEFINITION
+}
+
 class GeneratorResponseContext : public GeneratorContext {
 public:
 	GeneratorResponseContext(CodeGeneratorResponse* response,
@@ -93,18 +124,12 @@ public:
 		*output = parsed_files_;
 	}
 
-	bool GenerateLuaBindCode(const string& parameter, string* error) {
-		string dllexport_decl;
-
-		vector<pair<string, string> > options;
-		ParseGeneratorParameter(parameter, &options);
-
-		for (int i = 0; i < options.size(); i++) {
-			if (options[i].first == "dllexport_decl") {
-				dllexport_decl = options[i].second;
-			} else {
-				return false;
-			}
+	void GenerateLuaBindCode(const cpp::Options& options) {
+		// With lua_shards common.pb.h goes through the index, unless lua_lazy
+		// needs every registration function at hand.
+		bool use_index = options.lua_shards && !options.lua_lazy;
+		if (options.lua_shards) {
+			GenerateLuaShards(options);
 		}
 
 		scoped_ptr<io::ZeroCopyOutputStream> output(this->Open("common.pb.h"));
@@ -117,12 +142,61 @@ public:
 			"\n"
 			"\n");
 
+		if (use_index) {
+			if (options.lua_backend == cpp::Options::LUA_BACKEND_LUABIND) {
+				// No .pb.h brings in luabind or the Message classes.
+				PrintLuaBindIncludes(&printer);
+				printer.Print("#include <google/protobuf/message.h>\n");
+			}
+			printer.Print("#include \"lua_packages.pb.h\"\n");
+		} else if (options.lua_backend == cpp::Options::LUA_BACKEND_CAPI) {
+			if (options.lua_lazy) {
+				printer.Print(
+					"extern \"C\" {\n"
+					"#include <lua.h>\n"
+					"}\n"
+					"\n");
+			} else {
+				printer.Print("struct lua_State;\n\n");
+			}
+		} else if (options.split_luabind) {
+			// The .pb.h files no longer pull in luabind for us.
+			PrintLuaBindIncludes(&printer);
+		}
+
 		string basename;
-		for (int i = 0; i < parsed_files_.size(); i++) {
+		for (int i = 0; !use_index && i < parsed_files_.size(); i++) {
 			basename = cpp::StripProto(parsed_files_[i]->name());
 			basename.append(".pb.h");
 			printer.Print("#include \"$filename$\"\n", "filename", basename);
 		}
+		if (options.lua_lazy) {
+			printer.Print("\n#include <string.h>\n");
+		}
+
+		if (options.lua_backend == cpp::Options::LUA_BACKEND_CAPI) {
+			// Every message registers its own metatable, there is no shared
+			// MessageLite/Message class to set up.
+			printer.Print(
+				"\n"
+				"namespace google {\n"
+				"namespace protobuf {\n"
+				"\n");
+			if (options.lua_lazy) {
+				cpp::PrintLuaLazyRuntime(&printer);
+			}
+			printer.Print(
+				"inline void InitLuaBindEnvironment(lua_State *L) {\n");
+			GenerateLuaRegistration(options, use_index, &printer);
+			printer.Print(
+				"}\n"
+				"\n"
+				"}  // namespace protobuf\n"
+				"}  // namespace google\n"
+				"\n"
+				"#endif /* GOOGLE_PROTOBUF_LUABIND_COMMON_H__ */");
+			return;
+		}
 		
 		printer.Print(
 			"\n"
@@ -140,8 +214,14 @@ public:
 			"\n"
 			"namespace google {\n"
 			"namespace protobuf {\n"
-			"\n"
-			"inline void InitLuaBindEnvironment(lua_State *L) {\n"
+			"\n");
+		if (options.lua_lazy) {
+			cpp::PrintLuaLazyRuntime(&printer);
+		}
+		// With the index, the base classes get a function of their own, for
+		// states registering only some packages.
+		printer.Print(
+			"inline void $function$(lua_State *L) {\n"
 			"	module (L) [\n"
 			"		class_<MessageLite>(\"MessageLite\")\n"
 			"			.def(\"InitializationErrorString\", &MessageLite::InitializationErrorString)\n"
@@ -215,33 +295,515 @@ public:
 			//",\n"
 			//REG_REPEATED_FIELD(UInt64, ::google::protobuf::uint64)
 			"	];\n"
-			"\n");
+			"\n",
+			"function", use_index ? "InitLuaBindBase" : "InitLuaBindEnvironment");
+
+		if (use_index) {
+			printer.Print(
+				"}\n"
+				"\n"
+				"inline void InitLuaBindEnvironment(lua_State *L) {\n"
+				"	InitLuaBindBase(L);\n");
+		}
+		GenerateLuaRegistration(options, use_index, &printer);
+
+		printer.Print(
+			"}\n"
+			"\n"
+			"}  // namespace protobuf\n"
+			"}  // namespace google\n"
+			"\n"
+			"#endif /* GOOGLE_PROTOBUF_LUABIND_COMMON_H__ */");
+	}
+
+private:
+	// The body of InitLuaBindEnvironment() registering the parsed files:
+	// every file's _RegisterToLua(), every package through the index, or with
+	// lua_lazy the globals' __index.
+	void GenerateLuaRegistration(const cpp::Options& options, bool use_index,
+		io::Printer* printer) {
+		if (use_index) {
+			printer->Print(
+				"	RegisterLuaPackages(L);\n");
+			return;
+		}
+		if (!options.lua_lazy) {
+			for (int i = 0; i < parsed_files_.size(); i++) {
+				cpp::FileGenerator file_generator(parsed_files_[i], options);
+				file_generator.GenerateLuaBindRegisterCode(printer);
+			}
+			return;
+		}
+
+		printer->Print(
+			"	static const LuaLazyType kTypes[] = {\n");
+		for (int i = 0; i < parsed_files_.size(); i++) {
+			cpp::FileGenerator file_generator(parsed_files_[i], options);
+			file_generator.GenerateLuaLazyTypes(printer);
+		}
+		printer->Print(
+			"		{NULL, NULL, NULL}\n"
+			"	};\n"
+			"	InstallLuaLazyTypes(L, kTypes);\n");
+	}
 
+	// Writes <package>.lua.pb.cc for every package of the parsed files,
+	// defining <package>::RegisterPackageToLua(), and the index
+	// lua_packages.pb.h listing them with the packages they depend on.
+	void GenerateLuaShards(const cpp::Options& options) {
+		map<string, vector<const FileDescriptor*> > packages;
 		for (int i = 0; i < parsed_files_.size(); i++) {
-			cpp::FileGenerator file_generator(parsed_files_[i], dllexport_decl);
-			file_generator.GenerateLuaBindRegisterCode(&printer);
+			packages[parsed_files_[i]->package()].push_back(parsed_files_[i]);
 		}
 
+		map<string, set<string> > dependencies;
+		for (map<string, vector<const FileDescriptor*> >::iterator it = packages.begin();
+			it != packages.end(); ++it) {
+			for (int i = 0; i < it->second.size(); i++) {
+				const FileDescriptor* file = it->second[i];
+				for (int j = 0; j < file->dependency_count(); j++) {
+					const string& package = file->dependency(j)->package();
+					if (package != it->first && packages.count(package) > 0) {
+						dependencies[it->first].insert(package);
+					}
+				}
+			}
+
+			scoped_ptr<io::ZeroCopyOutputStream> output(
+				this->Open(LuaShardName(it->first) + ".lua.pb.cc"));
+			io::Printer printer(output.get(), '$');
+			printer.Print(
+				"// Generated by the protocol buffer compiler.  DO NOT EDIT!\n"
+				"\n"
+				"#include \"lua_packages.pb.h\"\n");
+			for (int i = 0; i < it->second.size(); i++) {
+				printer.Print("#include \"$filename$.pb.h\"\n",
+					"filename", cpp::StripProto(it->second[i]->name()));
+			}
+			printer.Print(
+				"\n"
+				"void $function$(lua_State *L) {\n",
+				"function", LuaShardFunction(it->first));
+			for (int i = 0; i < it->second.size(); i++) {
+				cpp::FileGenerator file_generator(it->second[i], options);
+				file_generator.GenerateLuaBindRegisterCode(&printer);
+			}
+			printer.Print("}\n");
+		}
+
+		scoped_ptr<io::ZeroCopyOutputStream> output(this->Open("lua_packages.pb.h"));
+		io::Printer printer(output.get(), '$');
 		printer.Print(
+			"// Generated by the protocol buffer compiler.  DO NOT EDIT!\n"
+			"\n"
+			"#ifndef GOOGLE_PROTOBUF_LUA_PACKAGES_H__\n"
+			"#define GOOGLE_PROTOBUF_LUA_PACKAGES_H__\n"
+			"\n"
+			"extern \"C\" {\n"
+			"#include <lua.h>\n"
+			"}\n"
+			"\n"
+			"#include <string.h>\n"
+			"#include <string>\n"
+			"\n");
+
+		for (map<string, vector<const FileDescriptor*> >::iterator it = packages.begin();
+			it != packages.end(); ++it) {
+			vector<string> parts;
+			SplitStringUsing(it->first, ".", &parts);
+			for (int i = 0; i < parts.size(); i++) {
+				printer.Print("namespace $part$ {\n", "part", parts[i]);
+			}
+			printer.Print("void RegisterPackageToLua(lua_State *L);\n");
+			for (int i = parts.size() - 1; i >= 0; i--) {
+				printer.Print("}  // namespace $part$\n", "part", parts[i]);
+			}
+		}
+
+		printer.Print(
+			"\n"
+			"namespace google {\n"
+			"namespace protobuf {\n"
+			"\n"
+			"// A package generated with lua_shards.\n"
+			"struct LuaPackage {\n"
+			"	const char* name;\n"
+			"	void (*registrar)(lua_State *L);\n"
+			"	const char* dependencies;  // space-separated package names\n"
+			"};\n"
+			"\n"
+			"// Every package, terminated by a NULL name.\n"
+			"inline const LuaPackage* LuaPackages() {\n"
+			"	static const LuaPackage kPackages[] = {\n");
+		for (map<string, vector<const FileDescriptor*> >::iterator it = packages.begin();
+			it != packages.end(); ++it) {
+			printer.Print(
+				"		{\"$name$\", &::$function$, \"$dependencies$\"},\n",
+				"name", it->first,
+				"function", LuaShardFunction(it->first),
+				"dependencies", JoinStrings(vector<string>(dependencies[it->first].begin(),
+					dependencies[it->first].end()), " "));
+		}
+		printer.Print(
+			"		{NULL, NULL, NULL}\n"
+			"	};\n"
+			"	return kPackages;\n"
+			"}\n"
+			"\n"
+			"// Registers |package| and the packages it depends on, each once per\n"
+			"// state.  Returns false if no such package was generated.\n"
+			"inline bool RegisterLuaPackage(lua_State *L, const char* package) {\n"
+			"	const LuaPackage* entry = LuaPackages();\n"
+			"	while (entry->name != NULL && strcmp(entry->name, package) != 0) entry++;\n"
+			"	if (entry->name == NULL) return false;\n"
+			"\n"
+			"	// Marked first, so that packages depending on each other terminate.\n"
+			"	lua_getfield(L, LUA_REGISTRYINDEX, \"protobuf.packages\");\n"
+			"	if (!lua_istable(L, -1)) {\n"
+			"		lua_pop(L, 1);\n"
+			"		lua_newtable(L);\n"
+			"		lua_pushvalue(L, -1);\n"
+			"		lua_setfield(L, LUA_REGISTRYINDEX, \"protobuf.packages\");\n"
+			"	}\n"
+			"	lua_getfield(L, -1, entry->name);\n"
+			"	bool registered = lua_toboolean(L, -1) != 0;\n"
+			"	lua_pop(L, 1);\n"
+			"	lua_pushboolean(L, 1);\n"
+			"	lua_setfield(L, -2, entry->name);\n"
+			"	lua_pop(L, 1);\n"
+			"	if (registered) return true;\n"
+			"\n"
+			"	const char* name = entry->dependencies;\n"
+			"	while (*name != '\\0') {\n"
+			"		const char* end = strchr(name, ' ');\n"
+			"		if (end == NULL) end = name + strlen(name);\n"
+			"		RegisterLuaPackage(L, ::std::string(name, end).c_str());\n"
+			"		name = *end == ' ' ? end + 1 : end;\n"
+			"	}\n"
+			"	entry->registrar(L);\n"
+			"	return true;\n"
+			"}\n"
+			"\n"
+			"inline void RegisterLuaPackages(lua_State *L) {\n"
+			"	for (const LuaPackage* entry = LuaPackages(); entry->name != NULL; entry++) {\n"
+			"		RegisterLuaPackage(L, entry->name);\n"
+			"	}\n"
 			"}\n"
 			"\n"
 			"}  // namespace protobuf\n"
 			"}  // namespace google\n"
 			"\n"
-			"#endif /* GOOGLE_PROTOBUF_LUABIND_COMMON_H__ */");
+			"#endif  // GOOGLE_PROTOBUF_LUA_PACKAGES_H__\n");
+	}
 
-		return true;
+	// The file name of |package|'s shard; "default" for files without a
+	// package, which cannot clash since C++ rules it out as a namespace.
+	static string LuaShardName(const string& package) {
+		return package.empty() ? "default" : package;
+	}
+
+	static string LuaShardFunction(const string& package) {
+		return (package.empty() ? "" : StringReplace(package, ".", "::", true) + "::") +
+			"RegisterPackageToLua";
 	}
 
-private:
 	CodeGeneratorResponse* response_;
 	const vector<const FileDescriptor*>& parsed_files_;
 };
 
-int PluginMain(int argc, char* argv[], const CodeGenerator* generator) {
+namespace {
+
+// Options handled by the plugin itself rather than the code generator.
+struct PluginOptions {
+	PluginOptions() : jobs(1) {}
+
+	// jobs=N generates up to N files concurrently; jobs=0 uses one worker
+	// per online CPU.  The default is to generate sequentially.
+	int jobs;
+
+	// cache_dir=PATH replays output for files generated before from a
+	// GenerationCache in PATH.  Off by default.
+	string cache_dir;
+};
+
+// Splits the options handled by PluginMain itself out of the generator
+// parameter.  Everything else is passed through to the code generator
+// untouched.
+bool ParsePluginParameter(const string& parameter, PluginOptions* plugin_options,
+	string* generator_parameter, string* error) {
+	vector<pair<string, string> > options;
+	ParseGeneratorParameter(parameter, &options);
+
+	generator_parameter->clear();
+
+	for (int i = 0; i < options.size(); i++) {
+		if (options[i].first == "jobs") {
+			char* end;
+			long value = strtol(options[i].second.c_str(), &end, 10);
+			if (options[i].second.empty() || *end != '\0' || value < 0) {
+				*error = "Invalid value for jobs: " + options[i].second;
+				return false;
+			}
+			plugin_options->jobs = static_cast<int>(value);
+		} else if (options[i].first == "cache_dir") {
+			if (options[i].second.empty()) {
+				*error = "cache_dir needs a directory.";
+				return false;
+			}
+			plugin_options->cache_dir = options[i].second;
+		} else {
+			if (!generator_parameter->empty()) {
+				generator_parameter->append(",");
+			}
+			generator_parameter->append(options[i].first);
+			if (!options[i].second.empty()) {
+				generator_parameter->append("=");
+				generator_parameter->append(options[i].second);
+			}
+		}
+	}
+
+	if (plugin_options->jobs == 0) {
+#ifdef _WIN32
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		plugin_options->jobs = static_cast<int>(info.dwNumberOfProcessors);
+#else
+		plugin_options->jobs = static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN));
+#endif
+		if (plugin_options->jobs < 1) plugin_options->jobs = 1;
+	}
+
+	return true;
+}
+
+// The generator parameter as far as the GenerationCache is concerned.  The
+// output also depends on the contents of the layout_profile file, which the
+// parameter only names.
+string CacheParameter(const string& parameter, const cpp::Options& options) {
+	string material = parameter;
+	for (map<string, double>::const_iterator it = options.field_heat.begin();
+			it != options.field_heat.end(); ++it) {
+		material.push_back('\0');
+		material.append(it->first + " " + SimpleDtoa(it->second));
+	}
+	return material;
+}
+
+// The output of one CodeGenerator::Generate() call.  Each file gets its own
+// response so that files generated concurrently can be appended to the real
+// response in request order afterwards.
+struct GenerationJob {
+	GenerationJob() : file(NULL), done(false) {}
+
+	const FileDescriptor* file;
+	string cache_material;  // set only when a GenerationCache is in use
+	CodeGeneratorResponse response;
+	string error;
+	bool done;
+};
+
+// Hands out GenerationJobs to worker threads in request order.  Once any job
+// fails no further jobs are started, mirroring the sequential loop which
+// stops at the first error.
+class GenerationQueue {
+public:
+	GenerationQueue(const cpp::CppGenerator* generator, const cpp::Options& options,
+		const vector<const FileDescriptor*>& parsed_files,
+		GenerationCache* cache, vector<GenerationJob>* jobs)
+		: generator_(generator),
+		options_(options),
+		parsed_files_(parsed_files),
+		cache_(cache),
+		jobs_(jobs),
+		next_(0),
+		failed_(false) {}
+
+	void Run() {
+		GenerationJob* job;
+		while ((job = Next()) != NULL) {
+			if (cache_ != NULL && cache_->Lookup(job->cache_material, &job->response)) {
+				MutexLock lock(&mutex_);
+				job->done = true;
+				continue;
+			}
+
+			GeneratorResponseContext context(&job->response, parsed_files_);
+
+			bool succeeded = generator_->Generate(
+				job->file, options_, &context, &job->error);
+
+			if (!succeeded && job->error.empty()) {
+				job->error = "Code generator returned false but provided no error "
+					"description.";
+			}
+
+			if (cache_ != NULL && job->error.empty()) {
+				cache_->Store(job->cache_material, job->response);
+			}
+
+			MutexLock lock(&mutex_);
+			job->done = true;
+			if (!job->error.empty()) failed_ = true;
+		}
+	}
+
+private:
+	GenerationJob* Next() {
+		MutexLock lock(&mutex_);
+		if (failed_ || next_ >= jobs_->size()) return NULL;
+		return &(*jobs_)[next_++];
+	}
+
+	const cpp::CppGenerator* generator_;
+	const cpp::Options& options_;
+	const vector<const FileDescriptor*>& parsed_files_;
+	GenerationCache* cache_;
+	vector<GenerationJob>* jobs_;
+
+	Mutex mutex_;
+	int next_;
+	bool failed_;
+
+	GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(GenerationQueue);
+};
+
+#ifdef _WIN32
+unsigned __stdcall GenerationWorker(void* queue) {
+	reinterpret_cast<GenerationQueue*>(queue)->Run();
+	return 0;
+}
+#else
+void* GenerationWorker(void* queue) {
+	reinterpret_cast<GenerationQueue*>(queue)->Run();
+	return NULL;
+}
+#endif
+
+// Runs all jobs on up to |num_workers| threads, including the calling one.
+void RunGenerationJobs(GenerationQueue* queue, int num_workers) {
+#ifdef _WIN32
+	vector<HANDLE> threads;
+	for (int i = 1; i < num_workers; i++) {
+		uintptr_t thread = _beginthreadex(NULL, 0, &GenerationWorker, queue, 0, NULL);
+		if (thread == 0) break;
+		threads.push_back(reinterpret_cast<HANDLE>(thread));
+	}
+	queue->Run();
+	for (int i = 0; i < threads.size(); i++) {
+		WaitForSingleObject(threads[i], INFINITE);
+		CloseHandle(threads[i]);
+	}
+#else
+	vector<pthread_t> threads;
+	for (int i = 1; i < num_workers; i++) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, &GenerationWorker, queue) != 0) break;
+		threads.push_back(thread);
+	}
+	queue->Run();
+	for (int i = 0; i < threads.size(); i++) {
+		pthread_join(threads[i], NULL);
+	}
+#endif
+}
+
+void PrintUsage(const char* argv0) {
+	cerr << "Usage: " << argv0 << " [--daemon[=SOCKET]]\n"
+		"\n"
+		"Without options, reads a CodeGeneratorRequest from stdin and writes the\n"
+		"response to stdout, as protoc expects of a plugin.\n"
+		"\n"
+		"  --daemon[=SOCKET]  Serve requests forwarded by protoc-gen-luabind-shim on\n"
+		"                     a unix socket.  SOCKET defaults to\n"
+		"                     $PROTOC_GEN_LUABIND_SOCKET, or else to\n"
+		"                     $XDG_RUNTIME_DIR/protoc-gen-luabind.sock, or without\n"
+		"                     $XDG_RUNTIME_DIR to /tmp/protoc-gen-luabind-<uid>/\n"
+		"                     daemon.sock.  protoc runs the shim without\n"
+		"                     arguments, so the shim only looks there:\n"
+		"                     with any other SOCKET, protoc has to run with\n"
+		"                     PROTOC_GEN_LUABIND_SOCKET=SOCKET in its environment.\n";
+}
+
+}  // namespace
+
+void GenerateResponse(const CodeGeneratorRequest& request,
+		const vector<const FileDescriptor*>& parsed_files,
+		const cpp::CppGenerator* generator, CodeGeneratorResponse* response) {
+
+	GeneratorResponseContext context(response, parsed_files);
+
+	PluginOptions options;
+	string parameter;
+	string error;
+	if (!ParsePluginParameter(request.parameter(), &options, &parameter, &error)) {
+		response->set_error(error);
+		return;
+	}
+
+	// Parsed once for all files, since it loads the layout_profile.
+	cpp::Options generator_options;
+	if (!cpp::ParseOptions(parameter, &generator_options, &error)) {
+		response->set_error(error);
+		return;
+	}
+
+	vector<GenerationJob> jobs(parsed_files.size());
+	for (int i = 0; i < parsed_files.size(); i++) {
+		jobs[i].file = parsed_files[i];
+	}
+
+	scoped_ptr<GenerationCache> cache;
+	if (!options.cache_dir.empty()) {
+		map<string, string> keys;
+		map<string, string> materials;
+		if (!ComputeFileKeys(request, &keys, &materials, &error)) {
+			response->set_error(error);
+			return;
+		}
+
+		cache.reset(new GenerationCache(options.cache_dir));
+		string cache_parameter = CacheParameter(parameter, generator_options);
+		for (int i = 0; i < jobs.size(); i++) {
+			jobs[i].cache_material = GenerationCache::KeyMaterial(
+				cache_parameter, materials[jobs[i].file->name()]);
+		}
+	}
+
+	GenerationQueue queue(generator, generator_options, parsed_files, cache.get(), &jobs);
+	RunGenerationJobs(&queue, min<int>(options.jobs, jobs.size()));
+
+	// Assemble the response in request order, stopping at the first file
+	// that failed just like the sequential loop used to.
+	for (int i = 0; i < jobs.size() && jobs[i].done; i++) {
+		response->mutable_file()->MergeFrom(jobs[i].response.file());
+		if (!jobs[i].error.empty()) {
+			response->set_error(jobs[i].file->name() + ": " + jobs[i].error);
+			break;
+		}
+	}
+
+	context.GenerateLuaBindCode(generator_options);
+}
+
+int PluginMain(int argc, char* argv[], const cpp::CppGenerator* generator) {
+
+	if (argc == 2 && strncmp(argv[1], "--daemon", 8) == 0) {
+		if (argv[1][8] == '=') {
+			return DaemonMain(argv[0], argv[1] + 9, generator);
+		} else if (argv[1][8] == '\0') {
+			return DaemonMain(argv[0], "", generator);
+		}
+	}
+
+	if (argc == 2 && strcmp(argv[1], "--help") == 0) {
+		PrintUsage(argv[0]);
+		return 0;
+	}
 
 	if (argc > 1) {
 		cerr << argv[0] << ": Unknown option: " << argv[1] << endl;
+		PrintUsage(argv[0]);
 		return 1;
 	}
 
@@ -277,27 +839,7 @@ int PluginMain(int argc, char* argv[], const CodeGenerator* generator) {
 	}
 
 	CodeGeneratorResponse response;
-	GeneratorResponseContext context(&response, parsed_files);
-
-	for (int i = 0; i < parsed_files.size(); i++) {
-		const FileDescriptor* file = parsed_files[i];
-
-		string error;
-		bool succeeded = generator->Generate(
-			file, request.parameter(), &context, &error);
-
-		if (!succeeded && error.empty()) {
-			error = "Code generator returned false but provided no error "
-				"description.";
-		}
-		if (!error.empty()) {
-			response.set_error(file->name() + ": " + error);
-			break;
-		}
-	}
-
-	string error;
-	context.GenerateLuaBindCode(request.parameter(), &error);
+	GenerateResponse(request, parsed_files, generator, &response);
 
 	if (!response.SerializeToFileDescriptor(STDOUT_FILENO)) {
 		cerr << argv[0] << ": Error writing to stdout." << endl;
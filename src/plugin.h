@@ -61,10 +61,12 @@ namespace google {
 namespace protobuf {
 namespace compiler {
 
-class CodeGenerator;    // code_generator.h
+namespace cpp { class CppGenerator; }    // cpp/cpp_generator.h
 
 // Implements main() for a protoc plugin exposing the given code generator.
-int PluginMain(int argc, char* argv[], const CodeGenerator* generator);
+// The generator options are parsed once per request and shared by every
+// file, so this front-end drives the C++ generator only.
+int PluginMain(int argc, char* argv[], const cpp::CppGenerator* generator);
 
 }  // namespace compiler
 }  // namespace protobuf
@@ -0,0 +1,227 @@
+#include "plugin_daemon.h"
+
+#include <iostream>
+
+#include <google/protobuf/compiler/code_generator.h>
+#include <google/protobuf/compiler/plugin.pb.h>
+#include <google/protobuf/descriptor.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "daemon_protocol.h"
+#include "descriptor_cache.h"
+#endif
+
+namespace google {
+namespace protobuf {
+namespace compiler {
+
+#ifdef _WIN32
+
+int DaemonMain(const char* argv0, const string& socket_path,
+		const cpp::CppGenerator* generator) {
+	cerr << argv0 << ": --daemon is not supported on this platform." << endl;
+	return 1;
+}
+
+#else  // _WIN32
+
+namespace {
+
+struct Connection {
+	const char* argv0;
+	int fd;
+	const cpp::CppGenerator* generator;
+	DescriptorCache* cache;
+};
+
+// Prefixes the relative paths named in the generator |parameter| with
+// |directory|, the working directory of the shim that sent it.
+string ResolveParameterPaths(const string& parameter, const string& directory) {
+	vector<pair<string, string> > options;
+	ParseGeneratorParameter(parameter, &options);
+
+	string result;
+	for (int i = 0; i < options.size(); i++) {
+		string value = options[i].second;
+		if ((options[i].first == "cache_dir" || options[i].first == "layout_profile") &&
+				!value.empty() && value[0] != '/') {
+			value = directory + "/" + value;
+		}
+
+		if (!result.empty()) {
+			result.append(",");
+		}
+		result.append(options[i].first);
+		if (!value.empty()) {
+			result.append("=");
+			result.append(value);
+		}
+	}
+	return result;
+}
+
+void ServeConnection(const Connection& connection) {
+	if (!PeerIsSameUser(connection.fd)) {
+		cerr << connection.argv0 << ": Refused a connection from another user." << endl;
+		return;
+	}
+
+	CodeGeneratorResponse response;
+
+	string directory;
+	string data;
+	if (!ReadFrame(connection.fd, &directory) || !ReadFrame(connection.fd, &data)) {
+		// The shim went away before sending a full request; nobody to answer.
+		return;
+	}
+
+	CodeGeneratorRequest request;
+	if (!request.ParseFromString(data)) {
+		response.set_error("protoc sent unparseable request to plugin.");
+	} else {
+		request.set_parameter(ResolveParameterPaths(request.parameter(), directory));
+
+		vector<const FileDescriptor*> parsed_files;
+		string error;
+		if (!connection.cache->Acquire(request, &parsed_files, &error)) {
+			response.set_error(error);
+		} else {
+			GenerateResponse(request, parsed_files, connection.generator, &response);
+			connection.cache->Release(parsed_files);
+		}
+	}
+
+	if (response.SerializeToString(&data)) {
+		WriteFrame(connection.fd, data);
+	}
+}
+
+void* ConnectionThread(void* arg) {
+	Connection* connection = static_cast<Connection*>(arg);
+	ServeConnection(*connection);
+	close(connection->fd);
+	delete connection;
+	return NULL;
+}
+
+}  // namespace
+
+int DaemonMain(const char* argv0, const string& socket_path,
+		const cpp::CppGenerator* generator) {
+	string path = socket_path.empty() ? DefaultDaemonSocketPath() : socket_path;
+
+	string error;
+	if (path == BuiltinDaemonSocketPath() && !CheckPrivateDirectory(path, true, &error)) {
+		cerr << argv0 << ": " << error << endl;
+		return 1;
+	}
+
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path)) {
+		cerr << argv0 << ": Socket path too long: " << path << endl;
+		return 1;
+	}
+	strcpy(address.sun_path, path.c_str());
+
+	// A shim hanging up mid-response must not take the daemon down with it.
+	signal(SIGPIPE, SIG_IGN);
+
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0) {
+		cerr << argv0 << ": socket: " << strerror(errno) << endl;
+		return 1;
+	}
+
+	// Take over the socket of a previous daemon that did not shut down
+	// cleanly, but only once connect() has shown that nobody listens on it
+	// any more, and only if it is a socket of ours.
+	struct stat info;
+	if (lstat(path.c_str(), &info) == 0) {
+		int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+		bool listening = probe >= 0 &&
+			connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+		int probe_errno = errno;
+		if (probe >= 0) close(probe);
+
+		if (listening) {
+			cerr << argv0 << ": A daemon is already listening on " << path << endl;
+			close(listener);
+			return 1;
+		}
+		if (!S_ISSOCK(info.st_mode) || info.st_uid != geteuid()) {
+			cerr << argv0 << ": " << path << " exists and is not a socket of "
+				"this user." << endl;
+			close(listener);
+			return 1;
+		}
+		if (probe_errno != ECONNREFUSED) {
+			cerr << argv0 << ": " << path << ": " << strerror(probe_errno) << endl;
+			close(listener);
+			return 1;
+		}
+		unlink(path.c_str());
+	}
+
+	if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+			listen(listener, SOMAXCONN) != 0) {
+		cerr << argv0 << ": " << path << ": " << strerror(errno) << endl;
+		close(listener);
+		return 1;
+	}
+
+	if (path != DefaultDaemonSocketPath()) {
+		cerr << argv0 << ": protoc-gen-luabind-shim connects to "
+			<< DefaultDaemonSocketPath() << "; run protoc with "
+			"PROTOC_GEN_LUABIND_SOCKET=" << path << " to reach this daemon." << endl;
+	}
+
+	// Never freed: detached connection threads may still be using it when
+	// the accept loop gives up.
+	DescriptorCache* cache = new DescriptorCache;
+	for (;;) {
+		int fd = accept(listener, NULL, NULL);
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) continue;
+			cerr << argv0 << ": accept: " << strerror(errno) << endl;
+			break;
+		}
+
+		// One thread per protoc invocation, so that parallel builds are not
+		// serialized behind a single daemon.
+		Connection* connection = new Connection;
+		connection->argv0 = argv0;
+		connection->fd = fd;
+		connection->generator = generator;
+		connection->cache = cache;
+
+		pthread_attr_t attr;
+		pthread_attr_init(&attr);
+		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+		pthread_t thread;
+		if (pthread_create(&thread, &attr, &ConnectionThread, connection) != 0) {
+			ConnectionThread(connection);
+		}
+		pthread_attr_destroy(&attr);
+	}
+
+	close(listener);
+	unlink(path.c_str());
+	return 1;
+}
+
+#endif  // _WIN32
+
+}  // namespace compiler
+}  // namespace protobuf
+}  // namespace google
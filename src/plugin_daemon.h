@@ -0,0 +1,40 @@
+#ifndef GOOGLE_PROTOBUF_PATCH_PLUGIN_DAEMON_H__
+#define GOOGLE_PROTOBUF_PATCH_PLUGIN_DAEMON_H__
+
+#include <string>
+#include <vector>
+
+#include <google/protobuf/stubs/common.h>
+
+namespace google {
+namespace protobuf {
+
+class FileDescriptor;
+
+namespace compiler {
+
+namespace cpp { class CppGenerator; }
+class CodeGeneratorRequest;
+class CodeGeneratorResponse;
+
+// Runs |generator| over |parsed_files|, which must have been built from
+// |request|, and fills in |response|.  Defined in plugin.cc so that the
+// daemon produces byte-for-byte the same output as a one-shot run.
+void GenerateResponse(const CodeGeneratorRequest& request,
+	const vector<const FileDescriptor*>& parsed_files,
+	const cpp::CppGenerator* generator, CodeGeneratorResponse* response);
+
+// Implements "protoc-gen-luabind --daemon[=SOCKET]".  Listens on a unix
+// socket and serves the requests forwarded by protoc-gen-luabind-shim,
+// keeping descriptors built for earlier requests in a DescriptorCache.  An
+// empty |socket_path| selects DefaultDaemonSocketPath(), the only path the
+// shim connects to; any other path has to be passed to the shim's protoc in
+// $PROTOC_GEN_LUABIND_SOCKET.  Only returns on error.
+int DaemonMain(const char* argv0, const string& socket_path,
+	const cpp::CppGenerator* generator);
+
+}  // namespace compiler
+}  // namespace protobuf
+}  // namespace google
+
+#endif  // GOOGLE_PROTOBUF_PATCH_PLUGIN_DAEMON_H__
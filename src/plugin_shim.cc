@@ -0,0 +1,104 @@
+// protoc-gen-luabind-shim: forwards the request protoc writes to stdin to a
+// running "protoc-gen-luabind --daemon" and copies the daemon's response to
+// stdout.  Point protoc at it in place of the real plugin:
+//
+//   protoc-gen-luabind --daemon &
+//   protoc --plugin=protoc-gen-luabind=path/to/protoc-gen-luabind-shim
+//          --luabind_out=OUT_DIR foo.proto
+//
+// Both sides pick the socket from $PROTOC_GEN_LUABIND_SOCKET, falling back to
+// a path in $XDG_RUNTIME_DIR or in a private per-user directory in /tmp.
+// protoc passes the shim no arguments, so a daemon started with
+// --daemon=PATH is only reachable if protoc runs with
+// PROTOC_GEN_LUABIND_SOCKET=PATH.
+
+#include <iostream>
+#include <string>
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "daemon_protocol.h"
+
+using namespace std;
+using namespace google::protobuf::compiler;
+
+int main(int argc, char* argv[]) {
+	if (argc > 1) {
+		cerr << argv[0] << ": Unknown option: " << argv[1] << endl;
+		return 1;
+	}
+
+	string request;
+	char buffer[8192];
+	for (;;) {
+		ssize_t n = read(STDIN_FILENO, buffer, sizeof(buffer));
+		if (n < 0 && errno == EINTR) continue;
+		if (n < 0) {
+			cerr << argv[0] << ": Error reading from stdin." << endl;
+			return 1;
+		}
+		if (n == 0) break;
+		request.append(buffer, n);
+	}
+
+	// Relative paths in the parameter, such as cache_dir=, are relative to
+	// where protoc runs, which need not be where the daemon was started.
+	char* cwd = getcwd(NULL, 0);
+	if (cwd == NULL) {
+		cerr << argv[0] << ": getcwd: " << strerror(errno) << endl;
+		return 1;
+	}
+	string directory = cwd;
+	free(cwd);
+
+	string path = DefaultDaemonSocketPath();
+	string error;
+	if (path == BuiltinDaemonSocketPath() && !CheckPrivateDirectory(path, false, &error)) {
+		cerr << argv[0] << ": Cannot reach plugin daemon at " << path << ": "
+			<< error << endl;
+		return 1;
+	}
+
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path)) {
+		cerr << argv[0] << ": Socket path too long: " << path << endl;
+		return 1;
+	}
+	strcpy(address.sun_path, path.c_str());
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+		cerr << argv[0] << ": Cannot reach plugin daemon at " << path
+			<< " (start it with \"protoc-gen-luabind --daemon\", or set"
+			" PROTOC_GEN_LUABIND_SOCKET to the socket of a running one): "
+			<< strerror(errno) << endl;
+		return 1;
+	}
+	if (!PeerIsSameUser(fd)) {
+		cerr << argv[0] << ": The plugin daemon at " << path
+			<< " is run by another user." << endl;
+		close(fd);
+		return 1;
+	}
+
+	string response;
+	if (!WriteFrame(fd, directory) || !WriteFrame(fd, request) ||
+			!ReadFrame(fd, &response)) {
+		cerr << argv[0] << ": Lost connection to plugin daemon at " << path << endl;
+		close(fd);
+		return 1;
+	}
+	close(fd);
+
+	if (!WriteFully(STDOUT_FILENO, response.data(), response.size())) {
+		cerr << argv[0] << ": Error writing to stdout." << endl;
+		return 1;
+	}
+
+	return 0;
+}